@@ -14,8 +14,8 @@ else:
 if not has_exact():
   raise ImportError('geode/exact is unavailable since geode was compiled without gmp support')
 
-def delaunay_points(X,edges=zeros((0,2),dtype=int32),validate=False):
-  return delaunay_points_py(X,edges,validate)
+def delaunay_points(X,edges=zeros((0,2),dtype=int32),validate=False,threads=1):
+  return delaunay_points_py(X,edges,validate,threads)
 
 def polygon_union(*polys):
   '''The union of possibly intersecting polygons, assuming consistent ordering'''
@@ -49,16 +49,16 @@ def circle_arc_intersection(*arcs):
   split = split_circle_arcs if all_arcs.flat.dtype==CircleArc else exact_split_circle_arcs
   return split(all_arcs,len(arcs)-1)
 
-def split_soup(mesh,X,depth=0):
+def split_soup(mesh,X,depth=0,threads=1):
   '''If depth is None, extract nonmanifold mesh with triangles at all depths'''
   if depth is None:
     depth = -1<<31
-  return geode_wrap.split_soup(mesh,X,depth)
+  return geode_wrap.split_soup(mesh,X,depth,threads)
 
-def split_soup_with_weight(mesh,X,weight,depth=0):
+def split_soup_with_weight(mesh,X,weight,depth=0,threads=1):
   if depth is None:
     depth = -1<<31
-  return geode_wrap.split_soup_with_weight(mesh,X,weight,depth)
+  return geode_wrap.split_soup_with_weight(mesh,X,weight,depth,threads)
 
 def split_soups(meshes,depth=0):
   return split_soup(*merge_meshes(meshes),depth=depth)
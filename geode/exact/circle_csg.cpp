@@ -13,6 +13,7 @@
 #include <geode/exact/math.h>
 #include <geode/exact/perturb.h>
 #include <geode/exact/PlanarArcGraph.h>
+#include <geode/exact/stats.h>
 #include <geode/geometry/ArcSegment.h>
 #include <geode/geometry/BoxTree.h>
 #include <geode/geometry/polygon.h>
@@ -42,13 +43,17 @@ Box<Vector<real,2>> approximate_bounding_box(const Nested<const CircleArc>& inpu
 
 Nested<CircleArc> split_circle_arcs(Nested<const CircleArc> arcs, const int depth) {
   IntervalScope scope;
+  GEODE_EXACT_PHASES;
+  GEODE_EXACT_PHASE("split_circle_arcs: arrangement");
   const auto PS = Pb::Implicit;
   auto q_and_graph = quantize_circle_arcs<PS>(arcs);
   const PlanarArcGraph<PS>& g = *(q_and_graph.y);
 
+  GEODE_EXACT_PHASE("split_circle_arcs: depth");
   Field<bool, FaceId> interior_faces;
   // This would be a good place to switch on a splitting rule
   interior_faces = faces_greater_than(g, depth);
+  GEODE_EXACT_PHASE("split_circle_arcs: extract");
   const auto contour_edges = extract_region(g.topology, interior_faces);
   return g.unquantize_circle_arcs(q_and_graph.x, contour_edges);
 }
@@ -388,8 +393,8 @@ static void check_circle_quantize(const Nested<const CircleArc>& arcs0) {
 using namespace geode;
 
 void wrap_circle_csg() {
-  GEODE_FUNCTION(split_circle_arcs)
-  GEODE_FUNCTION(split_arcs_by_parity)
+  GEODE_NOGIL_FUNCTION(split_circle_arcs)
+  GEODE_NOGIL_FUNCTION(split_arcs_by_parity)
   GEODE_FUNCTION(canonicalize_circle_arcs)
   GEODE_FUNCTION_2(circle_arc_area,static_cast<real(*)(Nested<const CircleArc>)>(circle_arc_area))
   GEODE_FUNCTION(circle_arc_length)
@@ -1,23 +1,29 @@
 // Randomized incremental Delaunay using simulation of simplicity
 
 #include <geode/exact/delaunay.h>
+#include <geode/exact/Interval.h>
 #include <geode/exact/predicates.h>
 #include <geode/exact/quantize.h>
 #include <geode/exact/scope.h>
+#include <geode/exact/stats.h>
 #include <geode/array/amap.h>
 #include <geode/array/RawField.h>
 #include <geode/math/integer_log.h>
 #include <geode/python/wrap.h>
 #include <geode/random/permute.h>
 #include <geode/random/Random.h>
+#include <geode/structure/Hashtable.h>
 #include <geode/structure/Tuple.h>
 #include <geode/utility/curry.h>
 #include <geode/utility/interrupts.h>
 #include <geode/utility/Log.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
 namespace geode {
 
 using Log::cout;
 using std::endl;
+using std::vector;
 typedef Vector<real,2> TV;
 typedef Vector<Quantized,2> EV;
 using exact::Perturbed2;
@@ -214,6 +220,7 @@ GEODE_COLD static void assert_delaunay(const char* prefix,
                                        const Hashtable<Vector<VertexId,2>>& constrained=Tuple<>(),
                                        const bool oriented_only=false,
                                        const bool check_boundary=true) {
+  IntervalScope scope;
   // Verify that all faces are correctly oriented
   for (const auto f : mesh.faces()) {
     const auto v = mesh.vertices(f);
@@ -260,8 +267,9 @@ GEODE_COLD static void assert_delaunay(const char* prefix,
 }
 
 
-// This routine assumes the sentinel points have already been added, and processes points in order
-GEODE_NEVER_INLINE static Ref<MutableTriangleTopology> deterministic_exact_delaunay(RawField<const Perturbed2,VertexId> X, const bool validate) {
+// This routine assumes the sentinel points have already been added, and processes points in order.
+// The sentinels are left in the mesh for the caller to remove.
+GEODE_NEVER_INLINE static Ref<MutableTriangleTopology> deterministic_exact_delaunay(RawField<const Perturbed2,VertexId> X) {
 
   const int n = X.size()-3;
   const auto mesh = new_<MutableTriangleTopology>();
@@ -369,15 +377,7 @@ GEODE_NEVER_INLINE static Ref<MutableTriangleTopology> deterministic_exact_delau
     }
   }
 
-  // Remove sentinels
-  for (int i=0;i<3;i++)
-    mesh->erase_last_vertex_with_reordering();
-
-  // If desired, check that the final mesh is Delaunay
-  if (validate)
-    assert_delaunay("delaunay validate: ",mesh,X);
-
-  // Return the mesh with the sentinels removed
+  // Return the mesh, still including sentinels
   return mesh;
 }
 
@@ -770,8 +770,9 @@ static void spatial_sort(RawArray<Perturbed2> X, const int leaf_size, Random& ra
 }
 
 // Prepare a list of points for Delaunay triangulation: randomly assign into logarithmic bins, sort within bins, and add sentinels.
-// For details, see Amenta et al., Incremental Constructions con BRIO.
-static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
+// For details, see Amenta et al., Incremental Constructions con BRIO.  The sentinels get seeds sentinel+0,1,2, which must be
+// the same for every subset of a given point set to keep the perturbation consistent.
+static Array<Perturbed2> partially_sorted_shuffle(RawArray<const Perturbed2> Xin, const int sentinel) {
   const int n = Xin.size();
   Array<Perturbed2> X(n+3,uninit);
 
@@ -783,7 +784,7 @@ static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
     int j = (int)random_permute(n,key,i);
     const int bin = min(integer_log(j+1),bins-1);
     j = (1<<bin)-1+bin_counts[bin]++;
-    X[j] = Perturbed2(i,Xin[i]);
+    X[j] = Xin[i];
   }
 
   // Spatially sort each bin down to clusters of size 64.
@@ -796,28 +797,243 @@ static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
   }
 
   // Add 3 sentinel points at infinity
-  X[n+0] = Perturbed2(n+0,EV(-bound,-bound));
-  X[n+1] = Perturbed2(n+1,EV( bound, 0)    );
-  X[n+2] = Perturbed2(n+2,EV(-bound, bound));
+  X[n+0] = Perturbed2(sentinel+0,EV(-bound,-bound));
+  X[n+1] = Perturbed2(sentinel+1,EV( bound, 0)    );
+  X[n+2] = Perturbed2(sentinel+2,EV(-bound, bound));
 
   return X;
 }
 
-Ref<TriangleTopology> exact_delaunay_points(RawArray<const EV> X, RawArray<const Vector<int,2>> edges,
-                                            const bool validate) {
+static Ref<MutableTriangleTopology> sequential_exact_delaunay(RawArray<const EV> X, const bool validate) {
   const int n = X.size();
-  GEODE_ASSERT(n>=3);
 
   // Quantize all input points, reorder, and add sentinels
-  Field<const Perturbed2,VertexId> Xp(partially_sorted_shuffle(X));
+  Array<Perturbed2> Xin(n,uninit);
+  for (const int i : range(n))
+    Xin[i] = Perturbed2(i,X[i]);
+  Field<const Perturbed2,VertexId> Xp(partially_sorted_shuffle(Xin,n));
 
   // Compute Delaunay triangulation
-  const auto mesh = deterministic_exact_delaunay(Xp,validate);
+  const auto mesh = deterministic_exact_delaunay(Xp);
+
+  // Remove sentinels
+  for (int i=0;i<3;i++)
+    mesh->erase_last_vertex_with_reordering();
+
+  // If desired, check that the final mesh is Delaunay
+  if (validate)
+    assert_delaunay("delaunay validate: ",mesh,Xp);
 
   // Undo the vertex permutation
   mesh->permute_vertices(Xp.flat.slice(0,n).project<int,&Perturbed2::seed_>().copy());
+  return mesh;
+}
+
+// Parallel Delaunay triangulation by spatial decomposition.  We split the points into parts by recursive exact median
+// cuts and triangulate each part independently, sentinels included.  A finite triangle of a part whose circumcircle is
+// certainly inside the open box of the part is empty of all other points, so it is a triangle of the global triangulation
+// under the same perturbation.  Call the rest of the plane the seam region.  Every vertex of a global triangle in the
+// seam region touches an uncertified triangle of its own part, since otherwise its entire star would be certified.
+// Thus, triangulating just the seam vertices reproduces all global triangles in the seam region, which we pick out by
+// flood filling from sentinel triangles and from the far side of certified edges.  The result has the same triangles
+// as the sequential version, but in a different order.
+
+namespace {
+struct Part {
+  Range<int> range; // Points in the part
+  Box<TV> box; // Open region containing the part, with all other points outside
+
+  Part() {}
+  Part(Range<int> range, const Box<TV>& box)
+    : range(range), box(box) {}
+};
+}
+
+// Is the circumcircle of a counterclockwise triangle certainly inside an open box?  Requires an IntervalScope.
+static inline bool circle_inside_box(const Perturbed2 x0, const Perturbed2 x1, const Perturbed2 x2, const Box<TV>& box) {
+  typedef Vector<Interval,2> IV;
+  const IV a(x0.value()),
+           b = IV(x1.value())-a,
+           c = IV(x2.value())-a;
+  const auto d = Interval(2)*(b.x*c.y-b.y*c.x);
+  if (!certainly_positive(d))
+    return false;
+  const auto bb = sqr(b.x)+sqr(b.y),
+             cc = sqr(c.x)+sqr(c.y),
+             inv_d = inverse(d);
+  const IV u((c.y*bb-b.y*cc)*inv_d,(b.x*cc-c.x*bb)*inv_d);
+  const auto sqr_radius = sqr(u.x)+sqr(u.y);
+  for (const int axis : range(2)) {
+    const auto center = a[axis]+u[axis];
+    if (box.min[axis]>-inf) {
+      const auto gap = center-box.min[axis];
+      if (!certainly_positive(gap) || !certainly_less(sqr_radius,sqr(gap)))
+        return false;
+    }
+    if (box.max[axis]<inf) {
+      const auto gap = box.max[axis]-center;
+      if (!certainly_positive(gap) || !certainly_less(sqr_radius,sqr(gap)))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Split the finite triangles of a part into certified triangles and seam vertices, both in terms of seeds
+GEODE_NEVER_INLINE static void classify_part(const TriangleTopology& mesh, RawField<const Perturbed2,VertexId> X, const Box<TV>& box,
+                                             Array<Vector<int,3>>& certified, Array<int>& seam) {
+  IntervalScope scope;
+  const int m = X.size()-3;
+  Array<bool> in_seam(m);
+  for (const auto f : mesh.faces()) {
+    const auto v = mesh.vertices(f);
+    if (max(v.x.id,v.y.id,v.z.id)<m && circle_inside_box(X[v.x],X[v.y],X[v.z],box))
+      certified.append(vec(X[v.x].seed(),X[v.y].seed(),X[v.z].seed()));
+    else
+      for (const auto u : v)
+        if (u.id<m)
+          in_seam[u.id] = true;
+  }
+  for (const int i : range(m))
+    if (in_seam[i])
+      seam.append(X.flat[i].seed());
+}
+
+static Ref<MutableTriangleTopology> parallel_exact_delaunay(RawArray<const EV> X, const bool validate, const int threads) {
+  const int n = X.size();
+  Array<Perturbed2> P(n,uninit);
+  for (const int i : range(n))
+    P[i] = Perturbed2(i,X[i]);
+
+  // Split into at least threads parts by exact median cuts along the longest axis.  Left points are no greater
+  // than the cut along the axis and right points no smaller, so the cut is a boundary of both open boxes.
+  const int min_part = 256;
+  Array<Part> parts;
+  parts.append(Part(range(n),Box<TV>(TV(-inf,-inf),TV(inf,inf))));
+  while (parts.size()<threads && parts[0].range.size()>=2*min_part) {
+    Array<Part> next(2*parts.size(),uninit);
+    parallel_for(parts.size(),threads,[&](const int p) {
+      const auto& part = parts[p];
+      const auto Xp = P.slice(part.range);
+      const int axis = bounding_box(Xp.project<EV,&Perturbed2::value_>()).sizes().argmax(),
+                mid = Xp.size()/2;
+      if (axis==0) std::nth_element(Xp.begin(),Xp.begin()+mid,Xp.end(),axis_less<0,Perturbed2>);
+      else         std::nth_element(Xp.begin(),Xp.begin()+mid,Xp.end(),axis_less<1,Perturbed2>);
+      const real cut = Xp[mid].value()[axis];
+      auto left = part.box, right = part.box;
+      left.max[axis] = right.min[axis] = cut;
+      next[2*p+0] = Part(range(part.range.lo,part.range.lo+mid),left);
+      next[2*p+1] = Part(range(part.range.lo+mid,part.range.hi),right);
+    });
+    parts = next;
+  }
+  if (parts.size()==1)
+    return sequential_exact_delaunay(X,validate);
+
+  // Triangulate each part, keeping certified triangles and collecting the seam vertices
+  vector<Array<Vector<int,3>>> certified(parts.size());
+  vector<Array<int>> seam(parts.size());
+  parallel_for(parts.size(),threads,[&](const int p) {
+    const auto& part = parts[p];
+    const Field<const Perturbed2,VertexId> Xp(partially_sorted_shuffle(P.slice(part.range),n));
+    classify_part(deterministic_exact_delaunay(Xp),Xp,part.box,certified[p],seam[p]);
+  });
+
+  // Collect certified halfedges between seam vertices, which are the only ones the seam triangulation can see
+  Array<bool> in_seam(n);
+  for (const auto& s : seam)
+    for (const int i : s)
+      in_seam[i] = true;
+  vector<Array<Vector<int,2>>> seam_edges(parts.size());
+  parallel_for(parts.size(),threads,[&](const int p) {
+    for (const auto& f : certified[p])
+      for (const int i : range(3)) {
+        const auto e = vec(f[i],f[(i+1)%3]);
+        if (in_seam[e.x] && in_seam[e.y])
+          seam_edges[p].append(e);
+      }
+  });
+  Hashtable<Vector<int,2>> certified_edges;
+  for (const auto& edges : seam_edges)
+    for (const auto& e : edges)
+      certified_edges.set(e);
+
+  // Triangulate the seam vertices
+  Array<Perturbed2> S;
+  for (const auto& s : seam)
+    for (const int i : s)
+      S.append(Perturbed2(i,X[i]));
+  const Field<const Perturbed2,VertexId> Xs(partially_sorted_shuffle(S,n));
+  const auto seam_mesh = deterministic_exact_delaunay(Xs);
+  const auto seed = [&](const VertexId v) { return Xs[v].seed(); };
+
+  // Flood fill the seam region.  A triangle beyond a certified edge is in the seam region unless the edge is certified
+  // on both sides, and we can cross any edge whose far side is not certified.
+  const int k = S.size();
+  Field<bool,FaceId> inside(seam_mesh->allocated_faces());
+  Array<FaceId> stack;
+  for (const auto f : seam_mesh->faces()) {
+    const auto v = seam_mesh->vertices(f);
+    bool seed_face = max(v.x.id,v.y.id,v.z.id)>=k;
+    for (const auto e : seam_mesh->halfedges(f)) {
+      const int a = seed(seam_mesh->src(e)),
+                b = seed(seam_mesh->dst(e));
+      seed_face |= certified_edges.contains(vec(b,a)) && !certified_edges.contains(vec(a,b));
+    }
+    if (seed_face) {
+      inside[f] = true;
+      stack.append(f);
+    }
+  }
+  while (stack.size()) {
+    const auto f = stack.pop();
+    for (const auto e : seam_mesh->halfedges(f)) {
+      const auto r = seam_mesh->reverse(e);
+      if (seam_mesh->is_boundary(r))
+        continue;
+      const auto g = seam_mesh->face(r);
+      if (!inside[g] && !certified_edges.contains(vec(seed(seam_mesh->dst(e)),seed(seam_mesh->src(e))))) {
+        inside[g] = true;
+        stack.append(g);
+      }
+    }
+  }
+
+  // Assemble the certified triangles and the finite triangles of the seam region
+  Array<Vector<int,3>> faces;
+  for (const auto& c : certified)
+    faces.extend(c);
+  for (const auto f : seam_mesh->faces())
+    if (inside[f]) {
+      const auto v = seam_mesh->vertices(f);
+      if (max(v.x.id,v.y.id,v.z.id)<k)
+        faces.append(vec(seed(v.x),seed(v.y),seed(v.z)));
+    }
+  const auto mesh = new_<MutableTriangleTopology>();
+  mesh->add_vertices(n);
+  mesh->add_faces(faces);
+  // A triangulated disk using every vertex has 2n-2-h triangles with h boundary edges
+  GEODE_ASSERT(mesh->n_faces()+mesh->n_boundary_edges()+2==2*n);
+
+  // If desired, check that the final mesh is Delaunay
+  if (validate)
+    assert_delaunay("delaunay validate: ",mesh,RawField<const EV,VertexId>(X));
+  return mesh;
+}
+
+Ref<TriangleTopology> exact_delaunay_points(RawArray<const EV> X, RawArray<const Vector<int,2>> edges,
+                                            const bool validate, const int threads) {
+  const int n = X.size();
+  GEODE_ASSERT(n>=3);
+  GEODE_EXACT_PHASES;
+
+  // Compute Delaunay triangulation
+  GEODE_EXACT_PHASE("delaunay: triangulate");
+  const auto mesh = threads>1 ? parallel_exact_delaunay(X,validate,threads)
+                              : sequential_exact_delaunay(X,validate);
 
   // Insert constraint edges in random order
+  GEODE_EXACT_PHASE("delaunay: constrain");
   add_constraint_edges(mesh,RawField<const EV,VertexId>(X),edges,validate);
 
   // All done!
@@ -825,8 +1041,8 @@ Ref<TriangleTopology> exact_delaunay_points(RawArray<const EV> X, RawArray<const
 }
 
 Ref<TriangleTopology> delaunay_points(RawArray<const Vector<real,2>> X, RawArray<const Vector<int,2>> edges,
-                                      const bool validate) {
-  return exact_delaunay_points(amap(quantizer(bounding_box(X)),X).copy(),edges,validate);
+                                      const bool validate, const int threads) {
+  return exact_delaunay_points(amap(quantizer(bounding_box(X)),X).copy(),edges,validate,threads);
 }
 
 // Greedily compute a set of nonintersecting edges in a point cloud for testing purposes
@@ -859,7 +1075,7 @@ static Array<Vector<int,2>> greedy_nonintersecting_edges(RawArray<const Vector<r
 using namespace geode;
 
 void wrap_delaunay() {
-  GEODE_FUNCTION_2(delaunay_points_py,delaunay_points)
+  GEODE_NOGIL_FUNCTION_2(delaunay_points_py,delaunay_points)
   GEODE_FUNCTION(greedy_nonintersecting_edges)
   GEODE_FUNCTION(chew_fan_count)
 }
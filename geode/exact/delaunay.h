@@ -7,15 +7,19 @@ namespace geode {
 
 // Approximately Delaunay triangulate a point set, by first quantizing and performing exact Delaunay.
 // Any edges are used as constraints in constrained Delaunay.  If two edges intersect, ValueError is thrown.
+// With threads > 1, large inputs are split spatially and triangulated in parallel.  The triangles are the same
+// as for threads = 1, but may be in a different order.
 GEODE_CORE_EXPORT Ref<TriangleTopology> delaunay_points(RawArray<const Vector<real,2>> X,
                                                         RawArray<const Vector<int,2>> edges=Tuple<>(),
-                                                        const bool validate=false);
+                                                        const bool validate=false,
+                                                        const int threads=1);
 
 // Exactly Delaunay triangulate a quantized point set.
 // Any edges are used as constraints in constrained Delaunay.  If two edges intersect, ValueError is thrown.
 GEODE_CORE_EXPORT Ref<TriangleTopology> exact_delaunay_points(RawArray<const Vector<Quantized,2>> X,
                                                               RawArray<const Vector<int,2>> edges=Tuple<>(),
-                                                              const bool validate=false);
+                                                              const bool validate=false,
+                                                              const int threads=1);
 
 
 struct GEODE_CORE_CLASS_EXPORT DelaunayConstraintConflict : public ValueError {
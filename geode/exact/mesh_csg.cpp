@@ -8,6 +8,7 @@
 #include <geode/exact/quantize.h>
 #include <geode/exact/scope.h>
 #include <geode/exact/simple_triangulate.h>
+#include <geode/exact/stats.h>
 #include <geode/array/amap.h>
 #include <geode/array/ConstantMap.h>
 #include <geode/array/RawField.h>
@@ -24,6 +25,7 @@
 #include <geode/random/Random.h>
 #include <geode/structure/Hashtable.h>
 #include <geode/structure/UnionFind.h>
+#include <geode/utility/openmp.h>
 #include <geode/utility/Unique.h>
 #include <geode/vector/Matrix.h>
 namespace geode {
@@ -265,25 +267,53 @@ struct Line {
   int ff; // ff-edge index if we're positively oriented, -ff-1 if we're negatively oriented
 };
 
+// Per thread scratch space for retriangulation.  Everything is reset rather than reallocated between faces,
+// so once the buffers have grown to fit the largest face seen, retriangulating a face does not allocate.
+struct Scratch : public Noncopyable {
+  Field<int,VertexId> vertices; // Contiguous list of vertices for the current face
+  Hashtable<Vector<VertexId,2>,Line> constrained;
+  Array<VertexId> local; // local[vertices[v]] = v, valid only for the vertices of the current face
+  Array<VertexId> stack;
+  const Ref<MutableTriangleTopology> mesh;
+
+  Scratch()
+    : mesh(new_<MutableTriangleTopology>()) {}
+
+  // Prepare for a face with the given number of constraint edges
+  void reset(const int constraints) {
+    vertices.flat.clear();
+    // Clearing costs the size of the table, so shrink tables left large by an unusually complex face.
+    // Shrinking a vector does not free its storage.
+    if (constrained.max_size() > 16*max(4*constraints,32))
+      constrained.initialize_new_table(4*constraints);
+    else
+      constrained.clear();
+    stack.clear();
+    mesh->clear();
+  }
+};
+
 // Geometry policy for triangulation within the given face
 struct Policy : public State, public Noncopyable {
   const int face;
   const Vector<P,3> f;
   const Vector<int,3> face_edges; // e12,e20,e01
   const IV normal;
-  Hashtable<Vector<VertexId,2>,Line> constrained;
+  Hashtable<Vector<VertexId,2>,Line>& constrained;
 
   // Contiguous list of vertices for this face
-  Field<int,VertexId> vertices;
+  Field<int,VertexId>& vertices;
 
-  Policy(State& S, const int face, const Vector<int,3> face_edges)
+  Policy(State& S, Scratch& scratch, const int face, const Vector<int,3> face_edges)
     : State(S)
     , face(face)
     , f(Xi(faces[face].x),
         Xi(faces[face].y),
         Xi(faces[face].z))
     , face_edges(face_edges)
-    , normal(cross(iv(f.y)-iv(f.x),iv(f.z)-iv(f.x))) {
+    , normal(cross(iv(f.y)-iv(f.x),iv(f.z)-iv(f.x)))
+    , constrained(scratch.constrained)
+    , vertices(scratch.vertices) {
     assert(edges[face_edges.z].contains_all(vec(f.x.seed(),f.y.seed())));
   }
 
@@ -673,8 +703,8 @@ template<int up> struct Below : public State {
 
 // Geometry policy for triangulation within the given face, with the given axis as up
 template<int up> struct PolicyUp : public Policy {
-  PolicyUp(State& S, const int face, const Vector<int,3> face_edges)
-    : Policy(S,face,face_edges) {}
+  PolicyUp(State& S, Scratch& scratch, const int face, const Vector<int,3> face_edges)
+    : Policy(S,scratch,face,face_edges) {}
 
   // VertexIds can be either interior or boundary edge-face vertices
   bool below(const VertexId v0, const VertexId v1) const {
@@ -726,9 +756,68 @@ template<int up> struct PolicyUp : public Policy {
 };
 }
 
+namespace {
+// Collect edge-face intersection vertices during a traversal of an edge tree against a face tree
+struct EdgeFaceVisitor {
+  const SimplexTree<EV,1>& edge_tree;
+  const SimplexTree<EV,2>& face_tree;
+  const RawArray<const EV> X;
+  Array<EdgeFaceVertex> ef_vertices;
+
+  EdgeFaceVisitor(const SimplexTree<EV,1>& edge_tree, const SimplexTree<EV,2>& face_tree)
+    : edge_tree(edge_tree), face_tree(face_tree), X(face_tree.X) {}
+
+  bool cull(const int ne, const int nf) const { return false; }
+
+  void leaf(const int ne, const int nf) {
+    const int edge = edge_tree.prims(ne)[0],
+              face = face_tree.prims(nf)[0];
+    const auto ev = edge_tree.mesh->elements[edge];
+    const auto fv = face_tree.mesh->elements[face];
+    if (!(fv.contains(ev.x) || fv.contains(ev.y))) {
+      const auto e0 = Xi(ev.x), e1 = Xi(ev.y),
+                 f0 = Xi(fv.x), f1 = Xi(fv.y), f2 = Xi(fv.z);
+      if (segment_triangle_intersect(e0,e1,f0,f1,f2)) {
+        const auto c = perturbed_construct<ConstructEF>(tolerance,e0,e1,f0,f1,f2);
+        ef_vertices.append(EdgeFaceVertex(edge,face,!c.y,c.x));
+      }
+    }
+  }
+};
+}
+
+// Run one traversal task on the current thread.  The rounding mode is per thread, so each task sets its own.
+static GEODE_NEVER_INLINE Array<EdgeFaceVertex>
+edge_face_task(const SimplexTree<EV,1>& edge_tree, const SimplexTree<EV,2>& face_tree,
+               const Vector<int,2> task) {
+  IntervalScope scope;
+  EdgeFaceVisitor visitor(edge_tree,face_tree);
+  double_traverse_task(edge_tree,face_tree,visitor,task,Zero());
+  return visitor.ef_vertices;
+}
+
+// Find all edge-face intersection vertices in serial traversal order, optionally using several threads.
+static Array<EdgeFaceVertex> edge_face_vertices(const SimplexTree<EV,1>& edge_tree, const SimplexTree<EV,2>& face_tree,
+                                                const int threads) {
+  if (threads <= 1) {
+    EdgeFaceVisitor visitor(edge_tree,face_tree);
+    double_traverse(edge_tree,face_tree,visitor);
+    return visitor.ef_vertices;
+  }
+
+  // Since the rounding mode is per thread, we can't use parallel_double_traverse directly
+  EdgeFaceVisitor visitor(edge_tree,face_tree);
+  const auto tasks = double_traverse_tasks(edge_tree,face_tree,visitor,threads,Zero());
+  vector<Array<EdgeFaceVertex>> results(tasks.size());
+  parallel_for(tasks.size(),threads,[&](const int t) {
+    results[t] = edge_face_task(edge_tree,face_tree,tasks[t]);
+  });
+  return Nested<EdgeFaceVertex>::copy(results).flat;
+}
+
 // Find all intersection vertices and edges
 static Tuple<Nested<const EdgeFaceVertex>,Array<const FaceFaceEdge>>
-intersection_simplices(const SimplexTree<EV,2>& face_tree) {
+intersection_simplices(const SimplexTree<EV,2>& face_tree, const int threads) {
   const auto X = face_tree.X;
   const TriangleSoup& faces = face_tree.mesh;
   const SegmentSoup& edges = faces.segment_soup();
@@ -739,44 +828,15 @@ intersection_simplices(const SimplexTree<EV,2>& face_tree) {
 
   {
     // Find ef_vertices
-
-    // In my MSVC version (19.00.22310.1 for x64) using new_ in the initializer list below results in edge_tree not pointing to a valid object
-    // My guess is that the destructor for the temporary is getting being called before the edge_tree Ref is initialized
-    // Perhaps copy elision of a temporary passed via an initializer list to construct an anonymous struct hits a compiler bug?
-    // Or perhaps I misunderstand something about lifetime of temporaries in this context?
-    // Adding a seperate reference is a clean enough workaround
-    const auto helper_edge_tree = new_<SimplexTree<EV, 1>>(edges, X, 1);
-    struct {
-      const Ref<const SimplexTree<EV,1>> edge_tree;
-      const SimplexTree<EV,2>& face_tree;
-      const RawArray<const EV> X;
-      Array<EdgeFaceVertex> ef_vertices;
-
-      bool cull(const int ne, const int nf) const { return false; }
-
-      void leaf(const int ne, const int nf) {
-        const int edge = edge_tree->prims(ne)[0],
-                  face = face_tree.prims(nf)[0];
-        const auto ev = edge_tree->mesh->elements[edge];
-        const auto fv = face_tree.mesh->elements[face];
-        if (!(fv.contains(ev.x) || fv.contains(ev.y))) {
-          const auto e0 = Xi(ev.x), e1 = Xi(ev.y),
-                     f0 = Xi(fv.x), f1 = Xi(fv.y), f2 = Xi(fv.z);
-          if (segment_triangle_intersect(e0,e1,f0,f1,f2)) {
-            const auto c = perturbed_construct<ConstructEF>(tolerance,e0,e1,f0,f1,f2);
-            ef_vertices.append(EdgeFaceVertex(edge,face,!c.y,c.x));
-          }
-        }
-      }
-    } helper({helper_edge_tree,face_tree,X});
-    double_traverse(*helper.edge_tree,face_tree,helper);
+    const auto edge_tree = new_<SimplexTree<EV,1>>(edges,X,1);
+    const auto flat = edge_face_vertices(edge_tree,face_tree,threads);
 
     // Bucket edge face vertices by edge
     Array<int> counts(edges.elements.size());
-    for (const auto& ef : helper.ef_vertices)
+    for (const auto& ef : flat)
       counts[ef.edge]++;
     ef_vertices = Nested<EdgeFaceVertex>(counts,uninit);
-    for (const auto& ef : helper.ef_vertices)
+    for (const auto& ef : flat)
       ef_vertices(ef.edge,--counts[ef.edge]) = ef;
   }
 
@@ -959,8 +1019,12 @@ struct DepthUnionFind {
 };
 }
 
+// Union-find merges (i,j,depth(j)-depth(i)) recorded during retriangulation and replayed later in face order.
+// Nonnegative indices refer to original edges and ff edges, and cut face k of a chunk of faces is stored as -k-1.
+typedef Vector<int,3> DepthMerge;
+
 template<int up> static void
-retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &original_face_index, DepthUnionFind* const union_find,
+retriangulate_face(State& S, Scratch& scratch, Array<Vector<int,3>>& cut_faces, Array<int> &original_face_index, Array<DepthMerge>* const merges,
                    const int face, Vector<int,3> e, RawArray<int> interior,
                    RawArray<const FaceFaceEdge> ff_edges, RawArray<const int> ffs) {
   // Sort vertices in upwards order, keeping track of permutation parity.
@@ -982,7 +1046,8 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
 
   // Collect all of our vertices together into a contiguous numbering.  The boundary vertices form
   // two chains: one short from v.x to v.z, one long from v.x to v.y to v.z.
-  PolicyUp<up> P(S,face,save_e);
+  scratch.reset(ffs.size());
+  PolicyUp<up> P(S,scratch,face,save_e);
   auto& vertices = P.vertices;
   Range<IdIter<VertexId>> left_range, interior_range, right_range;
   VertexId vy;
@@ -990,7 +1055,7 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
     const auto ef01 = S.ef_vertices.range(e.z),
                ef02 = S.ef_vertices.range(e.y),
                ef12 = S.ef_vertices.range(e.x);
-    vertices.flat.resize(2+interior.size()+ef02.size()+ef01.size()+1+ef12.size()); // Same order as below
+    vertices.flat.resize(2+interior.size()+ef02.size()+ef01.size()+1+ef12.size(),uninit); // Same order as below
     int n = 0;
     vertices.flat[n++] = v.x;
     vertices.flat[n++] = v.z;
@@ -1025,20 +1090,21 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
   if (flip)
     swap(left_range,right_range);
 
-  // Invert vertices
-  Hashtable<int,VertexId> inv_vertices;
+  // Invert vertices.  Face-face edges end at loop or edge-face vertices, so the inverse map is a dense array.
+  auto& local = scratch.local;
   for (const int i : range(vertices.size())) {
     const VertexId v(i);
-    inv_vertices.set(vertices[v],v);
+    local[vertices[v]] = v;
   }
+  #define LOCAL(i) (assert(vertices[local[i]]==(i)),local[i])
 
   // Decompose into two monotone polygons and triangulate.  At this stage, we're ignoring
   // face-face edges and face-face-face vertices, similar to the separation between point
   // triangulation and constrained triangulation in Delaunay.
-  const auto mesh = new_<MutableTriangleTopology>();
+  const auto& mesh = scratch.mesh;
   mesh->add_vertices(vertices.size());
   const VertexId lo(0), hi(1);
-  Array<VertexId> stack;
+  auto& stack = scratch.stack;
   if (!interior.size()) {
     triangulate_monotone_polygon(P,mesh,lo,hi,left_range,right_range,stack);
   } else {
@@ -1051,12 +1117,14 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
     const int ffi = ffs[int(random_permute(ffs.size(),key+face,i))];
     const auto ff = ff_edges[ffi];
     add_constraint_edge<Policy>(P,mesh,P.constrained,
-                                inv_vertices.get(ff.nodes.x),
-                                inv_vertices.get(ff.nodes.y),
+                                LOCAL(ff.nodes.x),
+                                LOCAL(ff.nodes.y),
                                 Line({ff.faces.sum()-face,ff.faces.x!=face?ffi:-ffi-1}));
   }
+  #undef LOCAL
 
   // Copy mesh into cut_faces
+  const int first = cut_faces.size();
   for (const auto f : mesh->faces()) {
     const auto v = mesh->vertices(f);
     original_face_index.append(face);
@@ -1065,9 +1133,9 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
                          vertices[v.z]));
   }
 
-  if (union_find) {
+  if (merges) {
     // Absorb depth information at the start of all three original edges
-    const int base = union_find->extend(mesh->n_faces());
+    const int base = -first-1; // Cut face k is base-k
     const auto h = vec(mesh->halfedge(lo),
                        mesh->halfedge(vy),
                        mesh->halfedge(hi));
@@ -1075,7 +1143,7 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
     for (int i=0;i<3;i++) {
       const int j = (i+shift+3)%3,
                 k = (j+shift+3)%3;
-      union_find->merge(e[i],base+mesh->face(S.edges[e[i]].x==v[k] ? mesh->left(h[k]) : mesh->reverse(h[j])).id,0);
+      merges->append(vec(e[i],base-mesh->face(S.edges[e[i]].x==v[k] ? mesh->left(h[k]) : mesh->reverse(h[j])).id,0));
     }
 
     // Absorb depth information in the interior of the cut triangle.
@@ -1093,12 +1161,12 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
                       start = ff_edges[ff].nodes.x,
                       face2 = ff_edges[ff].faces.x == face ? ff_edges[ff].faces.y : ff_edges[ff].faces.x;
             const int ddepth = S.depth_weight[face2];
-            union_find->merge(base+f0.id,base+f1.id,flip?-ddepth:ddepth);
+            merges->append(vec(base-f0.id,base-f1.id,flip?-ddepth:ddepth));
             if (   start==P.vertices[mesh->src(e)]
                 || start==P.vertices[mesh->dst(e)])
-              union_find->merge(ff_base+ff,base+f0.id,flip?ddepth:0);
+              merges->append(vec(ff_base+ff,base-f0.id,flip?ddepth:0));
           } else {
-            union_find->merge(base+f0.id,base+f1.id,0);
+            merges->append(vec(base-f0.id,base-f1.id,0));
           }
         }
       }
@@ -1119,7 +1187,7 @@ static inline bool oriented_with_x(const P p0, const P p1, const P p2) {
 // Retriangulate each face w.r.t. the other faces which cut it
 static Tuple<Array<const FaceFaceFaceVertex>,Array<Vector<int,3>>,Array<int>>
 retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_weight, DepthUnionFind* const union_find,
-                   Nested<const EdgeFaceVertex> ef_vertices, RawArray<const FaceFaceEdge> ff_edges) {
+                   Nested<const EdgeFaceVertex> ef_vertices, RawArray<const FaceFaceEdge> ff_edges, const int threads) {
   GEODE_ASSERT(face_tree.leaf_size==1);
   const auto X = face_tree.X;
   const TriangleSoup& faces = face_tree.mesh;
@@ -1172,40 +1240,107 @@ retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_we
     union_find->extend(edges.elements.size()+ff_edges.size());
   }
 
-  // Retriangulate each face
-  Array<FaceFaceFaceVertex> fff_vertices;
-  Hashtable<Vector<int,3>,int> faces_to_fff;
-  State S(X,ef_vertices,fff_vertices,faces_to_fff,faces.elements,edges.elements,depth_weight);
-  for (const int f : range(faces.elements.size())) {
-    const auto v = faces.elements[f];
-
-    // Find the three edges bounding this face
-    const auto fe = face_edges[f]; // v01,v12,v20
-    Vector<int,3> e(fe.y,fe.z,fe.x); // e[3-i-j] connects v[i] and v[j]
-
-    // If the face isn't cut, there's very little to do
-    const auto interior = face_to_ef[f];
-    if (!interior.size() && !ef_vertices.size(e.x)
-                         && !ef_vertices.size(e.y)
-                         && !ef_vertices.size(e.z)) {
-      original_face_index.append(f);
-      cut_faces.append(v);
-      if (union_find) {
-        const int i = union_find->append();
-        union_find->merge(i,e.x,0);
-        union_find->merge(i,e.y,0);
-        union_find->merge(i,e.z,0);
+  // Retriangulate each face.  Faces are split into contiguous chunks which are retriangulated independently,
+  // each with its own table of face-face-face vertices and a record of its union-find merges.  Merging the
+  // chunks in face order numbers fff vertices by first appearance and replays the merges, so the result is
+  // identical to processing every face in one chunk, regardless of the number of threads.
+  struct Chunk {
+    Array<FaceFaceFaceVertex> fff_vertices;
+    Hashtable<Vector<int,3>,int> faces_to_fff;
+    Array<Vector<int,3>> cut_faces;
+    Array<int> original_face_index;
+    Array<DepthMerge> merges;
+  };
+  const int nf = faces.elements.size(),
+            nn = X.size()+ef_vertices.flat.size(),
+            chunks = threads>1 ? min(nf,32*threads) : 1;
+  vector<Chunk> results(chunks);
+  vector<Scratch> scratch(max(threads,1)); // One per thread, shared by that thread's chunks
+  parallel_for(chunks,threads,[&](const int c) {
+    IntervalScope scope; // Rounding mode is per thread
+    auto& R = results[c];
+    auto& work = scratch[omp_get_thread_num()];
+    if (work.local.size() < nn)
+      work.local.resize(nn,uninit);
+
+    // Presize the chunk's fff table, using the number of face-face edges in the chunk as a generous estimate
+    // of the number of face-face-face vertices.
+    const auto faces_c = partition_loop(nf,chunks,c);
+    R.faces_to_fff.initialize_new_table(face_to_ff.offsets[faces_c.hi]-face_to_ff.offsets[faces_c.lo]);
+    State S(X,ef_vertices,R.fff_vertices,R.faces_to_fff,faces.elements,edges.elements,depth_weight);
+    Array<DepthMerge>* const merges = union_find ? &R.merges : 0;
+    for (const int f : faces_c) {
+      const auto v = faces.elements[f];
+
+      // Find the three edges bounding this face
+      const auto fe = face_edges[f]; // v01,v12,v20
+      Vector<int,3> e(fe.y,fe.z,fe.x); // e[3-i-j] connects v[i] and v[j]
+
+      // If the face isn't cut, there's very little to do
+      const auto interior = face_to_ef[f];
+      if (!interior.size() && !ef_vertices.size(e.x)
+                           && !ef_vertices.size(e.y)
+                           && !ef_vertices.size(e.z)) {
+        R.original_face_index.append(f);
+        R.cut_faces.append(v);
+        if (merges) {
+          const int i = -R.cut_faces.size();
+          merges->append(vec(i,e.x,0));
+          merges->append(vec(i,e.y,0));
+          merges->append(vec(i,e.z,0));
+        }
+        continue;
       }
-      continue;
+
+      // Let the longest axis be the upwards sweep axis.  This choice can be made using inexact arithmetic,
+      // since it does not affect correctness.
+      const int up = bounding_box(X[v.x],X[v.y],X[v.z]).sizes().dominant_axis();
+      const auto ffs = face_to_ff[f];
+      if (up==0)      retriangulate_face<0>(S,work,R.cut_faces,R.original_face_index,merges,f,e,interior,ff_edges,ffs);
+      else if (up==1) retriangulate_face<1>(S,work,R.cut_faces,R.original_face_index,merges,f,e,interior,ff_edges,ffs);
+      else            retriangulate_face<2>(S,work,R.cut_faces,R.original_face_index,merges,f,e,interior,ff_edges,ffs);
     }
+  });
 
-    // Let the longest axis be the upwards sweep axis.  This choice can be made using inexact arithmetic,
-    // since it does not affect correctness.
-    const int up = bounding_box(X[v.x],X[v.y],X[v.z]).sizes().dominant_axis();
-    const auto ffs = face_to_ff[f];
-    if (up==0)      retriangulate_face<0>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
-    else if (up==1) retriangulate_face<1>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
-    else            retriangulate_face<2>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
+  // Merge chunks in face order, presizing everything so that the merge does not reallocate or rehash
+  int total_fff = 0, total_cut = 0;
+  for (const auto& R : results) {
+    total_fff += R.fff_vertices.size();
+    total_cut += R.cut_faces.size();
+  }
+  Array<FaceFaceFaceVertex> fff_vertices;
+  fff_vertices.preallocate(total_fff);
+  Hashtable<Vector<int,3>,int> faces_to_fff(total_fff);
+  cut_faces.preallocate(total_cut);
+  original_face_index.preallocate(total_cut);
+  Array<int> fff_map;
+  for (auto& R : results) {
+    // Renumber face-face-face vertices, keeping the first copy of vertices shared with earlier chunks
+    fff_map.resize(R.fff_vertices.size(),uninit);
+    for (const int i : range(R.fff_vertices.size())) {
+      const auto& fff = R.fff_vertices[i];
+      const int n = fff_vertices.size();
+      fff_map[i] = faces_to_fff.get_or_insert(fff.faces.sorted(),n);
+      if (fff_map[i] == n)
+        fff_vertices.append(fff);
+    }
+    for (auto f : R.cut_faces) {
+      for (int i=0;i<3;i++)
+        if (f[i] >= nn)
+          f[i] = nn+fff_map[f[i]-nn];
+      cut_faces.append(f);
+    }
+    original_face_index.extend(R.original_face_index);
+
+    // Replay depth merges now that the chunk's cut faces have union-find nodes
+    if (union_find) {
+      const int base = union_find->extend(R.cut_faces.size());
+      #define NODE(i) ((i)<0 ? base-(i)-1 : (i))
+      for (const auto& m : R.merges)
+        union_find->merge(NODE(m.x),NODE(m.y),m.z);
+      #undef NODE
+    }
+    R = Chunk();
   }
 
   // Add one union-find node at infinity, and fire rays until everything is connected to it
@@ -1369,19 +1504,23 @@ static void fix_loops(RawArray<Vector<int,3>> faces, Array<EV>& X, const int n,
 }
 
 Tuple<Ref<const TriangleSoup>,Array<EV>>
-exact_split_soup(const TriangleSoup& faces, Array<const EV> X, const int depth) {
+exact_split_soup(const TriangleSoup& faces, Array<const EV> X, const int depth, const int threads) {
   Array<int> depth_weight(faces.elements.size(), uninit);
   depth_weight.fill(1);
-  return exact_split_soup(faces, X, depth_weight, depth);
+  return exact_split_soup(faces, X, depth_weight, depth, threads);
 }
 
 Tuple<Ref<const TriangleSoup>,Array<EV>>
-exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int> depth_weight, const int depth) {
+exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int> depth_weight, const int depth,
+                 const int threads) {
+  GEODE_ASSERT(threads>=1);
   IntervalScope scope;
+  GEODE_EXACT_PHASES;
 
   // Find ef_vertices and ff_halfedges
+  GEODE_EXACT_PHASE("split_soup: intersect");
   const auto face_tree = new_<SimplexTree<EV,2>>(faces,X,1);
-  const auto A = intersection_simplices(face_tree);
+  const auto A = intersection_simplices(face_tree,threads);
   const auto ef_vertices = A.x;
   const auto ff_edges = A.y;
 
@@ -1391,12 +1530,14 @@ exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int>
     union_find.reset(new DepthUnionFind);
 
   // Retriangulate mesh and compute depths
-  const auto B = retriangulate_soup(face_tree,depth_weight,union_find.get(),ef_vertices,ff_edges);
+  GEODE_EXACT_PHASE("split_soup: retriangulate");
+  const auto B = retriangulate_soup(face_tree,depth_weight,union_find.get(),ef_vertices,ff_edges,threads);
   const auto fff_vertices = B.x;
   const auto cut_faces = B.y;
   const auto original_face_index = B.z;
 
   // If desired, extract cut faces at the right depth
+  GEODE_EXACT_PHASE("split_soup: extract");
   Array<Vector<int,3>> pruned_faces;
   if (union_find) {
     const int infinity = union_find->info.size()-1;
@@ -1428,16 +1569,17 @@ exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int>
   return tuple(new_<const TriangleSoup>(pruned_faces),Xs);
 }
 
-Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, Array<const int> depth_weight, const int depth) {
+Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, Array<const int> depth_weight, const int depth,
+                                                     const int threads) {
   const auto quant = quantizer(bounding_box(X));
-  const auto S = exact_split_soup(faces,amap(quant,X).copy(),depth_weight,depth);
+  const auto S = exact_split_soup(faces,amap(quant,X).copy(),depth_weight,depth,threads);
   return tuple(S.x,amap(quant.inverse,S.y).copy());
 }
 
-Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, const int depth) {
+Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, const int depth, const int threads) {
   Array<int> depth_weight(faces.elements.size(), uninit);
   depth_weight.fill(1);
-  return split_soup(faces, X, depth_weight, depth);
+  return split_soup(faces, X, depth_weight, depth, threads);
 }
 
 // A random looking polynomial vector field for testing purposes.  Doing this in numpy was terribly slow.
@@ -1483,15 +1625,15 @@ static double mesh_signature(const TriangleSoup& mesh, RawArray<const TV> X) {
 using namespace geode;
 
 void wrap_mesh_csg() {
-  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_fn)(const TriangleSoup&, Array<const Vector<double,3>>, const int);
-  GEODE_OVERLOADED_FUNCTION(split_fn,split_soup)
-  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_fn)(const TriangleSoup&, Array<const exact::Vec3>, const int);
-  GEODE_OVERLOADED_FUNCTION(exact_split_fn,exact_split_soup)
-
-  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_depth_fn)(const TriangleSoup&, Array<const Vector<double,3>>, Array<const int>, const int);
-  GEODE_OVERLOADED_FUNCTION_2(split_depth_fn,"split_soup_with_weight",split_soup)
-  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_depth_fn)(const TriangleSoup&, Array<const exact::Vec3>, Array<const int>, const int);
-  GEODE_OVERLOADED_FUNCTION_2(exact_split_depth_fn,"exact_split_soup_with_weight",exact_split_soup)
+  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_fn)(const TriangleSoup&, Array<const Vector<double,3>>, const int, const int);
+  GEODE_NOGIL_OVERLOADED_FUNCTION(split_fn,split_soup)
+  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_fn)(const TriangleSoup&, Array<const exact::Vec3>, const int, const int);
+  GEODE_NOGIL_OVERLOADED_FUNCTION(exact_split_fn,exact_split_soup)
+
+  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_depth_fn)(const TriangleSoup&, Array<const Vector<double,3>>, Array<const int>, const int, const int);
+  GEODE_NOGIL_OVERLOADED_FUNCTION_2(split_depth_fn,"split_soup_with_weight",split_soup)
+  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_depth_fn)(const TriangleSoup&, Array<const exact::Vec3>, Array<const int>, const int, const int);
+  GEODE_NOGIL_OVERLOADED_FUNCTION_2(exact_split_depth_fn,"exact_split_soup_with_weight",exact_split_soup)
 
   GEODE_FUNCTION(mesh_signature)
 }
@@ -8,17 +8,18 @@ namespace geode {
 // If depth is this, faces at all depths are returned
 const int all_depths = std::numeric_limits<int>::min();
 
-// Resolve all intersections between triangle soups.
+// Resolve all intersections between triangle soups.  With threads > 1, the edge-face intersection search
+// and face retriangulation run in parallel.  The result is identical for any number of threads.
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
-split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, const int depth);
+split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, const int depth, const int threads=1);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
-split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, Array<const int> depth_weights, const int depth);
+split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, Array<const int> depth_weights, const int depth, const int threads=1);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>>
-exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, const int depth);
+exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, const int depth, const int threads=1);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>>
-exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, Array<const int> depth_weights, const int depth);
+exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, Array<const int> depth_weights, const int depth, const int threads=1);
 
 }
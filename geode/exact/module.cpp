@@ -17,6 +17,7 @@ void wrap_exact() {
   GEODE_WRAP(mesh_csg)
   GEODE_WRAP(polynomial)
   GEODE_WRAP(irreducible)
+  GEODE_WRAP(exact_stats)
   typedef void(*void_fn_of_nested_circle_arcs)(Nested<CircleArc>);
   GEODE_OVERLOADED_FUNCTION(void_fn_of_nested_circle_arcs,reverse_arcs)
 }
@@ -130,6 +130,9 @@ template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<m
   const int n = X.size();
   if (verbose)
     cout << "perturbed_sign:\n  degree = "<<degree<<"\n  X = "<<X<<endl;
+#if GEODE_EXACT_STATS
+  auto& counts = exact_stats::counts(exact_stats::take_escalated());
+#endif
 
   // Check if the predicate is nonsingular without perturbation
   const auto Z = GEODE_RAW_ALLOCA(n,EV);
@@ -139,9 +142,16 @@ template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<m
       Z[i] = EV(to_exact(X[i].value()));
     const auto R = GEODE_RAW_ALLOCA(precision,mp_limb_t);
     predicate(R,Z);
-    if (const int sign = mpz_sign(R))
+    if (const int sign = mpz_sign(R)) {
+#if GEODE_EXACT_STATS
+      counts.exact++;
+#endif
       return sign>0;
+    }
   }
+#if GEODE_EXACT_STATS
+  counts.perturbed++;
+#endif
 
   // Check the first perturbation level with specialized code
   vector<Vector<ExactInt,m>> Y(n); // perturbations
@@ -329,6 +339,9 @@ template<class PerturbedT> bool perturbed_ratio(RawArray<Quantized> result, void
 
   if (verbose)
     cout << "perturbed_ratio:\n  degree = "<<degree<<"\n  X = "<<X<<endl;
+#if GEODE_EXACT_STATS
+  auto& counts = exact_stats::counts(exact_stats::take_escalated());
+#endif
 
   // Check if the ratio is nonsingular before perturbation
   const auto Z = GEODE_RAW_ALLOCA(n,EV);
@@ -339,10 +352,16 @@ template<class PerturbedT> bool perturbed_ratio(RawArray<Quantized> result, void
     const auto R = GEODE_RAW_ALLOCA((r+1)*precision,mp_limb_t).reshape(r+1,precision);
     ratio(R,Z);
     if (const int sign = mpz_sign(R[r])) {
+#if GEODE_EXACT_STATS
+      counts.exact++;
+#endif
       snap_divs(result,R,take_sqrt);
       return sign>0;
     }
   }
+#if GEODE_EXACT_STATS
+  counts.perturbed++;
+#endif
 
   // Check the first perturbation level with specialized code
   vector<Vector<ExactInt,m>> Y(n); // perturbations
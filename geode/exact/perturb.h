@@ -6,6 +6,7 @@
 #include <geode/exact/Exact.h>
 #include <geode/exact/Interval.h>
 #include <geode/exact/irreducible.h>
+#include <geode/exact/stats.h>
 #include <geode/structure/Tuple.h>
 #include <geode/utility/IRange.h>
 #include <geode/vector/Vector.h>
@@ -85,10 +86,13 @@ template<class F,class... Args> GEODE_ALWAYS_INLINE static inline bool perturbed
     inexact_assert_irreducible(f,degree,sizeof...(Args),typeid(F).name());
 
   // Evaluate with conservative interval arithmetic, hoping for a clear nonzero
-  if (const int s = weak_sign(F::eval(Vector<Interval,d>(args.value())...)))
+  if (const int s = weak_sign(F::eval(Vector<Interval,d>(args.value())...))) {
+    GEODE_EXACT_FILTERED(F);
     return s>0;
+  }
 
   // Fall back to exact integer evaluation with symbolic perturbation
+  GEODE_EXACT_ESCALATE(F);
   const PerturbedT X[sizeof...(Args)] = {args...};
   return perturbed_sign(f,degree,asarray(X));
 }
@@ -128,13 +132,16 @@ perturbed_construct(const int tolerance, const Args... args) {
 #if CHECK
       check = tuple(r,s);
 #else
-      if (small(r,tolerance))
+      if (small(r,tolerance)) {
+        GEODE_EXACT_FILTERED(F);
         return tuple(snap(r),s>0);
+      }
 #endif
     }
   }
 
   // If intervals fail, evaluate and round using symbolic perturbation
+  GEODE_EXACT_ESCALATE(F);
   const typename First<Args...>::type X[sizeof...(Args)] = {args...};
   Vector<Quantized,I::k> q;
   const bool s = perturbed_ratio(asarray(q),f,I::degree,asarray(X));
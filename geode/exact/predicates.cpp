@@ -35,6 +35,87 @@ IAL(3,0) IAL(3,1) IAL(3,2)
 template bool axis_less_degenerate<0,exact::ImplicitlyPerturbedCenter>(const exact::ImplicitlyPerturbedCenter,const exact::ImplicitlyPerturbedCenter);
 template bool axis_less_degenerate<1,exact::ImplicitlyPerturbedCenter>(const exact::ImplicitlyPerturbedCenter,const exact::ImplicitlyPerturbedCenter);
 
+// Static filters evaluate a predicate in floating point and return its sign if the result exceeds an a priori
+// error bound, or 0 if they are inconclusive.  The bounds are those of Shewchuk, "Adaptive precision floating-point
+// arithmetic and fast robust geometric predicates", with the unit roundoff doubled to 2^-52 so that they hold under
+// directed rounding, and thus both inside and outside an IntervalScope.  Quantized inputs are integers, so nothing
+// underflows.
+
+namespace {
+const double eps = std::numeric_limits<double>::epsilon();
+
+static inline int filter_sign(const double det, const double bound) {
+  return det>bound ? 1 : det<-bound ? -1 : 0;
+}
+
+struct TriangleOrientedFilter { static inline int eval(const P2 p0, const P2 p1, const P2 p2) {
+  const auto d1 = p1.value()-p0.value(),
+             d2 = p2.value()-p0.value();
+  const double l = d1.x*d2.y,
+               r = d1.y*d2.x;
+  return filter_sign(l-r,(3+16*eps)*eps*(abs(l)+abs(r)));
+}};
+
+struct IncircleFilter { static inline int eval(const P2 p0, const P2 p1, const P2 p2, const P2 p3) {
+  const auto a = p0.value()-p3.value(),
+             b = p1.value()-p3.value(),
+             c = p2.value()-p3.value();
+  const double bc = b.x*c.y, cb = c.x*b.y,
+               ca = c.x*a.y, ac = a.x*c.y,
+               ab = a.x*b.y, ba = b.x*a.y;
+  const double la = sqr_magnitude(a),
+               lb = sqr_magnitude(b),
+               lc = sqr_magnitude(c);
+  const double det = la*(bc-cb)+lb*(ca-ac)+lc*(ab-ba),
+               permanent = (abs(bc)+abs(cb))*la+(abs(ca)+abs(ac))*lb+(abs(ab)+abs(ba))*lc;
+  return filter_sign(det,(10+96*eps)*eps*permanent);
+}};
+
+struct TetrahedronOrientedFilter { static inline int eval(const P3 p0, const P3 p1, const P3 p2, const P3 p3) {
+  const auto a = p1.value()-p0.value(),
+             b = p2.value()-p0.value(),
+             c = p3.value()-p0.value();
+  const double byz = b.y*c.z, bzy = b.z*c.y,
+               bzx = b.z*c.x, bxz = b.x*c.z,
+               bxy = b.x*c.y, byx = b.y*c.x;
+  const double det = a.x*(byz-bzy)+a.y*(bzx-bxz)+a.z*(bxy-byx),
+               permanent = (abs(byz)+abs(bzy))*abs(a.x)+(abs(bzx)+abs(bxz))*abs(a.y)+(abs(bxy)+abs(byx))*abs(a.z);
+  return filter_sign(det,(7+56*eps)*eps*permanent);
+}};
+}
+
+// Decide a predicate with a static filter, then interval arithmetic, then exact arithmetic and symbolic
+// perturbation, counting the deciding stage if stats is nonnull.  Must be called within an IntervalScope.
+template<class F,class Filter,class... Args> static inline bool filtered_predicate(PredicateStats* stats, const Args... args) {
+  if (const int s = Filter::eval(args...)) {
+    if (stats) stats->filtered++;
+    GEODE_EXACT_FILTERED(F);
+    return s>0;
+  }
+  const int d = First<Args...>::type::m;
+  if (const int s = weak_sign(F::eval(Vector<Interval,d>(args.value())...))) {
+    if (stats) stats->interval++;
+    GEODE_EXACT_FILTERED(F);
+    return s>0;
+  }
+  if (stats) stats->exact++;
+  return perturbed_predicate<F>(args...);
+}
+
+// Apply filtered_predicate to each entry of a batch, under a single IntervalScope
+template<class F,class Filter,class PT,int k,class... I> GEODE_NEVER_INLINE static void
+batch_predicate(RawArray<const Vector<PT,k>> args, RawArray<bool> results, PredicateStats* stats, Types<I...>) {
+  GEODE_ASSERT(args.size()==results.size());
+  IntervalScope scope;
+  PredicateStats counts;
+  for (const int i : range(args.size())) {
+    const auto& a = args[i];
+    results[i] = filtered_predicate<F,Filter>(&counts,a[I::value]...);
+  }
+  if (stats)
+    *stats += counts;
+}
+
 // Polynomial predicates
 
 
@@ -43,7 +124,11 @@ struct TriangleOriented { template<class TV> static inline PredicateType<2,TV> e
   return edet(p1-p0,p2-p0);
 }};}
 bool triangle_oriented(const P2 p0, const P2 p1, const P2 p2) {
-  return perturbed_predicate<TriangleOriented>(p0,p1,p2);
+  return filtered_predicate<TriangleOriented,TriangleOrientedFilter>(0,p0,p1,p2);
+}
+
+void batch_triangle_oriented(RawArray<const Vector<P2,3>> triangles, RawArray<bool> results, PredicateStats* stats) {
+  batch_predicate<TriangleOriented,TriangleOrientedFilter>(triangles,results,stats,IRange<3>());
 }
 
 namespace {
@@ -126,7 +211,11 @@ struct Incircle { template<class TV> static inline PredicateType<4,TV> eval(cons
   return edet(ROW(d0),ROW(d1),ROW(d2));
 }};}
 bool incircle(const P2 p0, const P2 p1, const P2 p2, const P2 p3) {
-  return perturbed_predicate<Incircle>(p0,p1,p2,p3);
+  return filtered_predicate<Incircle,IncircleFilter>(0,p0,p1,p2,p3);
+}
+
+void batch_incircle(RawArray<const Vector<P2,4>> points, RawArray<bool> results, PredicateStats* stats) {
+  batch_predicate<Incircle,IncircleFilter>(points,results,stats,IRange<4>());
 }
 
 bool segments_intersect(const P2 a0, const P2 a1, const P2 b0, const P2 b1) {
@@ -141,7 +230,11 @@ struct TetrahedronOriented {
   }
 };}
 bool tetrahedron_oriented(const P3 p0, const P3 p1, const P3 p2, const P3 p3) {
-  return perturbed_predicate<TetrahedronOriented>(p0,p1,p2,p3);
+  return filtered_predicate<TetrahedronOriented,TetrahedronOrientedFilter>(0,p0,p1,p2,p3);
+}
+
+void batch_tetrahedron_oriented(RawArray<const Vector<P3,4>> tetrahedra, RawArray<bool> results, PredicateStats* stats) {
+  batch_predicate<TetrahedronOriented,TetrahedronOrientedFilter>(tetrahedra,results,stats,IRange<4>());
 }
 
 namespace {
@@ -155,13 +248,33 @@ bool segment_triangle_oriented(const P3 a0, const P3 a1, const P3 b0, const P3 b
   return perturbed_predicate<SegmentTriangleOriented>(a0,a1,b0,b1,b2);
 }
 
-bool segment_triangle_intersect(const P3 a0, const P3 a1, const P3 b0, const P3 b1, const P3 b2) {
-  if (   tetrahedron_oriented(a0,b0,b1,b2)
-      == tetrahedron_oriented(a1,b0,b1,b2))
+static inline bool segment_triangle_intersect(PredicateStats* stats, const P3 a0, const P3 a1,
+                                              const P3 b0, const P3 b1, const P3 b2) {
+  #define T(p0,p1,p2,p3) filtered_predicate<TetrahedronOriented,TetrahedronOrientedFilter>(stats,p0,p1,p2,p3)
+  if (   T(a0,b0,b1,b2)
+      == T(a1,b0,b1,b2))
     return false;
-  bool   c01 =  tetrahedron_oriented(a0,a1,b0,b1);
-  return c01 == tetrahedron_oriented(a0,a1,b1,b2)
-      && c01 == tetrahedron_oriented(a0,a1,b2,b0);
+  bool   c01 =  T(a0,a1,b0,b1);
+  return c01 == T(a0,a1,b1,b2)
+      && c01 == T(a0,a1,b2,b0);
+  #undef T
+}
+
+bool segment_triangle_intersect(const P3 a0, const P3 a1, const P3 b0, const P3 b1, const P3 b2) {
+  return segment_triangle_intersect(0,a0,a1,b0,b1,b2);
+}
+
+void batch_segment_triangle_intersect(RawArray<const Vector<P3,5>> segment_triangles, RawArray<bool> results,
+                                      PredicateStats* stats) {
+  GEODE_ASSERT(segment_triangles.size()==results.size());
+  IntervalScope scope;
+  PredicateStats counts;
+  for (const int i : range(segment_triangles.size())) {
+    const auto& s = segment_triangles[i];
+    results[i] = segment_triangle_intersect(&counts,s[0],s[1],s[2],s[3],s[4]);
+  }
+  if (stats)
+    *stats += counts;
 }
 
 namespace {
@@ -236,6 +349,36 @@ static void predicate_tests() {
     GEODE_ASSERT(!incircle(p0,p1,p2,p3));
     GEODE_ASSERT( incircle(p0,p1,p3,p2));
   }
+
+  // Batched predicates agree with the scalar versions.  Small coordinates make many entries degenerate.
+  typedef Vector<Quantized,3> QV3;
+  const int n = 1000;
+  Array<Vector<P2,4>> points(n,uninit);
+  Array<Vector<P3,5>> segments(n,uninit);
+  for (const int i : range(n)) {
+    const ExactInt b = i%2 ? exact::bound : 2;
+    for (const int j : range(4))
+      points[i][j] = P2(j,QV2(random->uniform<Vector<ExactInt,2>>(-b,b)));
+    for (const int j : range(5))
+      segments[i][j] = P3(j,QV3(random->uniform<Vector<ExactInt,3>>(-b,b)));
+  }
+  Array<bool> results(n,uninit);
+  PredicateStats stats;
+  Array<Vector<P2,3>> triangles(n,uninit);
+  for (const int i : range(n))
+    triangles[i] = vec(points[i][0],points[i][1],points[i][2]);
+  batch_triangle_oriented(triangles,results,&stats);
+  for (const int i : range(n))
+    GEODE_ASSERT(results[i]==triangle_oriented(points[i][0],points[i][1],points[i][2]));
+  batch_incircle(points,results,&stats);
+  for (const int i : range(n))
+    GEODE_ASSERT(results[i]==incircle(points[i][0],points[i][1],points[i][2],points[i][3]));
+  batch_segment_triangle_intersect(segments,results,&stats);
+  for (const int i : range(n)) {
+    const auto& s = segments[i];
+    GEODE_ASSERT(results[i]==segment_triangle_intersect(s[0],s[1],s[2],s[3],s[4]));
+  }
+  GEODE_ASSERT(stats.filtered && stats.exact && stats.total()>=3*n);
 }
 
 }
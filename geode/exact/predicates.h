@@ -2,6 +2,7 @@
 #pragma once
 
 #include <geode/exact/config.h>
+#include <geode/array/RawArray.h>
 #include <geode/vector/Vector.h>
 namespace geode {
 
@@ -94,6 +95,41 @@ GEODE_CORE_EXPORT GEODE_PURE bool triangles_oriented(const P3 a0, const P3 a1, c
                                                      const P3 b0, const P3 b1, const P3 b2,
                                                      const P3 c0, const P3 c1, const P3 c2);
 
+/*** Batched predicates ***/
+
+// Each predicate is decided by the first of three stages that succeeds: a static floating point filter, interval
+// arithmetic, or exact arithmetic with symbolic perturbation.  PredicateStats counts how often each stage decides.
+struct PredicateStats {
+  int64_t filtered, interval, exact;
+
+  PredicateStats()
+    : filtered(0), interval(0), exact(0) {}
+
+  int64_t total() const {
+    return filtered+interval+exact;
+  }
+
+  PredicateStats& operator+=(const PredicateStats& s) {
+    filtered += s.filtered;
+    interval += s.interval;
+    exact += s.exact;
+    return *this;
+  }
+};
+
+// Evaluate a predicate on each entry of an array, switching rounding modes only once for the whole batch.
+// If stats is nonnull, the stage counts for the batch are added to it.
+GEODE_CORE_EXPORT void batch_triangle_oriented(RawArray<const Vector<P2,3>> triangles, RawArray<bool> results,
+                                               PredicateStats* stats=0);
+GEODE_CORE_EXPORT void batch_incircle(RawArray<const Vector<P2,4>> points, RawArray<bool> results,
+                                      PredicateStats* stats=0);
+GEODE_CORE_EXPORT void batch_tetrahedron_oriented(RawArray<const Vector<P3,4>> tetrahedra, RawArray<bool> results,
+                                                  PredicateStats* stats=0);
+
+// Entries are (a0,a1,b0,b1,b2).  Each of the up to five underlying tetrahedron_oriented calls counts in stats.
+GEODE_CORE_EXPORT void batch_segment_triangle_intersect(RawArray<const Vector<P3,5>> segment_triangles,
+                                                        RawArray<bool> results, PredicateStats* stats=0);
+
 #undef P3
 #undef P2
 
@@ -0,0 +1,210 @@
+// Instrumentation for exact geometric computation
+
+#include <geode/exact/stats.h>
+#include <geode/python/stl.h>
+#include <geode/python/wrap.h>
+#include <geode/utility/range.h>
+#include <geode/utility/time.h>
+#include <mutex>
+#include <vector>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+namespace geode {
+
+using std::vector;
+
+#if GEODE_EXACT_STATS
+namespace exact_stats {
+namespace {
+
+struct Block {
+  vector<Counts> counts; // Indexed by predicate id
+  vector<double> times; // Indexed by phase id
+  int escalated;
+
+  Block()
+    : escalated(0) {}
+};
+
+struct Registry {
+  std::mutex mutex;
+  vector<string> predicates, phases;
+  Hashtable<string,int> predicate_ids, phase_ids;
+  vector<Block*> blocks; // Never freed, so that counts outlive their threads
+
+  Registry() {
+    predicates.push_back("other");
+    predicate_ids.set("other",0);
+  }
+};
+
+Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+GEODE_THREAD_LOCAL Block* thread_block_ = 0;
+
+Block& thread_block() {
+  if (!thread_block_) {
+    thread_block_ = new Block;
+    auto& R = registry();
+    std::lock_guard<std::mutex> lock(R.mutex);
+    R.blocks.push_back(thread_block_);
+  }
+  return *thread_block_;
+}
+
+// Demangle and drop namespaces that say nothing about the predicate
+string readable(const char* name) {
+  string s = name;
+#ifdef __GNUC__
+  int status;
+  if (char* d = abi::__cxa_demangle(name,0,0,&status)) {
+    s = d;
+    free(d);
+  }
+#endif
+  for (const string prefix : {"(anonymous namespace)::","geode::"})
+    for (size_t i;(i=s.find(prefix))!=string::npos;)
+      s.erase(i,prefix.size());
+  return s;
+}
+
+int register_name(vector<string>& names, Hashtable<string,int>& ids, const string& name) {
+  const int n = int(names.size());
+  const int id = ids.get_or_insert(name,n);
+  if (id == n)
+    names.push_back(name);
+  return id;
+}
+
+}
+
+int predicate_id(const char* name) {
+  const auto s = readable(name);
+  auto& R = registry();
+  std::lock_guard<std::mutex> lock(R.mutex);
+  return register_name(R.predicates,R.predicate_ids,s);
+}
+
+Counts& counts(const int id) {
+  auto& counts = thread_block().counts;
+  if (int(counts.size()) <= id)
+    counts.resize(id+1,Counts{0,0,0});
+  return counts[id];
+}
+
+void escalate(const int id) {
+  thread_block().escalated = id;
+}
+
+int take_escalated() {
+  auto& B = thread_block();
+  const int id = B.escalated;
+  B.escalated = 0;
+  return id;
+}
+
+Phases::Phases()
+  : phase(-1)
+  , start_time(0) {}
+
+Phases::~Phases() {
+  stop();
+}
+
+void Phases::start(const char* name) {
+  stop();
+  auto& R = registry();
+  {
+    std::lock_guard<std::mutex> lock(R.mutex);
+    phase = register_name(R.phases,R.phase_ids,name);
+  }
+  start_time = get_time();
+}
+
+void Phases::stop() {
+  if (phase < 0)
+    return;
+  auto& times = thread_block().times;
+  if (int(times.size()) <= phase)
+    times.resize(phase+1,0);
+  times[phase] += get_time()-start_time;
+  phase = -1;
+}
+
+}
+
+bool exact_stats_enabled() {
+  return true;
+}
+
+Hashtable<string,Vector<int64_t,3>> exact_predicate_counts() {
+  auto& R = exact_stats::registry();
+  std::lock_guard<std::mutex> lock(R.mutex);
+  Hashtable<string,Vector<int64_t,3>> result;
+  for (const int id : range(int(R.predicates.size()))) {
+    Vector<int64_t,3> sum;
+    for (const auto B : R.blocks)
+      if (id < int(B->counts.size())) {
+        const auto& c = B->counts[id];
+        sum += vec(c.filter,c.exact,c.perturbed);
+      }
+    if (sum.sum())
+      result.set(R.predicates[id],sum);
+  }
+  return result;
+}
+
+Hashtable<string,double> exact_phase_times() {
+  auto& R = exact_stats::registry();
+  std::lock_guard<std::mutex> lock(R.mutex);
+  Hashtable<string,double> result;
+  for (const int id : range(int(R.phases.size()))) {
+    double sum = 0;
+    for (const auto B : R.blocks)
+      if (id < int(B->times.size()))
+        sum += B->times[id];
+    result.set(R.phases[id],sum);
+  }
+  return result;
+}
+
+void clear_exact_stats() {
+  auto& R = exact_stats::registry();
+  std::lock_guard<std::mutex> lock(R.mutex);
+  for (const auto B : R.blocks) {
+    std::fill(B->counts.begin(),B->counts.end(),exact_stats::Counts{0,0,0});
+    std::fill(B->times.begin(),B->times.end(),0.);
+  }
+}
+
+#else
+
+bool exact_stats_enabled() {
+  return false;
+}
+
+Hashtable<string,Vector<int64_t,3>> exact_predicate_counts() {
+  return Hashtable<string,Vector<int64_t,3>>();
+}
+
+Hashtable<string,double> exact_phase_times() {
+  return Hashtable<string,double>();
+}
+
+void clear_exact_stats() {}
+
+#endif
+
+}
+using namespace geode;
+
+void wrap_exact_stats() {
+  GEODE_FUNCTION(exact_stats_enabled)
+  GEODE_FUNCTION(exact_predicate_counts)
+  GEODE_FUNCTION(exact_phase_times)
+  GEODE_FUNCTION(clear_exact_stats)
+}
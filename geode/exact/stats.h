@@ -0,0 +1,86 @@
+// Instrumentation for exact geometric computation
+//
+// If geode is configured with GEODE_EXACT_STATS, exact predicates count how they are decided, and the major exact
+// algorithms time their phases.  Otherwise all instrumentation compiles away, and the queries below return nothing.
+//
+// Each predicate has three counts:
+//   filter: decided by floating point filters (a static error bound or interval arithmetic)
+//   exact: decided by exact arithmetic, without perturbation
+//   perturbed: degenerate, so decided by symbolic perturbation
+// Constructions count likewise, with perturbed meaning a degenerate denominator.  Calls to perturbed_sign or
+// perturbed_ratio that do not come through perturbed_predicate or perturbed_construct appear under "other".
+//
+// Counters and timers are per thread, so instrumentation does not synchronize.  Queries sum over threads, and
+// should be made while no exact computation is running.
+#pragma once
+
+#include <geode/config.h>
+#include <geode/structure/Hashtable.h>
+#include <geode/vector/Vector.h>
+#include <string>
+#include <typeinfo>
+namespace geode {
+
+using std::string;
+
+// Was instrumentation compiled in?
+GEODE_CORE_EXPORT bool exact_stats_enabled();
+
+// Map from predicate name to (filter,exact,perturbed) counts
+GEODE_CORE_EXPORT Hashtable<string,Vector<int64_t,3>> exact_predicate_counts();
+
+// Map from phase name to total time in seconds
+GEODE_CORE_EXPORT Hashtable<string,double> exact_phase_times();
+
+// Zero all counters and timers
+GEODE_CORE_EXPORT void clear_exact_stats();
+
+#if GEODE_EXACT_STATS
+namespace exact_stats {
+
+struct Counts {
+  int64_t filter, exact, perturbed;
+};
+
+// Register a predicate by (possibly mangled) name, returning its id.  Id 0 is "other".
+GEODE_CORE_EXPORT int predicate_id(const char* name);
+
+template<class F> static inline int predicate_id() {
+  static const int id = predicate_id(typeid(F).name());
+  return id;
+}
+
+// This thread's counts for the given predicate
+GEODE_CORE_EXPORT Counts& counts(const int id);
+
+// Attribute the next perturbed_sign or perturbed_ratio call on this thread to the given predicate
+GEODE_CORE_EXPORT void escalate(const int id);
+
+// Called by perturbed_sign and perturbed_ratio: the predicate that escalated, or 0 if unknown
+GEODE_CORE_EXPORT int take_escalated();
+
+// Times consecutive phases of an algorithm.  Each start ends the previous phase, as does destruction.
+class Phases {
+  int phase;
+  double start_time;
+public:
+  GEODE_CORE_EXPORT Phases();
+  GEODE_CORE_EXPORT ~Phases();
+  GEODE_CORE_EXPORT void start(const char* name);
+  GEODE_CORE_EXPORT void stop();
+};
+
+}
+
+#define GEODE_EXACT_FILTERED(F) (exact_stats::counts(exact_stats::predicate_id<F>()).filter++)
+#define GEODE_EXACT_ESCALATE(F) exact_stats::escalate(exact_stats::predicate_id<F>())
+#define GEODE_EXACT_PHASES exact_stats::Phases _exact_phases
+#define GEODE_EXACT_PHASE(name) _exact_phases.start(name)
+#else
+#define GEODE_EXACT_FILTERED(F) ((void)0)
+#define GEODE_EXACT_ESCALATE(F) ((void)0)
+#define GEODE_EXACT_PHASES ((void)0)
+#define GEODE_EXACT_PHASE(name) ((void)0)
+#endif
+
+}
@@ -56,6 +56,37 @@ def test_delaunay(benchmark=False,cgal=False,origin=True,circle=False,constrain=
             if n>0 and mesh.n_faces!=nf:
               Log.write('expected %d faces, got %d'%(mesh.n_faces,nf))
 
+def test_delaunay_parallel():
+  def triangles(mesh):
+    tris = mesh.elements()
+    tris = asarray([roll(t,-argmin(t)) for t in tris])
+    return tris[lexsort(tris.T[::-1])]
+  random.seed(8121)
+  n = 3000
+  for name,X in ('gaussian',random.randn(n,2)),('grid',indices((60,n//60)).reshape(2,-1).T.astype(float)),\
+                ('duplicates',random.randint(10,size=(n,2)).astype(float)):
+    expected = triangles(delaunay_points(X))
+    for threads in 2,3,8:
+      with Log.scope('parallel delaunay %s, threads %d'%(name,threads)):
+        mesh = delaunay_points(X,validate=True,threads=threads)
+        mesh.assert_consistent(True)
+        assert all(triangles(mesh)==expected)
+
+def test_exact_stats():
+  clear_exact_stats()
+  random.seed(1731)
+  delaunay_points(random.randint(10,size=(200,2)).astype(float)) # Duplicates force symbolic perturbation
+  counts = exact_predicate_counts()
+  times = exact_phase_times()
+  if not exact_stats_enabled():
+    assert not counts and not times
+    return
+  filter,exact,perturbed = sum(asarray(list(counts.values())),axis=0)
+  assert filter>0 and perturbed>0
+  assert 'delaunay: triangulate' in times
+  clear_exact_stats()
+  assert not exact_predicate_counts()
+
 def draw_polygons(polys):
   import pylab
   for p,points in enumerate(polys):
@@ -76,7 +76,19 @@ def test_depth_weight():
     # the resulting mesh must have volume 1
     assert abs(result.volume(Xr)-1) < 1e-8
 
+def test_threads():
+  random.seed(7)
+  sphere,X0 = sphere_mesh(3)
+  mesh,X = merge_meshes([(sphere,X0),(sphere,X0+(.5,.2,.1)),(sphere,.7*X0-(.3,0,.2))])
+  for depth in None,0:
+    m1,X1 = split_soup(mesh,X,depth=depth)
+    for threads in 2,3,8:
+      m,Xt = split_soup(mesh,X,depth=depth,threads=threads)
+      assert all(m.elements==m1.elements)
+      assert all(Xt==X1)
+
 if __name__=='__main__':
   test_simple_triangulate()
   test_csg()
   test_depth_weight()
+  test_threads()
@@ -1,6 +1,7 @@
 // Cubic hinges based on Garg et al. 2007
 
 #include <geode/force/CubicHinges.h>
+#include <geode/force/ElementColoring.h>
 #include <geode/array/view.h>
 #include <geode/math/copysign.h>
 #include <geode/geometry/Triangle3d.h>
@@ -210,45 +211,43 @@ template<class TV> T CubicHinges<TV>::strain_rate(RawArray<const TV> V) const {
   return 0;
 }
 
-template<bool simple> static T energy_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, RawArray<const TV2> X) {
-  T sum = 0;
-  for (int b=0;b<bends.size();b++) {
+template<bool simple> static T energy_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, const int threads, RawArray<const TV2> X) {
+  return element_sum<T>(bends.size(),threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2;bends[b].get(i0,i1,i2);
     const TV2 x0 = X[i0], x1 = X[i1], x2 = X[i2],
               strain = I.c[0]*x0+I.c[1]*x1+I.c[2]*x2;
-    sum += I.base+.5*I.dot*sqr_magnitude(strain);
+    T sum = I.base+.5*I.dot*sqr_magnitude(strain);
     if (!simple)
       sum -= I.det*cross(x1-x0,x2-x1);
-  }
-  return sum;
+    return sum;
+  });
 }
 
-template<bool simple> static T energy_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, RawArray<const TV3> X) {
-  T sum = 0;
-  for (int b=0;b<bends.size();b++) {
+template<bool simple> static T energy_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, const int threads, RawArray<const TV3> X) {
+  return element_sum<T>(bends.size(),threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2,i3;bends[b].get(i0,i1,i2,i3);
     const TV3 x0 = X[i0], x1 = X[i1], x2 = X[i2], x3 = X[i3],
               strain = I.c[0]*x0+I.c[1]*x1+I.c[2]*x2+I.c[3]*x3;
-    sum += I.base+.5*I.dot*sqr_magnitude(strain);
+    T sum = I.base+.5*I.dot*sqr_magnitude(strain);
     if (!simple)
       sum += I.det*det(x2-x1,x3-x1,x0-x1);
-  }
-  return sum;
+    return sum;
+  });
 }
 
 template<class TV> T CubicHinges<TV>::elastic_energy() const {
-  return stiffness?stiffness*energy_helper<false>(bends,info,X):0;
+  return stiffness?stiffness*energy_helper<false>(bends,info,this->threads,X):0;
 }
 
 template<class TV> T CubicHinges<TV>::damping_energy(RawArray<const TV> V) const {
-  return damping?damping*energy_helper<true>(bends,info,V):0;
+  return damping?damping*energy_helper<true>(bends,info,this->threads,V):0;
 }
 
-template<bool simple> static void add_force_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, const T scale, RawArray<TV2> F, RawArray<const TV2> X) {
+template<bool simple> static void add_force_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, const ElementColoring& coloring, const int threads, const T scale, RawArray<TV2> F, RawArray<const TV2> X) {
   if (!scale) return;
-  for (int b=0;b<bends.size();b++) {
+  coloring.for_each(bends,threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2;bends[b].get(i0,i1,i2);
     const TV2 x0 = X[i0], x1 = X[i1], x2 = X[i2],
@@ -262,12 +261,12 @@ template<bool simple> static void add_force_helper(RawArray<const Vector<int,3>>
     F[i0] -= f0;
     F[i1] += f0+f2;
     F[i2] -= f2;
-  }
+  });
 }
 
-template<bool simple> static void add_force_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, const T scale, RawArray<TV3> F, RawArray<const TV3> X) {
+template<bool simple> static void add_force_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, const ElementColoring& coloring, const int threads, const T scale, RawArray<TV3> F, RawArray<const TV3> X) {
   if (!scale) return;
-  for (int b=0;b<bends.size();b++) {
+  coloring.for_each(bends,threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2,i3;bends[b].get(i0,i1,i2,i3);
     const TV3 x0 = X[i0], x1 = X[i1], x2 = X[i2], x3 = X[i3],
@@ -291,38 +290,38 @@ template<bool simple> static void add_force_helper(RawArray<const Vector<int,4>>
       F[i2] -= I.c[2]*stress+cross12;
       F[i3] -= I.c[3]*stress+cross20;
     }
-  }
+  });
 }
 
 template<class TV> void CubicHinges<TV>::add_elastic_force(RawArray<TV> F) const {
   GEODE_ASSERT(F.size()>=nodes_);
-  add_force_helper<false>(bends,info,stiffness,F,X);
+  add_force_helper<false>(bends,info,coloring,this->threads,stiffness,F,X);
 }
 
 template<class TV> void CubicHinges<TV>::add_damping_force(RawArray<TV> F, RawArray<const TV> V) const {
   GEODE_ASSERT(F.size()>=nodes_ && V.size()>=nodes_);
-  add_force_helper<true>(bends,info,damping,F,V);
+  add_force_helper<true>(bends,info,coloring,this->threads,damping,F,V);
 }
 
 template<> void CubicHinges<TV2>::add_elastic_differential(RawArray<TV> dF, RawArray<const TV> dX) const {
   // 2D forces are unconditionally linear, so we can always reuse force computation
   GEODE_ASSERT(dF.size()>=nodes_ && dX.size()>=nodes_);
   if (simple_hessian)
-    add_force_helper<true>(bends,info,stiffness,dF,dX);
+    add_force_helper<true>(bends,info,coloring,this->threads,stiffness,dF,dX);
   else
-    add_force_helper<false>(bends,info,stiffness,dF,dX);
+    add_force_helper<false>(bends,info,coloring,this->threads,stiffness,dF,dX);
 }
 
 template<> void CubicHinges<TV3>::add_elastic_differential(RawArray<TV> dF, RawArray<const TV> dX) const {
   GEODE_ASSERT(dF.size()>=nodes_ && dX.size()>=nodes_);
   if (simple_hessian) // In the simple case, the force is linear and the differential is easy
-    add_force_helper<true>(bends,info,stiffness,dF,dX);
+    add_force_helper<true>(bends,info,coloring,this->threads,stiffness,dF,dX);
   else { // Otherwise, we need custom code
     GEODE_ASSERT(dF.size()>=nodes_ && dX.size()>=nodes_);
     const T scale = stiffness;
     if (!scale) return;
     RawArray<const TV> X = this->X;
-    for (int b=0;b<bends.size();b++) {
+    coloring.for_each(bends,this->threads,[&](const int b) {
       const auto& I = info[b];
       int i0,i1,i2,i3;bends[b].get(i0,i1,i2,i3);
       const TV x0 = X[i0], x1 = X[i1], x2 = X[i2], x3 = X[i3];
@@ -342,7 +341,7 @@ template<> void CubicHinges<TV3>::add_elastic_differential(RawArray<TV> dF, RawA
       dF[i1] -= I.c[1]*dstress-dcross01-dcross12-dcross20;
       dF[i2] -= I.c[2]*dstress+dcross12;
       dF[i3] -= I.c[3]*dstress+dcross20;
-    }
+    });
   }
 }
 
@@ -354,9 +353,9 @@ structure(SolidMatrixStructure& structure) const {
         structure.add_entry(bend[i],bend[j]);
 }
 
-template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, const T scale, RawArray<const TV2> X, SolidMatrix<TV2>& matrix) {
+template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,3>> bends, RawArray<const CubicHinges<TV2>::Info> info, const ElementColoring& coloring, const int threads, const T scale, RawArray<const TV2> X, SolidMatrix<TV2>& matrix) {
   if (!scale) return;
-  for (int b=0;b<bends.size();b++) {
+  coloring.for_each(bends,threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2;bends[b].get(i0,i1,i2);
     const T quad = -scale*I.dot;
@@ -374,12 +373,12 @@ template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,
       matrix.add_entry(i0,i2,quad*I.c[0]*I.c[2]+anti);
       matrix.add_entry(i1,i2,quad*I.c[1]*I.c[2]-anti);
     }
-  }
+  });
 }
 
-template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, const T scale, RawArray<const TV3> X, SolidMatrix<TV3>& matrix) {
+template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,4>> bends, RawArray<const CubicHinges<TV3>::Info> info, const ElementColoring& coloring, const int threads, const T scale, RawArray<const TV3> X, SolidMatrix<TV3>& matrix) {
   if (!scale) return;
-  for (int b=0;b<bends.size();b++) {
+  coloring.for_each(bends,threads,[&](const int b) {
     const auto& I = info[b];
     int i0,i1,i2,i3;bends[b].get(i0,i1,i2,i3);
     const T quad = -scale*I.dot;
@@ -404,35 +403,35 @@ template<bool simple> static void add_gradient_helper(RawArray<const Vector<int,
       matrix.add_entry(i1,i3,quad*I.c[1]*I.c[3]+cross_product_matrix(x0-x2)); //  e4
       matrix.add_entry(i2,i3,quad*I.c[2]*I.c[3]+cross_product_matrix(x1-x0)); // -e2
     }
-  }
+  });
 }
 
 template<class TV> void CubicHinges<TV>::
 add_elastic_gradient(SolidMatrix<TV>& matrix) const {
   GEODE_ASSERT(matrix.size()>=nodes_);
   if (simple_hessian)
-    add_gradient_helper<true>(bends,info,stiffness,X,matrix);
+    add_gradient_helper<true>(bends,info,coloring,this->threads,stiffness,X,matrix);
   else
-    add_gradient_helper<false>(bends,info,stiffness,X,matrix);
+    add_gradient_helper<false>(bends,info,coloring,this->threads,stiffness,X,matrix);
 }
 
 template<class TV> void CubicHinges<TV>::
 add_damping_gradient(SolidMatrix<TV>& matrix) const {
   GEODE_ASSERT(matrix.size()>=nodes_);
-  add_gradient_helper<true>(bends,info,damping,X,matrix);
+  add_gradient_helper<true>(bends,info,coloring,this->threads,damping,X,matrix);
 }
 
 template<class TV> void CubicHinges<TV>::add_elastic_gradient_block_diagonal(RawArray<SymmetricMatrix<T,d+1>> dFdX) const {
   GEODE_ASSERT(dFdX.size()>=nodes_);
   if (!stiffness) return;
   const T scale = stiffness;
-  for (int b=0;b<bends.size();b++) {
+  coloring.for_each(bends,this->threads,[&](const int b) {
     const auto bend = bends[b];
     const auto& I = info[b];
     const T quad = scale*I.dot;
     for (int i=0;i<bend.size();i++)
       dFdX[bend[i]] -= quad*sqr(I.c[i]);
-  }
+  });
 }
 
 template class CubicHinges<TV2>;
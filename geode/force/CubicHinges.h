@@ -1,6 +1,7 @@
 // Cubic hinges based on Garg et al. 2007
 #pragma once
 
+#include <geode/force/ElementColoring.h>
 #include <geode/force/Force.h>
 #include <geode/mesh/forward.h>
 #include <geode/vector/forward.h>
@@ -34,6 +35,7 @@ private:
   const int nodes_;
   const Array<Info> info;
   Array<const TV> X;
+  ElementColoring coloring;
 
 protected:
   CubicHinges(Array<const Vector<int,d+2>> bends, RawArray<const T> angles, RawArray<const TV> X);
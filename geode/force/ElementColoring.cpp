@@ -0,0 +1,44 @@
+//#####################################################################
+// Class ElementColoring
+//#####################################################################
+#include <geode/force/ElementColoring.h>
+#include <geode/mesh/incident.h>
+namespace geode {
+
+Nested<const int> color_elements(RawArray<const int> nodes, const int degree) {
+  GEODE_ASSERT(degree>0 && nodes.size()%degree==0);
+  const int n = nodes.size()/degree;
+  GEODE_ASSERT(!nodes.size() || nodes.min()>=0);
+  const auto incident = incident_lists(nodes,nodes.size()?nodes.max()+1:0,1,[=](const int k) { return k/degree; });
+
+  // Give each element the smallest color not used by an earlier element sharing one of its nodes
+  Array<int> color(n,uninit);
+  Array<int> used; // used[c]==t if color c is taken by a neighbor of element t
+  Array<int> counts;
+  for (int t=0;t<n;t++) {
+    for (int a=0;a<degree;a++)
+      for (const int s : incident[nodes[degree*t+a]]) {
+        if (s>=t)
+          break;
+        used[color[s]] = t;
+      }
+    int c = 0;
+    while (c<used.size() && used[c]==t)
+      c++;
+    if (c==used.size()) {
+      used.append(-1);
+      counts.append(0);
+    }
+    color[t] = c;
+    counts[c]++;
+  }
+
+  // List the elements of each color in order
+  Nested<int> colors(counts,uninit);
+  Array<int> next = colors.offsets.slice(0,counts.size()).copy();
+  for (int t=0;t<n;t++)
+    colors.flat[next[color[t]]++] = t;
+  return colors;
+}
+
+}
@@ -0,0 +1,93 @@
+//#####################################################################
+// Class ElementColoring
+//#####################################################################
+//
+// Parallel element loops for force assembly.
+//
+// Forces scatter per element contributions into per node arrays.  To do this on several threads without
+// races or per thread buffers, elements are greedily colored so that no two elements of the same color
+// share a node.  Colors run one after another, and the elements within a color run in parallel.  Each node
+// therefore receives its contributions in color order, which is the same for any number of threads > 1:
+// parallel force assembly is deterministic, though it rounds differently than the serial element order.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/array/Nested.h>
+#include <geode/array/view.h>
+#include <geode/utility/openmp.h>
+#include <geode/utility/range.h>
+#include <geode/vector/Vector.h>
+#include <mutex>
+namespace geode {
+
+// Greedily color the elements given by consecutive runs of degree nodes, visiting elements in order.
+// colors[c] lists the elements of color c in increasing order.
+GEODE_CORE_EXPORT Nested<const int> color_elements(RawArray<const int> nodes, const int degree);
+
+// Call body(i) for i in [0,n), where different i write disjoint data.  Runs in order if threads<=1.
+template<class Body> static void independent_for(const int n, const int threads, const Body& body) {
+  const int blocks = threads>1 ? min(4*threads,(n+63)/64) : 1;
+  if (blocks<=1)
+    for (int i=0;i<n;i++)
+      body(i);
+  else
+    parallel_for(blocks,threads,[&](const int b) {
+      for (const int i : partition_loop(n,blocks,b))
+        body(i);
+    });
+}
+
+// Sum body(i) for i in [0,n).  With threads>1, partial sums are taken over fixed size blocks and added in
+// order, so the result does not depend on the number of threads.
+template<class T,class Body> static T element_sum(const int n, const int threads, const Body& body) {
+  T sum = 0;
+  if (threads<=1) {
+    for (int i=0;i<n;i++)
+      sum += body(i);
+    return sum;
+  }
+  const int block = 1024,
+            blocks = (n+block-1)/block;
+  Array<T> partial(blocks,uninit);
+  independent_for(blocks,threads,[&](const int b) {
+    T sum = 0;
+    for (int i=b*block;i<min(n,(b+1)*block);i++)
+      sum += body(i);
+    partial[b] = sum;
+  });
+  for (const T p : partial)
+    sum += p;
+  return sum;
+}
+
+class ElementColoring {
+  mutable std::once_flag once;
+  mutable Nested<const int> colors_;
+public:
+  ElementColoring() {}
+
+  // Colors of the given elements, computed on first use.  The elements must be the same on every call.
+  template<class TA> const Nested<const int>& colors(const TA& elements) const {
+    std::call_once(once,[&]() { colors_ = color_elements(scalar_view(elements),TA::Element::m); });
+    GEODE_ASSERT(colors_.total_size()==elements.size());
+    return colors_;
+  }
+
+  // Call body(t) for each element t.  With threads<=1 elements run in order; otherwise they run in parallel
+  // by color, and body may scatter into the nodes of element t.
+  template<class TA,class Body> void for_each(const TA& elements, const int threads, const Body& body) const {
+    if (threads<=1) {
+      for (int t=0;t<elements.size();t++)
+        body(t);
+      return;
+    }
+    const auto& colors = this->colors(elements);
+    for (const int c : range(colors.size())) {
+      const auto color = colors[c];
+      independent_for(color.size(),threads,[&](const int i) { body(color[i]); });
+    }
+  }
+};
+
+}
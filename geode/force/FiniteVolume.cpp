@@ -4,6 +4,7 @@
 #include <geode/force/IsotropicConstitutiveModel.h>
 #include <geode/force/DiagonalizedStressDerivative.h>
 #include <geode/force/DiagonalizedIsotropicStressDerivative.h>
+#include <geode/force/ElementColoring.h>
 #include <geode/force/PlasticityModel.h>
 #include <geode/force/StrainMeasure.h>
 #include <geode/structure/Hashtable.h>
@@ -74,7 +75,8 @@ template<class TV,int d> void FiniteVolume<TV,d>::update_position(Array<const TV
   V.clear();
   if (anisotropic)
     V.resize(strain->elements.size(),uninit);
-  for (int t=0;t<strain->elements.size();t++) {
+  // Plasticity models may not be thread safe, so only parallelize the elastic case
+  independent_for(strain->elements.size(),plasticity?1:this->threads,[&](const int t) {
     Matrix<T,d> V_;
     if (plasticity) {
       Matrix<T,m,d> F = strain->F(X,t);
@@ -93,31 +95,27 @@ template<class TV,int d> void FiniteVolume<TV,d>::update_position(Array<const TV
     if (anisotropic) anisotropic->update_position(Fe_hat[t],V_,t);
     else isotropic->update_position(Fe_hat[t],t);
     if (anisotropic) V[t] = V_;
-  }
+  });
 }
 
 template<class TV,int d> typename TV::Scalar FiniteVolume<TV,d>::elastic_energy() const {
-  T energy = 0;
-  if (anisotropic)
-    for (int t=0;t<strain->elements.size();t++)
-      energy -= Be_scales[t]*anisotropic->elastic_energy(Fe_hat[t],V[t],t);
-  else
-    for (int t=0;t<strain->elements.size();t++)
-      energy -= Be_scales[t]*isotropic->elastic_energy(Fe_hat[t],t);
-  return energy;
+  return -element_sum<T>(strain->elements.size(),this->threads,[&](const int t) {
+    return Be_scales[t]*(anisotropic ? anisotropic->elastic_energy(Fe_hat[t],V[t],t)
+                                     : isotropic->elastic_energy(Fe_hat[t],t));
+  });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_force(RawArray<TV> F) const {
   if (anisotropic)
-    for (int t=0;t<strain->elements.size();t++) {
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
       Matrix<T,m,d> forces = in_plane<d>(U[t])*anisotropic->P_From_Strain(Fe_hat[t],V[t],Be_scales[t],t).times_transpose(De_inverse_hat[t]);
       strain->distribute_force(F,t,forces);
-    }
+    });
   else
-    for (int t=0;t<strain->elements.size();t++) {
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
       Matrix<T,m,d> forces = in_plane<d>(U[t])*isotropic->P_From_Strain(Fe_hat[t],Be_scales[t],t).times_transpose(De_inverse_hat[t]);
       strain->distribute_force(F,t,forces);
-    }
+    });
 }
 
 template<int m,int d> static inline typename enable_if_c<m==d,const DiagonalizedIsotropicStressDerivative<T,m>&>::type
@@ -141,17 +139,17 @@ template<class TV,int d> void FiniteVolume<TV,d>::update_stress_derivatives() co
   if (anisotropic && !anisotropic->use_isotropic_stress_derivative()) {
     dP_dFe.clear();
     dP_dFe.resize(strain->elements.size(),uninit);
-    for (int t=0;t<strain->elements.size();t++) {
+    independent_for(strain->elements.size(),this->threads,[&](const int t) {
       dP_dFe[t] = anisotropic->stress_derivative(Fe_hat[t],V[t],t);
       if (definite) dP_dFe[t].enforce_definiteness();
-    }
+    });
   } else {
     dPi_dFe.clear();
     dPi_dFe.resize(strain->elements.size(),uninit);
-    for (int t=0;t<strain->elements.size();t++) {
+    independent_for(strain->elements.size(),this->threads,[&](const int t) {
       dPi_dFe[t] = add_out_of_plane<m>(*isotropic,Fe_hat[t],model->isotropic_stress_derivative(Fe_hat[t],t),t);
       if(definite) dPi_dFe[t].enforce_definiteness();
-    }
+    });
   }
   stress_derivatives_valid = true;
 }
@@ -159,27 +157,27 @@ template<class TV,int d> void FiniteVolume<TV,d>::update_stress_derivatives() co
 template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_differential(RawArray<TV> dF, RawArray<const TV> dX) const {
   update_stress_derivatives();
   if (anisotropic && !anisotropic->use_isotropic_stress_derivative())
-    for (int t=0;t<strain->elements.size();t++) {
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
       Matrix<T,m,d> dDs = strain->Ds(dX,t),
                     Up = in_plane<d>(U[t]),
                     dG = Up*(Be_scales[t]*dP_dFe[t].differential(Up.transpose_times(dDs)*De_inverse_hat[t]).times_transpose(De_inverse_hat[t]));
       strain->distribute_force(dF,t,dG);
-    }
+    });
   else
-    for (int t=0;t<strain->elements.size();t++) {
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
       Matrix<T,m,d> dDs = strain->Ds(dX,t),
                     dG = U[t]*(Be_scales[t]*dPi_dFe[t].differential(U[t].transpose_times(dDs)*De_inverse_hat[t]).times_transpose(De_inverse_hat[t]));
       strain->distribute_force(dF,t,dG);
-    }
+    });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_gradient_block_diagonal(RawArray<SymmetricMatrix<T,m>> dFdX) const {
   update_stress_derivatives();
   if (anisotropic && !anisotropic->use_isotropic_stress_derivative())
     GEODE_NOT_IMPLEMENTED();
-  else {
-    Matrix<T,m> dGdD[d][d];
-    for (int t=0;t<strain->elements.size();t++) {
+  else
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
+      Matrix<T,m> dGdD[d][d];
       for (int i=0;i<d;i++)
         for(int j=0;j<m;j++) {
           Matrix<T,m,d> dDs;
@@ -196,17 +194,16 @@ template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_gradient_block_dia
         for (int j=0;j<d;j++)
           sum += assume_symmetric(dGdD[i][j]);
       dFdX[nodes[0]] += sum;
-    }
-  }
+    });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_gradient(SolidMatrix<TV>& matrix) const {
   update_stress_derivatives();
   if (anisotropic && !anisotropic->use_isotropic_stress_derivative())
     GEODE_NOT_IMPLEMENTED();
-  else {
-    Matrix<T,m> dGdD[d+1][d+1];
-    for (int t=0;t<strain->elements.size();t++) {
+  else
+    coloring.for_each(strain->elements,this->threads,[&](const int t) {
+      Matrix<T,m> dGdD[d+1][d+1];
       for (int i=0;i<d;i++)
         for (int j=0;j<m;j++) {
           Matrix<T,m,d> dDs;
@@ -228,31 +225,28 @@ template<class TV,int d> void FiniteVolume<TV,d>::add_elastic_gradient(SolidMatr
       for (int j=0;j<d+1;j++)
         for (int i=j;i<d+1;i++)
           matrix.add_entry(nodes[i],nodes[j],dGdD[i][j]);
-    }
-  }
+    });
 }
 
 template<class TV,int d> typename TV::Scalar FiniteVolume<TV,d>::damping_energy(RawArray<const TV> V) const {
-  T energy = 0;
-  for (int t=0;t<strain->elements.size();t++) {
+  return -element_sum<T>(strain->elements.size(),this->threads,[&](const int t) {
     Matrix<T,d> Fe_dot_hat = in_plane<d>(U[t]).transpose_times(strain->Ds(V,t))*De_inverse_hat[t];
-    energy -= Be_scales[t]*model->damping_energy(Fe_hat[t],Fe_dot_hat,t);
-  }
-  return energy;
+    return Be_scales[t]*model->damping_energy(Fe_hat[t],Fe_dot_hat,t);
+  });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_damping_force(RawArray<TV> F,RawArray<const TV> V) const {
-  for (int t=0;t<strain->elements.size();t++) {
+  coloring.for_each(strain->elements,this->threads,[&](const int t) {
     Matrix<T,m,d> Up = in_plane<d>(U[t]);
     Matrix<T,d> Fe_dot_hat = Up.transpose_times(strain->Ds(V,t))*De_inverse_hat[t];
     Matrix<T,m,d> forces = Up*model->P_From_Strain_Rate(Fe_hat[t],Fe_dot_hat,Be_scales[t],t).times_transpose(De_inverse_hat[t]);
     strain->distribute_force(F,t,forces);
-  }
+  });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_damping_gradient(SolidMatrix<TV>& matrix) const {
-  Matrix<T,m> dGdD[d+1][d+1];
-  for (int t=0;t<strain->elements.size();t++) {
+  coloring.for_each(strain->elements,this->threads,[&](const int t) {
+    Matrix<T,m> dGdD[d+1][d+1];
     Matrix<T,m,d> Up = in_plane<d>(U[t]);
     for (int i=0;i<d;i++)
       for (int j=0;j<m;j++) {
@@ -276,7 +270,7 @@ template<class TV,int d> void FiniteVolume<TV,d>::add_damping_gradient(SolidMatr
     for (int j=0;j<d+1;j++)
       for (int i=j;i<d+1;i++)
         matrix.add_entry(nodes[i],nodes[j],dGdD[i][j]);
-  }
+  });
 }
 
 template<class TV,int d> void FiniteVolume<TV,d>::add_frequency_squared(RawArray<T> frequency_squared) const {
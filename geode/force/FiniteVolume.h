@@ -3,6 +3,7 @@
 //#####################################################################
 #pragma once
 
+#include <geode/force/ElementColoring.h>
 #include <geode/force/Force.h>
 #include <geode/python/Ptr.h>
 #include <geode/vector/Matrix.h>
@@ -34,6 +35,7 @@ protected:
   mutable bool stress_derivatives_valid,definite;
   mutable Array<DiagonalizedIsotropicStressDerivative<T,m,d>> dPi_dFe;
   mutable Array<DiagonalizedStressDerivative<T,d>> dP_dFe;
+  ElementColoring coloring;
 public:
 
 protected:
@@ -12,7 +12,8 @@ template<> GEODE_DEFINE_TYPE(Force<Vector<T,2>>)
 template<> GEODE_DEFINE_TYPE(Force<Vector<T,3>>)
 template<class TV> const int Force<TV>::d;
 
-template<class TV> Force<TV>::Force() {}
+template<class TV> Force<TV>::Force()
+  : threads(1) {}
 
 template<class TV> Force<TV>::~Force() {}
 
@@ -34,6 +35,7 @@ template<int d> static void wrap_helper() {
   typedef Force<Vector<T,d>> Self;
   Class<Self>(d==2?"Force2d":"Force3d")
     .GEODE_FIELD(d)
+    .GEODE_FIELD(threads)
     .GEODE_METHOD(nodes)
     .GEODE_METHOD(update_position)
     .GEODE_METHOD(elastic_energy)
@@ -19,6 +19,11 @@ public:
   typedef typename TV::Scalar T;
   static const int d = TV::m;
 
+  // Threads used by forces that support parallel assembly.  For threads>1, forces, differentials, and
+  // gradients are summed in a fixed element order (see ElementColoring), so results do not depend on
+  // the number of threads.  The default of 1 keeps the serial element order.
+  int threads;
+
 protected:
   GEODE_CORE_EXPORT Force();
 public:
@@ -1,4 +1,5 @@
 #include <geode/force/LinearBendingElements.h>
+#include <geode/force/ElementColoring.h>
 #include <geode/mesh/SegmentSoup.h>
 #include <geode/mesh/TriangleSoup.h>
 #include <geode/utility/Log.h>
@@ -104,8 +105,37 @@ template<class TV> typename TV::Scalar LinearBendingElements<TV>::strain_rate(Ra
   return 0;
 }
 
-template<class TV> static T energy_helper(const SparseMatrix& A,RawArray<const TV> X) {
+// The strict lower triangle of A as (row,flat index) pairs in each column, built on first parallel use
+template<class TV> Nested<const Vector<int,2>> LinearBendingElements<TV>::lower() const {
+  if (this->threads<=1)
+    return Nested<const Vector<int,2>>();
+  std::call_once(lower_once,[&]() {
+    const int n = A->rows();
+    GEODE_ASSERT(A->columns()<=n);
+    Array<int> counts(n);
+    for (int p=0;p<n;p++)
+      for (const int q : A->J[p].slice(1,A->J.size(p)))
+        counts[q]++;
+    Nested<Vector<int,2>> lower(counts,uninit);
+    Array<int> next = lower.offsets.slice(0,n).copy();
+    for (int p=0;p<n;p++)
+      for (int a=1;a<A->J.size(p);a++)
+        lower.flat[next[A->J(p,a)]++] = vec(p,A->J.offsets[p]+a);
+    lower_ = lower;
+  });
+  return lower_;
+}
+
+template<class TV> static T energy_helper(const SparseMatrix& A,const int threads,RawArray<const TV> X) {
   GEODE_ASSERT(A.rows()==X.size());
+  if (threads>1)
+    return element_sum<T>(A.rows(),threads,[&](const int p) {
+      RawArray<const int> J = A.J[p];
+      T energy = J.size() ? A.A(p,0)*sqr_magnitude(X[p])/2 : 0;
+      for (int a=1;a<J.size();a++)
+        energy += A.A(p,a)*dot(X[p],X[J[a]]);
+      return energy;
+    });
   T diagonal = 0, offdiagonal = 0;
   for (int p=0;p<A.rows();p++) {
     RawArray<const int> J = A.J[p];
@@ -118,12 +148,27 @@ template<class TV> static T energy_helper(const SparseMatrix& A,RawArray<const T
 }
 
 template<class TV> typename TV::Scalar LinearBendingElements<TV>::elastic_energy() const {
-  return stiffness?stiffness*energy_helper<TV>(*A,X):0;
+  return stiffness?stiffness*energy_helper<TV>(*A,this->threads,X):0;
 }
 
-template<class TV> static void add_force_helper(const SparseMatrix& A,const T scale,RawArray<TV> F,RawArray<const TV> X) {
+// With threads>1, each row gathers its lower triangular entries from the cached transpose instead of scattering
+template<class TV> static void add_force_helper(const SparseMatrix& A,const int threads,Nested<const Vector<int,2>> lower,const T scale,RawArray<TV> F,RawArray<const TV> X) {
   GEODE_ASSERT(A.rows()<=X.size());
   if (!scale) return;
+  if (threads>1) {
+    independent_for(A.rows(),threads,[&](const int p) {
+      RawArray<const int> J = A.J[p];
+      TV f;
+      if (J.size())
+        f = A.A(p,0)*X[p];
+      for (int a=1;a<J.size();a++)
+        f += A.A(p,a)*X[J[a]];
+      for (const auto& qk : lower[p])
+        f += A.A.flat[qk.y]*X[qk.x];
+      F[p] -= scale*f;
+    });
+    return;
+  }
   for (int p=0;p<A.rows();p++) {
     RawArray<const int> J = A.J[p];
     if (J.size())
@@ -138,27 +183,28 @@ template<class TV> static void add_force_helper(const SparseMatrix& A,const T sc
 }
 
 template<class TV> void LinearBendingElements<TV>::add_elastic_force(RawArray<TV> F) const {
-  add_force_helper<TV>(*A,stiffness,F,X);
+  add_force_helper<TV>(*A,this->threads,lower(),stiffness,F,X);
 }
 
 template<class TV> void LinearBendingElements<TV>::add_elastic_differential(RawArray<TV> dF,RawArray<const TV> dX) const {
-  add_force_helper<TV>(*A,stiffness,dF,dX);
+  add_force_helper<TV>(*A,this->threads,lower(),stiffness,dF,dX);
 }
 
 template<class TV> void LinearBendingElements<TV>::add_elastic_gradient_block_diagonal(RawArray<SymmetricMatrix<T,d>> dFdX) const {
   GEODE_ASSERT(A->rows()<=dFdX.size());
   if (!stiffness) return;
-  for (int p=0;p<A->rows();p++)
+  independent_for(A->rows(),this->threads,[&](const int p) {
     if (A->A.size(p))
       dFdX[p] -= stiffness*A->A(p,0);
+  });
 }
 
 template<class TV> typename TV::Scalar LinearBendingElements<TV>::damping_energy(RawArray<const TV> V) const {
-  return damping?damping*energy_helper<TV>(*A,V):0;
+  return damping?damping*energy_helper<TV>(*A,this->threads,V):0;
 }
 
 template<class TV> void LinearBendingElements<TV>::add_damping_force(RawArray<TV> F,RawArray<const TV> V) const {
-  add_force_helper<TV>(*A,damping,F,V);
+  add_force_helper<TV>(*A,this->threads,lower(),damping,F,V);
 }
 
 template<class TV> void LinearBendingElements<TV>::structure(SolidMatrixStructure& structure) const {
@@ -169,25 +215,26 @@ template<class TV> void LinearBendingElements<TV>::structure(SolidMatrixStructur
   }
 }
 
-template<class TV> void add_gradient_helper(const SparseMatrix& A,const T scale,SolidMatrix<TV>& matrix) {
+template<class TV> void add_gradient_helper(const SparseMatrix& A,const int threads,const T scale,SolidMatrix<TV>& matrix) {
   GEODE_ASSERT(A.rows()<=matrix.size());
   if (!scale) return;
   T minus_scale = -scale;
-  for (int p=0;p<A.rows();p++) {
+  // Each row of A touches only the same row of the upper triangular matrix
+  independent_for(A.rows(),threads,[&](const int p) {
     RawArray<const int> J = A.J[p];
     if (J.size())
       matrix.add_entry(p,minus_scale*A.A(p,0));
     for (int a=1;a<J.size();a++)
       matrix.add_entry(p,J[a],minus_scale*A.A(p,a));
-  }
+  });
 }
 
 template<class TV> void LinearBendingElements<TV>::add_elastic_gradient(SolidMatrix<TV>& matrix) const {
-  add_gradient_helper(*A,stiffness,matrix);
+  add_gradient_helper(*A,this->threads,stiffness,matrix);
 }
 
 template<class TV> void LinearBendingElements<TV>::add_damping_gradient(SolidMatrix<TV>& matrix) const {
-  add_gradient_helper(*A,damping,matrix);
+  add_gradient_helper(*A,this->threads,damping,matrix);
 }
 
 template class LinearBendingElements<Vector<T,2>>;
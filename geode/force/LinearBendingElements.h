@@ -4,8 +4,10 @@
 #pragma once
 
 #include <geode/force/Force.h>
+#include <geode/array/Nested.h>
 #include <geode/mesh/forward.h>
 #include <geode/vector/forward.h>
+#include <mutex>
 namespace geode {
 
 template<class TV> class LinearBendingElements : public Force<TV> {
@@ -21,6 +23,8 @@ public:
 private:
   Ref<SparseMatrix> A; // only the upper triangle is stored
   Array<const TV> X;
+  mutable std::once_flag lower_once;
+  mutable Nested<const Vector<int,2>> lower_;
 
 protected:
   LinearBendingElements(const Mesh& mesh, Array<const TV> X);
@@ -41,6 +45,8 @@ public:
   void structure(SolidMatrixStructure& structure) const;
   void add_elastic_gradient(SolidMatrix<TV>& matrix) const;
   void add_damping_gradient(SolidMatrix<TV>& matrix) const;
+private:
+  Nested<const Vector<int,2>> lower() const;
 };
 
 }
@@ -1,4 +1,5 @@
 #include <geode/force/LinearFiniteVolume.h>
+#include <geode/force/ElementColoring.h>
 #include <geode/array/view.h>
 #include <geode/math/Factorial.h>
 #include <geode/python/Class.h>
@@ -66,16 +67,14 @@ template<class TV,int d> Vector<typename TV::Scalar,2> LinearFiniteVolume<TV,d>:
 
 template<class TV,int d> typename TV::Scalar LinearFiniteVolume<TV,d>::elastic_energy() const {
   GEODE_ASSERT(X.size()>=nodes_);
-  T energy = 0;
   T mu,lambda;mu_lambda().get(mu,lambda);
   T half_lambda = (T).5*lambda;
-  for (int t=0;t<elements.size();t++) {
+  return -element_sum<T>(elements.size(),this->threads,[&](const int t) {
     SymmetricMatrix<T,m> strain = symmetric_part(Ds(X,t)*Dm_inverse[t])-1;
     if ((int)m>(int)d)
       strain += outer_product(normals[t]);
-    energy -= Bm_scales[t]*(mu*strain.sqr_frobenius_norm()+half_lambda*sqr(strain.trace()));
-  }
-  return energy;
+    return Bm_scales[t]*(mu*strain.sqr_frobenius_norm()+half_lambda*sqr(strain.trace()));
+  });
 }
 
 template<class TV,int d> void LinearFiniteVolume<TV,d>::add_elastic_force(RawArray<TV> F) const {
@@ -83,24 +82,24 @@ template<class TV,int d> void LinearFiniteVolume<TV,d>::add_elastic_force(RawArr
   T mu,lambda;mu_lambda().get(mu,lambda);
   T two_mu = 2*mu;
   T two_mu_plus_m_lambda = 2*mu+m*lambda;
-  for (int t=0;t<elements.size();t++) {
+  coloring.for_each(elements,this->threads,[&](const int t) {
     SymmetricMatrix<T,m> strain_plus_one = symmetric_part(Ds(X,t)*Dm_inverse[t]);
     if ((int)m>(int)d)
       strain_plus_one += outer_product(normals[t]);
     SymmetricMatrix<T,m> scaled_stress = Bm_scales[t]*two_mu*strain_plus_one+Bm_scales[t]*(lambda*strain_plus_one.trace()-two_mu_plus_m_lambda);
     StrainMeasure<T,d>::distribute_force(F,elements[t],scaled_stress.times_transpose(Dm_inverse[t]));
-  }
+  });
 }
 
 template<class TV,int d> void LinearFiniteVolume<TV,d>::add_differential_helper(RawArray<TV> dF, RawArray<const TV> dX, T scale) const {
   GEODE_ASSERT(X.size()>=nodes_ && dF.size()==X.size() && dX.size()==X.size());
   T mu,lambda;(scale*mu_lambda()).get(mu,lambda);
   T two_mu = 2*mu;
-  for (int t=0;t<elements.size();t++) {
+  coloring.for_each(elements,this->threads,[&](const int t) {
     SymmetricMatrix<T,m> d_strain = symmetric_part(Ds(dX,t)*Dm_inverse[t]);
     SymmetricMatrix<T,m> d_scaled_stress = Bm_scales[t]*two_mu*d_strain+Bm_scales[t]*lambda*d_strain.trace();
     StrainMeasure<T,d>::distribute_force(dF,elements[t],d_scaled_stress.times_transpose(Dm_inverse[t]));
-  }
+  });
 }
 
 template<class TV,int d> void LinearFiniteVolume<TV,d>::add_elastic_differential(RawArray<TV> dF, RawArray<const TV> dX) const {
@@ -113,14 +112,12 @@ template<class TV,int d> void LinearFiniteVolume<TV,d>::add_elastic_gradient_blo
 
 template<class TV,int d> typename TV::Scalar LinearFiniteVolume<TV,d>::damping_energy(RawArray<const TV> V) const {
   GEODE_ASSERT(X.size()>=nodes_);
-  T energy = 0;
   T beta,alpha;(rayleigh_coefficient*mu_lambda()).get(beta,alpha);
   T half_alpha = (T).5*alpha;
-  for (int t=0;t<elements.size();t++) {
+  return -element_sum<T>(elements.size(),this->threads,[&](const int t) {
     SymmetricMatrix<T,m> strain = symmetric_part(Ds(V,t)*Dm_inverse[t]);
-    energy -= Bm_scales[t]*(beta*strain.sqr_frobenius_norm()+half_alpha*sqr(strain.trace()));
-  }
-  return energy;
+    return Bm_scales[t]*(beta*strain.sqr_frobenius_norm()+half_alpha*sqr(strain.trace()));
+  });
 }
 
 template<class TV,int d> void LinearFiniteVolume<TV,d>::add_damping_force(RawArray<TV> F, RawArray<const TV> V) const {
@@ -3,6 +3,7 @@
 //#####################################################################
 #pragma once
 
+#include <geode/force/ElementColoring.h>
 #include <geode/force/Force.h>
 #include <geode/force/StrainMeasure.h>
 namespace geode {
@@ -28,6 +29,7 @@ private:
   Array<TV> normals;
   Array<T> Bm_scales; // Bm[t] = Bm_scales[t]*Dm_inverse[t].transposed()
   Array<const TV> X;
+  ElementColoring coloring;
 
 protected:
   LinearFiniteVolume(Array<const Vector<int,d+1>> elements, Array<const TV> X, const T density, const T youngs_modulus, const T poissons_ratio, const T rayleigh_coefficient);
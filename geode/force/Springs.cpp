@@ -2,6 +2,7 @@
 // Class Springs
 //#####################################################################
 #include <geode/force/Springs.h>
+#include <geode/force/ElementColoring.h>
 #include <geode/array/NdArray.h>
 #include <geode/array/ProjectedArray.h>
 #include <geode/array/view.h>
@@ -62,7 +63,7 @@ structure(SolidMatrixStructure& structure) const {
 template<class TV> void Springs<TV>::update_position(Array<const TV> X_, const bool definite) {
   GEODE_ASSERT(X_.size()==nodes_);
   X = X_;
-  for (int s=0;s<springs.size();s++) {
+  independent_for(springs.size(),this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j);
     SpringInfo<TV>& I = info[s];
     I.direction = X[j]-X[i];
@@ -78,154 +79,117 @@ template<class TV> void Springs<TV>::update_position(Array<const TV> X_, const b
         I.beta -= rotational;
       }
     }
-  }
+  });
 }
 
 template<class TV> void Springs<TV>::add_frequency_squared(RawArray<T> frequency_squared) const {
   GEODE_ASSERT(frequency_squared.size()==nodes_);
-  for (int s=0;s<springs.size();s++) {
+  coloring.for_each(springs,this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j);
     const SpringInfo<TV>& I=info[s];
     frequency_squared[i] += 4*I.stiffness/mass[i];
     frequency_squared[j] += 4*I.stiffness/mass[j];
-  }
+  });
 }
 
 template<class TV> T Springs<TV>::elastic_energy() const {
-  T energy = 0;
-  if (resist_compression)
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I = info[s];
-      energy += I.stiffness*sqr(I.length-I.restlength);
-    }
-  else
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      if (I.length>I.restlength)
-        energy += I.stiffness*sqr(I.length-I.restlength);
-    }
+  const T energy = element_sum<T>(springs.size(),this->threads,[&](const int s) {
+    const SpringInfo<TV>& I = info[s];
+    return resist_compression || I.length>I.restlength ? I.stiffness*sqr(I.length-I.restlength) : 0;
+  });
   return energy/2;
 }
 
 template<class TV> void Springs<TV>::add_elastic_force(RawArray<TV> F) const {
   GEODE_ASSERT(F.size()==nodes_);
-  for (int s=0;s<springs.size();s++) {
+  coloring.for_each(springs,this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j);
     const SpringInfo<TV>& I=info[s];
     TV f = I.stiffness*(I.length-I.restlength)*I.direction;
     F[i] += f;
     F[j] -= f;
-  }
+  });
 }
 
 template<class TV> void Springs<TV>::add_elastic_differential(RawArray<TV> dF, RawArray<const TV> dX) const {
   GEODE_ASSERT(dF.size()==nodes_);
   GEODE_ASSERT(dX.size()==nodes_);
-  for (int s=0;s<springs.size();s++) {
+  coloring.for_each(springs,this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j); 
     const SpringInfo<TV>& I=info[s];
     TV dx = dX[j]-dX[i];
     TV f = I.alpha*dx+I.beta*dot(dx,I.direction)*I.direction;
     dF[i] += f;
     dF[j] -= f;
-  }
+  });
 }
 
 template<class TV> void Springs<TV>::add_elastic_gradient(SolidMatrix<TV>& matrix) const {
   GEODE_ASSERT(matrix.size()==nodes_);
-  for (int s=0;s<springs.size();s++) {
+  coloring.for_each(springs,this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j);
     const SpringInfo<TV>& I=info[s];
     SymmetricMatrix<T,3> A = scaled_outer_product(I.beta,I.direction)+I.alpha;
     matrix.add_entry(i,-A);
     matrix.add_entry(i,j,A);
     matrix.add_entry(j,-A);
-  }
+  });
 }
 
 template<class TV> void Springs<TV>::add_elastic_gradient_block_diagonal(RawArray<SymmetricMatrix<T,m>> dFdX) const {
   GEODE_ASSERT(dFdX.size()==nodes_);
-  for (int s=0;s<springs.size();s++) {
+  coloring.for_each(springs,this->threads,[&](const int s) {
     int i,j;springs[s].get(i,j); 
     const SpringInfo<TV>& I = info[s];
     SymmetricMatrix<T,m> A = scaled_outer_product(I.beta,I.direction)+I.alpha;
     dFdX[i] -= A;
     dFdX[j] -= A;
-  }
+  });
 }
 
 template<class TV> T Springs<TV>::damping_energy(RawArray<const TV> V) const {
   GEODE_ASSERT(V.size()==nodes_);
-  T energy=0;
-  if (!off_axis_damping)
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      energy += I.damping*sqr(dot(V[j]-V[i],I.direction));
-    }
-  else {
-    const T alpha = off_axis_damping,
-            beta = 1-off_axis_damping;
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      TV dv = V[j]-V[i];
-      energy += I.damping*(alpha*sqr_magnitude(dv)+beta*sqr(dot(dv,I.direction)));
-    }
-  }
+  const T alpha = off_axis_damping,
+          beta = 1-off_axis_damping;
+  const T energy = element_sum<T>(springs.size(),this->threads,[&](const int s) {
+    int i,j;springs[s].get(i,j);
+    const SpringInfo<TV>& I=info[s];
+    TV dv = V[j]-V[i];
+    return !alpha ? I.damping*sqr(dot(dv,I.direction))
+                  : I.damping*(alpha*sqr_magnitude(dv)+beta*sqr(dot(dv,I.direction)));
+  });
   return energy/2;
 }
 
 template<class TV> void Springs<TV>::add_damping_force(RawArray<TV> force,RawArray<const TV> V) const {
   GEODE_ASSERT(V.size()==nodes_);
   GEODE_ASSERT(force.size()==nodes_);
-  if (!off_axis_damping)
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      TV f = I.damping*dot(V[j]-V[i],I.direction)*I.direction;
-      force[i]+=f;force[j]-=f;
-    }
-  else {
-    const T alpha = off_axis_damping,
-            beta = 1-off_axis_damping;
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      TV dv = V[j]-V[i];
-      TV f = alpha*I.damping*dv+beta*I.damping*dot(dv,I.direction)*I.direction;
-      force[i] += f;
-      force[j] -= f;
-    }
-  }
+  const T alpha = off_axis_damping,
+          beta = 1-off_axis_damping;
+  coloring.for_each(springs,this->threads,[&](const int s) {
+    int i,j;springs[s].get(i,j);
+    const SpringInfo<TV>& I=info[s];
+    TV dv = V[j]-V[i];
+    TV f = !alpha ? I.damping*dot(dv,I.direction)*I.direction
+                  : alpha*I.damping*dv+beta*I.damping*dot(dv,I.direction)*I.direction;
+    force[i] += f;
+    force[j] -= f;
+  });
 }
 
 template<class TV> void Springs<TV>::add_damping_gradient(SolidMatrix<TV>& matrix) const {
   GEODE_ASSERT(matrix.size()==nodes_);
-  if (!off_axis_damping)
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      SymmetricMatrix<T,3> A = scaled_outer_product(I.damping,I.direction);
-      matrix.add_entry(i,-A);
-      matrix.add_entry(i,j,A);
-      matrix.add_entry(j,-A);
-    }
-  else {
-    const T alpha = off_axis_damping,
-            beta = 1-off_axis_damping;
-    for (int s=0;s<springs.size();s++) {
-      int i,j;springs[s].get(i,j);
-      const SpringInfo<TV>& I=info[s];
-      SymmetricMatrix<T,3> A = scaled_outer_product(beta*I.damping,I.direction);
-      A += alpha*I.damping;
-      matrix.add_entry(i,-A);
-      matrix.add_entry(i,j,A);
-      matrix.add_entry(j,-A);
-    }
-  }
+  const T alpha = off_axis_damping,
+          beta = 1-off_axis_damping;
+  coloring.for_each(springs,this->threads,[&](const int s) {
+    int i,j;springs[s].get(i,j);
+    const SpringInfo<TV>& I=info[s];
+    const SymmetricMatrix<T,3> A = !alpha ? scaled_outer_product(I.damping,I.direction)
+                                          : scaled_outer_product(beta*I.damping,I.direction)+alpha*I.damping;
+    matrix.add_entry(i,-A);
+    matrix.add_entry(i,j,A);
+    matrix.add_entry(j,-A);
+  });
 }
 
 template<class TV> T Springs<TV>::strain_rate(RawArray<const TV> V) const {
@@ -193,5 +193,33 @@ def test_particle_binding_springs():
   springs = particle_binding_springs([[1,2]],mass,7,1.2)
   force_test(springs,X,verbose=1)
 
+def test_threads():
+  random.seed(83131)
+  mesh,X0 = sphere_mesh(3)
+  X = X0+.02*random.randn(*X0.shape)
+  dX = random.randn(*X.shape)
+  V = random.randn(*X.shape)
+  mass = ones(len(X))
+  forces = [edge_springs(mesh,mass,X0,5,.7),
+            finite_volume(mesh,1000,X0,neo_hookean(),verbose=False),
+            linear_finite_volume(mesh,X0,1000),
+            cubic_hinges(mesh,X0,3,2),
+            linear_bending_elements(mesh,X0,3,2)]
+  for force in forces:
+    results = []
+    for threads in 1,2,3:
+      force.threads = threads
+      force.update_position(X,False)
+      F,dF,Fd = zeros_like(X),zeros_like(X),zeros_like(X)
+      force.add_elastic_force(F)
+      force.add_elastic_differential(dF,dX)
+      force.add_damping_force(Fd,V)
+      results.append((force.elastic_energy(),force.damping_energy(V),F,dF,Fd))
+    for serial,parallel in zip(results[0],results[1]):
+      assert relative_error(serial,parallel)<1e-10
+    # Parallel summation order does not depend on the number of threads
+    for a,b in zip(results[1],results[2]):
+      assert all(a==b)
+
 if __name__=='__main__':
   test_simple_shell()
@@ -8,6 +8,7 @@
 #include <geode/geometry/Box.h>
 #include <geode/geometry/Sphere.h>
 #include <geode/geometry/traverse.h>
+#include <geode/math/constants.h>
 #include <geode/math/integer_log.h>
 #include <geode/python/Class.h>
 namespace geode {
@@ -52,27 +53,98 @@ Array<const Range<int>> ranges(int prims, int leaf_size) {
   return ranges;
 }
 
-template<class Geo,class TV> void
-build(BoxTree<TV>& self, RawArray<const Range<int>> ranges, RawArray<const Geo> geo, int node) {
-  // Compute box
-  const auto r = ranges[node];
-  Box<TV>& box = self.boxes[node];
-  box = Box<TV>(geo[self.p[r.lo]]);
-  for (int i=r.lo+1;i<r.hi;i++)
-    box.enlarge_nonempty(geo[self.p[i]]);
-
-  // Recursively split along largest axis if necessary
-  if (self.is_leaf(node))
-    sort(self.p.slice(r.lo,r.hi).const_cast_());
-  else {
-    const int axis = box.sizes().argmax();
+// Measure used by the surface area heuristic: surface area in 3D, perimeter (up to a factor of two) in 2D
+template<class T> static inline T surface_measure(const Box<Vector<T,2>>& box) {
+  return box.sizes().sum();
+}
+template<class T> static inline T surface_measure(const Box<Vector<T,3>>& box) {
+  return box.surface_area();
+}
+
+// Subtrees with more primitives than this are built as separate tasks
+const int task_cutoff = 4096;
+
+template<class Geo,class TV> struct Builder {
+  typedef typename TV::Scalar T;
+  BoxTree<TV>& self;
+  const RawArray<const Range<int>> ranges;
+  const RawArray<const Geo> geo;
+  const bool sah;
+
+  Builder(BoxTree<TV>& self, RawArray<const Range<int>> ranges, RawArray<const Geo> geo, const bool sah)
+    : self(self), ranges(ranges), geo(geo), sah(sah) {}
+
+  void partition(const int node, const int axis) const {
     int* pp = const_cast<int*>(self.p.data());
-    std::nth_element(pp+r.lo,
+    std::nth_element(pp+ranges[node].lo,
                      pp+ranges[2*node+1].hi,
-                     pp+r.hi,indirect_comparison(geo,CenterCompare(axis)));
-    build(self,ranges,geo,2*node+1);
-    build(self,ranges,geo,2*node+2);
+                     pp+ranges[node].hi,indirect_comparison(geo,CenterCompare(axis)));
+  }
+
+  Box<TV> bounds(const Range<int> r) const {
+    Box<TV> box(geo[self.p[r.lo]]);
+    for (int i=r.lo+1;i<r.hi;i++)
+      box.enlarge_nonempty(geo[self.p[i]]);
+    return box;
+  }
+
+  // The complete binary tree layout fixes the number of primitives in each child, so the surface area
+  // heuristic can only choose the axis along which the primitives are partitioned.  We pick the axis
+  // minimizing the sum of child surface measures weighted by primitive counts.
+  void sah_partition(const int node) const {
+    const auto left = ranges[2*node+1],
+               right = ranges[2*node+2];
+    int best = 0;
+    T best_cost = inf;
+    for (int axis=0;axis<TV::m;axis++) {
+      partition(node,axis);
+      const T cost = left.size()*surface_measure(bounds(left))+right.size()*surface_measure(bounds(right));
+      if (best_cost > cost) {
+        best_cost = cost;
+        best = axis;
+      }
+    }
+    if (best != TV::m-1)
+      partition(node,best);
+  }
+
+  void build(const int node) const {
+    // Compute box
+    const auto r = ranges[node];
+    Box<TV>& box = self.boxes[node];
+    box = bounds(r);
+
+    // Recursively split along largest axis (or the best axis according to SAH) if necessary
+    if (self.is_leaf(node))
+      sort(self.p.slice(r.lo,r.hi).const_cast_());
+    else {
+      if (sah)
+        sah_partition(node);
+      else
+        partition(node,box.sizes().argmax());
+      // Subtrees touch disjoint ranges of p and disjoint boxes, so they can be built concurrently
+      if (r.size() > task_cutoff) {
+        #pragma omp task
+        build(2*node+1);
+        build(2*node+2);
+        #pragma omp taskwait
+      } else {
+        build(2*node+1);
+        build(2*node+2);
+      }
+    }
   }
+};
+
+template<class Geo,class TV> void
+build(BoxTree<TV>& self, RawArray<const Range<int>> ranges, RawArray<const Geo> geo, const int threads, const bool sah) {
+  const Builder<Geo,TV> builder(self,ranges,geo,sah);
+  if (threads > 1 && geo.size() > task_cutoff) {
+    #pragma omp parallel num_threads(threads)
+    #pragma omp single
+    builder.build(0);
+  } else
+    builder.build(0);
 }
 
 }
@@ -82,6 +154,11 @@ static int check_leaf_size(int leaf_size) {
   return leaf_size;
 }
 
+static int check_threads(int threads) {
+  GEODE_ASSERT(threads>0);
+  return threads;
+}
+
 static int depth(int leaves) {
   if (!leaves)
     return 0;
@@ -97,7 +174,7 @@ static inline Range<int> leaf_range(int prims, int leaf_size) {
   return range(leaves-1,2*leaves-1);
 }
 
-template<class TV> BoxTree<TV>::BoxTree(RawArray<const TV> geo, const int leaf_size)
+template<class TV> BoxTree<TV>::BoxTree(RawArray<const TV> geo, const int leaf_size, const int threads, const bool sah)
   : leaf_size(check_leaf_size(leaf_size))
   , leaves(leaf_range(geo.size(),leaf_size))
   , depth(geode::depth(leaves.size()))
@@ -106,10 +183,11 @@ template<class TV> BoxTree<TV>::BoxTree(RawArray<const TV> geo, const int leaf_s
   , boxes(max(0,leaves.hi),uninit)
 {
   if (leaves.size())
-    build(*this,ranges,geo,0);
+    build(*this,ranges,geo,check_threads(threads),sah);
+  build_cost = cost();
 }
 
-template<class TV> BoxTree<TV>::BoxTree(RawArray<const Box<TV>> geo, const int leaf_size)
+template<class TV> BoxTree<TV>::BoxTree(RawArray<const Box<TV>> geo, const int leaf_size, const int threads, const bool sah)
   : leaf_size(check_leaf_size(leaf_size))
   , leaves(leaf_range(geo.size(),leaf_size))
   , depth(geode::depth(leaves.size()))
@@ -118,7 +196,8 @@ template<class TV> BoxTree<TV>::BoxTree(RawArray<const Box<TV>> geo, const int l
   , boxes(max(0,leaves.hi),uninit)
 {
   if (leaves.size())
-    build(*this,ranges,geo,0);
+    build(*this,ranges,geo,check_threads(threads),sah);
+  build_cost = cost();
 }
 
 template<class TV> BoxTree<TV>::BoxTree(const BoxTree<TV>& other)
@@ -128,6 +207,7 @@ template<class TV> BoxTree<TV>::BoxTree(const BoxTree<TV>& other)
   , p(other.p)
   , ranges(other.ranges)
   , boxes(other.boxes.copy()) // Don't share ownership with geometry
+  , build_cost(other.build_cost)
 {}
 
 template<class TV> BoxTree<TV>::~BoxTree() {}
@@ -137,6 +217,34 @@ template<class TV> void BoxTree<TV>::update_nonleaf_boxes() {
     boxes[n] = Box<TV>::combine(boxes[2*n+1],boxes[2*n+2]);
 }
 
+template<class TV> void BoxTree<TV>::update_nonleaf_boxes(RawArray<const int> dirty_leaves) {
+  // Collect dirty ancestors.  Children come after parents, so updating in decreasing order is safe.
+  Array<int> dirty;
+  for (int n : dirty_leaves) {
+    GEODE_ASSERT(leaves.contains(n));
+    while (n) {
+      n = parent(n);
+      dirty.append(n);
+    }
+  }
+  std::sort(dirty.begin(),dirty.end(),std::greater<int>());
+  dirty.resize(int(std::unique(dirty.begin(),dirty.end())-dirty.begin()));
+  for (const int n : dirty)
+    boxes[n] = Box<TV>::combine(boxes[2*n+1],boxes[2*n+2]);
+}
+
+template<class TV> typename TV::Scalar BoxTree<TV>::cost() const {
+  T sum = 0;
+  for (const auto& box : boxes)
+    if (!box.empty())
+      sum += surface_measure(box);
+  return sum;
+}
+
+template<class TV> typename TV::Scalar BoxTree<TV>::degradation() const {
+  return build_cost ? cost()/build_cost : 1;
+}
+
 namespace {
 template<class TV> struct CheckVisitor {
   const BoxTree<TV>& tree;
@@ -199,16 +307,20 @@ void wrap_box_tree() {
   {typedef Vector<real,2> TV;
   typedef BoxTree<TV> Self;
   Class<Self>("BoxTree2d")
-    .GEODE_INIT(RawArray<const TV>,int)
+    .GEODE_INIT(RawArray<const TV>,int,int,bool)
     .GEODE_FIELD(p)
     .GEODE_METHOD(check)
+    .GEODE_METHOD(cost)
+    .GEODE_METHOD(degradation)
     ;}
 
   {typedef Vector<real,3> TV;
   typedef BoxTree<TV> Self;
   Class<Self>("BoxTree3d")
-    .GEODE_INIT(RawArray<const TV>,int)
+    .GEODE_INIT(RawArray<const TV>,int,int,bool)
     .GEODE_FIELD(p)
     .GEODE_METHOD(check)
+    .GEODE_METHOD(cost)
+    .GEODE_METHOD(degradation)
     ;}
 }
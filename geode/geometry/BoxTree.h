@@ -10,6 +10,15 @@
 //
 // For templatized visitor-based traversal, include traversal.h.
 //
+// By default, each internal node splits its primitives at the median along the longest axis of
+// its box.  If sah is set, the split axis is instead chosen by the surface area heuristic, which
+// gives better trees for long, skinny primitives.  Since the node layout is fixed, the choice only
+// affects which primitives end up in each child.  With threads > 1, large subtrees are built in
+// parallel; the result is identical for any number of threads.
+//
+// When geometry moves, boxes can be refit with the topology fixed, either entirely or only above a set of
+// dirty leaves.  Refit trees degrade as primitives drift apart, and degradation() measures how much.
+//
 //#####################################################################
 #pragma once
 
@@ -35,8 +44,10 @@ public:
   const Array<Box<TV>> boxes;
 
 protected:
-  GEODE_CORE_EXPORT BoxTree(RawArray<const TV> geo, const int leaf_size);
-  GEODE_CORE_EXPORT BoxTree(RawArray<const Box<TV>> geo, const int leaf_size);
+  T build_cost; // cost() immediately after construction
+
+  GEODE_CORE_EXPORT BoxTree(RawArray<const TV> geo, const int leaf_size, const int threads=1, const bool sah=false);
+  GEODE_CORE_EXPORT BoxTree(RawArray<const Box<TV>> geo, const int leaf_size, const int threads=1, const bool sah=false);
   GEODE_CORE_EXPORT BoxTree(const BoxTree<TV>& other); // Shares ownership with everything except boxes
 public:
   ~BoxTree();
@@ -74,6 +85,17 @@ public:
   }
 
   GEODE_CORE_EXPORT void update_nonleaf_boxes();
+
+  // Update only the ancestors of the given leaves, whose boxes must already be up to date.  Duplicates are fine.
+  GEODE_CORE_EXPORT void update_nonleaf_boxes(RawArray<const int> dirty_leaves);
+
+  // Surface area heuristic estimate of traversal cost: the sum of node perimeters in 2D or areas in 3D
+  GEODE_CORE_EXPORT T cost() const;
+
+  // Ratio of cost() to its value at construction.  Refitting keeps the topology fixed, so the ratio grows as
+  // primitives move relative to each other.  Once it exceeds 1.5 or so, a rebuild is usually worthwhile.
+  GEODE_CORE_EXPORT T degradation() const;
+
   void check(RawArray<const TV> x) const;
 
   // Warning: Doesn't know about structure without each tree leaf
@@ -16,8 +16,8 @@ template<> GEODE_DEFINE_TYPE(ParticleTree<Vector<T,2>>)
 template<> GEODE_DEFINE_TYPE(ParticleTree<Vector<T,3>>)
 
 template<class TV> ParticleTree<TV>::
-ParticleTree(Array<const TV> X,int leaf_size)
-  : Base(X.raw(),leaf_size), X(X) {}
+ParticleTree(Array<const TV> X,int leaf_size,int threads,bool sah)
+  : Base(X.raw(),leaf_size,threads,sah), X(X) {}
 
 template<class TV> ParticleTree<TV>::
 ~ParticleTree() {}
@@ -27,16 +27,21 @@ update() {
   for (int n : leaves)
     boxes[n] = geode::bounding_box(X.subset(prims(n)));
   update_nonleaf_boxes();
+  wide_.boxes_changed();
 }
 
 namespace {
+// Collect close pairs, in traversal order so that parallel traversals produce the same components
 template<class TV> struct DuplicatesVisitor {
   const ParticleTree<TV>& tree;
-  UnionFind components;
+  Array<Vector<int,2>> pairs;
   T tolerance;
 
   DuplicatesVisitor(const ParticleTree<TV>& tree, T tolerance)
-    : tree(tree), components(tree.X.size()), tolerance(tolerance) {}
+    : tree(tree), tolerance(tolerance) {}
+
+  DuplicatesVisitor split() const { return DuplicatesVisitor(tree,tolerance); }
+  void join(DuplicatesVisitor& task) { pairs.extend(task.pairs); }
 
   bool cull(int n) const { return false; }
   bool cull(int n0, int n1) const { return false; }
@@ -45,28 +50,31 @@ template<class TV> struct DuplicatesVisitor {
     auto prims = tree.prims(n);
     for (int i=0;i<prims.size();i++) for (int j=i+1;j<prims.size();j++)
       if((tree.X[prims[i]]-tree.X[prims[j]]).sqr_magnitude()<=sqr(tolerance))
-        components.merge(prims[i],prims[j]);
+        pairs.append(vec(prims[i],prims[j]));
   }
 
   void leaf(int n0, int n1) {
     for (int i : tree.prims(n0)) for (int j : tree.prims(n1))
       if ((tree.X[i]-tree.X[j]).sqr_magnitude()<=sqr(tolerance))
-        components.merge(i,j);
+        pairs.append(vec(i,j));
   }
 };
 }
 
 template<class TV> Array<int> ParticleTree<TV>::
-remove_duplicates(T tolerance) const {
+remove_duplicates(T tolerance, int threads) const {
   DuplicatesVisitor<TV> visitor(*this,tolerance);
-  double_traverse(*this,visitor,tolerance);
+  parallel_double_traverse(*this,visitor,threads,tolerance);
+  UnionFind components(X.size());
+  for (const auto& p : visitor.pairs)
+    components.merge(p.x,p.y);
   Array<int> map(X.size(),uninit);
   int count=0;
   for(int i=0;i<X.size();i++)
-    if(visitor.components.is_root(i))
+    if(components.is_root(i))
       map[i] = count++;
   for(int i=0;i<X.size();i++)
-    map[i] = map[visitor.components.find(i)];
+    map[i] = map[components.find(i)];
   return map;
 }
 
@@ -89,31 +97,20 @@ intersection(const Shape& shape, Array<int>& hits) const {
     intersection_helper(*this,shape,hits,0);
 }
 
-template<class TV> static void closest_point_helper(const ParticleTree<TV>& self, TV point, int& index, T& sqr_distance, int node, int ignore) {
-  if (!self.is_leaf(node)) {
-    Vector<T,2> bounds(self.boxes[2*node+1].sqr_distance_bound(point),
-                       self.boxes[2*node+2].sqr_distance_bound(point));
-    int c = bounds.argmin();
-    if (bounds[c]<sqr_distance)
-      closest_point_helper(self,point,index,sqr_distance,2*node+1+c,ignore);
-    if (bounds[1-c]<sqr_distance)
-      closest_point_helper(self,point,index,sqr_distance,2*node+2-c,ignore);
-  } else
-    for (int t : self.prims(node)) {
-      T sqr_d = sqr_magnitude(point-self.X[t]);
-      if (sqr_distance>sqr_d && t != ignore) {
-        sqr_distance = sqr_d;
-        index = t;
-      }
-    }
-}
-
 template<class TV> TV ParticleTree<TV>::
 closest_point(TV point, int& index, T max_distance, int ignore) const {
   index = -1;
   if (nodes()) {
     T sqr_distance = sqr(max_distance);
-    closest_point_helper(*this,point,index,sqr_distance,0,ignore);
+    wide().closest_leaves(point,sqr_distance,[&](const int node) {
+      for (const int t : prims(node)) {
+        const T sqr_d = sqr_magnitude(point-X[t]);
+        if (sqr_distance>sqr_d && t != ignore) {
+          sqr_distance = sqr_d;
+          index = t;
+        }
+      }
+    });
   }
   if (index == -1) {
     TV x;
@@ -151,7 +148,8 @@ template<int d> static void wrap_helper() {
     .GEODE_INIT(Array<const TV>,int)
     .GEODE_FIELD(X)
     .GEODE_METHOD(update)
-    .GEODE_METHOD(remove_duplicates)
+    .GEODE_METHOD_2("remove_duplicates",remove_duplicates_py)
+    .GEODE_METHOD_2("parallel_remove_duplicates",remove_duplicates)
     .GEODE_METHOD_2("closest_point",closest_point_py)
     ;
 }
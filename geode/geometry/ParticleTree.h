@@ -5,6 +5,7 @@
 
 #include <geode/geometry/forward.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/geometry/WideBoxTree.h>
 #include <geode/math/constants.h>
 
 namespace geode {
@@ -21,16 +22,23 @@ public:
   const Array<const TV> X;
 
 protected:
-  GEODE_CORE_EXPORT ParticleTree(Array<const TV> X, int leaf_size);
+  LazyWideBoxTree<TV> wide_; // 4-ary layout of the same tree for faster closest point queries
+
+  GEODE_CORE_EXPORT ParticleTree(Array<const TV> X, int leaf_size, int threads=1, bool sah=false); // See BoxTree for threads and sah
 public:
   ~ParticleTree();
 
   GEODE_CORE_EXPORT void update(); // Call whenever X changes
-  GEODE_CORE_EXPORT Array<int> remove_duplicates(T tolerance) const; // Returns map from point to component index
+  // Returns map from point to component index.  The result does not depend on threads.
+  GEODE_CORE_EXPORT Array<int> remove_duplicates(T tolerance, int threads=1) const;
+  Array<int> remove_duplicates_py(T tolerance) const { return remove_duplicates(tolerance); } // Wrapped as parallel_remove_duplicates with threads
 
   template<class Shape>
   GEODE_CORE_EXPORT void intersection(const Shape& box, Array<int>& hits) const;
 
+  // 4-ary layout of the same tree for closest point queries, built on first use and refit after updates
+  const WideBoxTree<TV>& wide() const { return wide_.get(*this); }
+
   GEODE_CORE_EXPORT TV closest_point(TV point, int& index, T max_distance=inf, int ignore = -1) const; // simplex=-1 if nothing is found
   GEODE_CORE_EXPORT TV closest_point(TV point, T max_distance=inf) const; // return value is infinity if nothing is found
   GEODE_CORE_EXPORT Tuple<TV,int> closest_point_py(TV point, T max_distance=inf) const;
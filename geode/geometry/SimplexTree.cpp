@@ -9,6 +9,7 @@
 #include <geode/geometry/Triangle2d.h>
 #include <geode/geometry/Triangle3d.h>
 #include <geode/array/IndirectArray.h>
+#include <geode/math/popcount.h>
 #include <geode/python/Class.h>
 #include <geode/random/Random.h>
 
@@ -31,14 +32,15 @@ template<class Mesh,class TV> static Array<Box<TV>> boxes(const Mesh& mesh, Arra
   return boxes;
 }
 
-template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size)
-  : Base(RawArray<const Box<TV>>(geode::boxes(mesh,X)),leaf_size), mesh(ref(mesh)), X(X), simplices(mesh.elements.size(),uninit) {
+template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size, int threads, bool sah)
+  : Base(RawArray<const Box<TV>>(geode::boxes(mesh,X)),leaf_size,threads,sah), mesh(ref(mesh)), X(X), simplices(mesh.elements.size(),uninit) {
   for (int t=0;t<mesh.elements.size();t++)
     simplices[t] = Simplex(X.subset(mesh.elements[t]));
 }
 
 template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const SimplexTree& other, Array<const TV> X)
-  : Base(other), mesh(other.mesh), X(X), simplices(mesh->elements.size(),uninit) {
+  : Base(other), mesh(other.mesh), X(X), simplices(mesh->elements.size(),uninit)
+  , simplex_leaves(other.simplex_leaves) {
   GEODE_ASSERT(mesh->nodes()<=X.size());
   update();
 }
@@ -56,6 +58,42 @@ template<class TV,int d> void SimplexTree<TV,d>::update() {
     boxes[n] = box;
   }
   update_nonleaf_boxes();
+  wide_.boxes_changed();
+}
+
+template<class TV,int d> void SimplexTree<TV,d>::update_moved(RawArray<const int> moved) {
+  RawArray<const Vector<int,d+1>> elements = mesh->elements;
+  if (simplex_leaves.size() != elements.size()) {
+    Array<int> leaf_of(elements.size(),uninit);
+    for (const int n : leaves)
+      for (const int s : prims(n))
+        leaf_of[s] = n;
+    simplex_leaves = leaf_of;
+  }
+
+  // Refit simplices incident to moved vertices
+  const auto incident = mesh->incident_elements();
+  Array<int> dirty;
+  for (const int v : moved) {
+    GEODE_ASSERT(X.valid(v));
+    if (incident.valid(v))
+      for (const int s : incident[v]) {
+        simplices[s] = Simplex(X.subset(elements[s]));
+        dirty.append(simplex_leaves[s]);
+      }
+  }
+
+  // Refit their leaves and the ancestors of those leaves
+  std::sort(dirty.begin(),dirty.end());
+  dirty.resize(int(std::unique(dirty.begin(),dirty.end())-dirty.begin()));
+  for (const int n : dirty) {
+    Box<TV> box;
+    for (const int s : prims(n))
+      box.enlarge(geode::bounding_box(X.subset(elements[s])));
+    boxes[n] = box;
+  }
+  update_nonleaf_boxes(dirty);
+  wide_.boxes_changed(dirty);
 }
 
 namespace {
@@ -90,16 +128,22 @@ template<> void SimplexTree<Vector<real,3>,2>::intersections(const Plane<real>&
   single_traverse(*this,PlaneVisitor<real>(*this,plane,results));
 }
 
-template<int signs,class TV,int d> static void intersection_helper(const SimplexTree<TV,d>& self, RayIntersection<TV>& ray, const typename TV::Scalar half_thickness) {
+// Trace a ray through the subtree at start, which it enters at t_min.  If start < 0, trace the whole tree.
+template<int signs,class TV,int d> static void intersection_helper(const SimplexTree<TV,d>& self, RayIntersection<TV>& ray, const typename TV::Scalar half_thickness,
+                                                                   int start, typename TV::Scalar t_min) {
   typedef typename TV::Scalar T;
   FastRay<TV,signs> fast(ray);
-  // If we don't intersect the root box, there's nothing to do
-  const Box<T> root = fast.range(self.boxes[0],half_thickness);
-  if (root.min>root.max || (root.max) < 0 || root.min > fast.t_max)
-    return;
+  if (start < 0) {
+    // If we don't intersect the root box, there's nothing to do
+    const Box<T> root = fast.range(self.boxes[0],half_thickness);
+    if (root.min>root.max || (root.max) < 0 || root.min > fast.t_max)
+      return;
+    start = 0;
+    t_min = root.min;
+  }
   const int internal = self.leaves.lo;
   RawStack<Tuple<int,T>> stack(GEODE_RAW_ALLOCA(self.depth,Tuple<int,T>)); // Each entry is (node,t_min)
-  stack.push(tuple(0,root.min));
+  stack.push(tuple(start,t_min));
   while (stack.size()) {
     const auto node_tmin = stack.pop();
     if (node_tmin.y>fast.t_max) // Check t_min again since fast.t_max may have changed
@@ -131,29 +175,32 @@ template<int signs,class TV,int d> static void intersection_helper(const Simplex
   }
 }
 
-template<class TV,int d> static void intersection_dispatch(const SimplexTree<TV,d>& self, RayIntersection<TV>& ray, const typename TV::Scalar half_thickness) {
+template<class TV,int d> static void intersection_dispatch(const SimplexTree<TV,d>& self, RayIntersection<TV>& ray, const typename TV::Scalar half_thickness,
+                                                           const int start=-1, const typename TV::Scalar t_min=0) {
   GEODE_NOT_IMPLEMENTED();
 }
 
-template<> void intersection_dispatch(const SimplexTree<Vector<real,2>,1>& self, RayIntersection<Vector<real,2>>& ray, const real half_thickness) {
+template<> void intersection_dispatch(const SimplexTree<Vector<real,2>,1>& self, RayIntersection<Vector<real,2>>& ray, const real half_thickness,
+                                  const int start, const real t_min) {
   switch (fast_ray_signs(ray)) {
-    case 0: intersection_helper<0>(self,ray,half_thickness); break;
-    case 1: intersection_helper<1>(self,ray,half_thickness); break;
-    case 2: intersection_helper<2>(self,ray,half_thickness); break;
-    case 3: intersection_helper<3>(self,ray,half_thickness); break;
+    case 0: intersection_helper<0>(self,ray,half_thickness,start,t_min); break;
+    case 1: intersection_helper<1>(self,ray,half_thickness,start,t_min); break;
+    case 2: intersection_helper<2>(self,ray,half_thickness,start,t_min); break;
+    case 3: intersection_helper<3>(self,ray,half_thickness,start,t_min); break;
   }
 }
 
-template<> void intersection_dispatch(const SimplexTree<Vector<real,3>,2>& self, RayIntersection<Vector<real,3>>& ray, const real half_thickness) {
+template<> void intersection_dispatch(const SimplexTree<Vector<real,3>,2>& self, RayIntersection<Vector<real,3>>& ray, const real half_thickness,
+                                  const int start, const real t_min) {
   switch (fast_ray_signs(ray)) {
-    case 0: intersection_helper<0>(self,ray,half_thickness); break;
-    case 1: intersection_helper<1>(self,ray,half_thickness); break;
-    case 2: intersection_helper<2>(self,ray,half_thickness); break;
-    case 3: intersection_helper<3>(self,ray,half_thickness); break;
-    case 4: intersection_helper<4>(self,ray,half_thickness); break;
-    case 5: intersection_helper<5>(self,ray,half_thickness); break;
-    case 6: intersection_helper<6>(self,ray,half_thickness); break;
-    case 7: intersection_helper<7>(self,ray,half_thickness); break;
+    case 0: intersection_helper<0>(self,ray,half_thickness,start,t_min); break;
+    case 1: intersection_helper<1>(self,ray,half_thickness,start,t_min); break;
+    case 2: intersection_helper<2>(self,ray,half_thickness,start,t_min); break;
+    case 3: intersection_helper<3>(self,ray,half_thickness,start,t_min); break;
+    case 4: intersection_helper<4>(self,ray,half_thickness,start,t_min); break;
+    case 5: intersection_helper<5>(self,ray,half_thickness,start,t_min); break;
+    case 6: intersection_helper<6>(self,ray,half_thickness,start,t_min); break;
+    case 7: intersection_helper<7>(self,ray,half_thickness,start,t_min); break;
   }
 }
 
@@ -170,6 +217,215 @@ template<class TV,int d> bool SimplexTree<TV,d>::intersection(RayIntersection<TV
   return true;
 }
 
+namespace {
+// Ray packets trace several rays through the tree together, with box tests written as loops over the packet
+// so that they vectorize.  Each stack entry holds the rays which reached the node and their entry times.
+// Where rays disagree about which child is nearer, each group pushes its own entries, so every ray visits
+// nodes and simplices in exactly the same order as in intersection_helper, and gets exactly the same result.
+const int packet_size = 16;
+const int scalar_threshold = 4; // Switch to single ray traversal with this many rays left
+
+template<class TV> struct RayPacket {
+  typedef typename TV::Scalar T;
+  static const int m = TV::m;
+
+  T start[m][packet_size];
+  T inv_dx[m][packet_size];
+  T t_max[packet_size];
+
+  RayPacket(RawArray<const RayIntersection<TV>> rays) {
+    assert(rays.size() && rays.size()<=packet_size);
+    for (int i=0;i<packet_size;i++) {
+      const auto& ray = rays[min(i,rays.size()-1)]; // Pad with copies of the last ray
+      const TV inv = 1/ray.direction;
+      for (int a=0;a<m;a++) {
+        start[a][i] = ray.start[a];
+        inv_dx[a][i] = inv[a];
+      }
+      t_max[i] = ray.t_max;
+    }
+  }
+
+  // Identical to FastRay::range and FastRay::intersects for each ray.  Returns a mask of intersecting rays.
+  int range(const Box<TV>& box, const T enlargement, T* t_min) const {
+    const TV bmin = box.min-enlargement,
+             bmax = box.max+enlargement;
+    T lo[packet_size], hi[packet_size];
+    for (int i=0;i<packet_size;i++) {
+      const T t0 = inv_dx[0][i]*(bmin[0]-start[0][i]),
+              t1 = inv_dx[0][i]*(bmax[0]-start[0][i]);
+      const bool sign = inv_dx[0][i]<0;
+      lo[i] = sign ? t1 : t0;
+      hi[i] = sign ? t0 : t1;
+    }
+    for (int a=1;a<m;a++)
+      for (int i=0;i<packet_size;i++) {
+        const T t0 = inv_dx[a][i]*(bmin[a]-start[a][i]),
+                t1 = inv_dx[a][i]*(bmax[a]-start[a][i]);
+        const bool sign = inv_dx[a][i]<0;
+        lo[i] = max(lo[i],sign ? t1 : t0);
+        hi[i] = min(hi[i],sign ? t0 : t1);
+      }
+    int mask = 0;
+    for (int i=0;i<packet_size;i++) {
+      t_min[i] = lo[i];
+      mask |= (lo[i]<=hi[i] && hi[i]>=0 && lo[i]<=t_max[i])<<i;
+    }
+    return mask;
+  }
+};
+
+template<class T> struct PacketEntry {
+  int node;
+  int mask; // Rays which should visit this node
+  T t_min[packet_size];
+};
+
+template<class TV,int d> static int
+intersection_packet_helper(const SimplexTree<TV,d>& self, RawArray<RayIntersection<TV>> rays, const typename TV::Scalar half_thickness) {
+  typedef typename TV::Scalar T;
+  RayPacket<TV> packet(rays);
+  const int active = (1<<rays.size())-1;
+
+  // Each pop pushes at most four entries, two per ordering group, so 3*depth+1 entries suffice
+  RawStack<PacketEntry<T>> stack(GEODE_RAW_ALLOCA(3*self.depth+1,PacketEntry<T>));
+  {
+    auto& root = stack.data[stack.n++];
+    root.node = 0;
+    root.mask = active & packet.range(self.boxes[0],half_thickness,root.t_min);
+    if (!root.mask)
+      return 0;
+  }
+  const int internal = self.leaves.lo;
+  T lo0[packet_size], lo1[packet_size];
+  while (stack.size()) {
+    const auto& top = stack.pop();
+    const int node = top.node;
+    int mask = top.mask;
+    for (int i=0;i<packet_size;i++)
+      if (top.t_min[i]>packet.t_max[i]) // Check t_min again since t_max may have changed
+        mask &= ~(1<<i);
+    if (!mask)
+      continue;
+    if (popcount(uint32_t(mask)) <= scalar_threshold) {
+      // Too few rays remain to share box tests, so finish this subtree one ray at a time.  Since each ray
+      // would process the entire subtree before its next stack entry anyway, the order is unchanged.
+      for (int i=0;i<rays.size();i++)
+        if (mask&1<<i) {
+          intersection_dispatch(self,rays[i],half_thickness,node,top.t_min[i]);
+          packet.t_max[i] = rays[i].t_max;
+        }
+    } else if (node < internal) {
+      const int child0 = 2*node+1,
+                child1 = 2*node+2;
+      const int hit0 = mask & packet.range(self.boxes[child0],half_thickness,lo0),
+                hit1 = mask & packet.range(self.boxes[child1],half_thickness,lo1);
+      int swapped = 0;
+      for (int i=0;i<packet_size;i++)
+        swapped |= (lo0[i]>lo1[i])<<i;
+      // Push the child with larger t_min first, separately for each ordering
+      const auto push = [&](const int child, const int mask, const T* t_min) {
+        if (mask) {
+          auto& e = stack.data[stack.n++];
+          e.node = child;
+          e.mask = mask;
+          memcpy(e.t_min,t_min,sizeof(e.t_min));
+        }
+      };
+      push(child1,hit1&~swapped,lo1);
+      push(child0,hit0&~swapped,lo0);
+      push(child0,hit0&swapped,lo0);
+      push(child1,hit1&swapped,lo1);
+    } else {
+      // Test all simplices in this leaf against each ray
+      const auto prims = self.prims(node);
+      for (int i=0;i<rays.size();i++)
+        if (mask&1<<i) {
+          auto& ray = rays[i];
+          for (const int t : prims)
+            if (self.simplices[t].intersection(ray,half_thickness)) {
+              packet.t_max[i] = ray.t_max;
+              ray.aggregate_id = t;
+            }
+        }
+    }
+  }
+  int hits = 0;
+  for (int i=0;i<rays.size();i++)
+    hits |= (rays[i].aggregate_id>=0)<<i;
+  return hits;
+}
+}
+
+template<class TV,int d> static int intersection_packet_dispatch(const SimplexTree<TV,d>& self, RawArray<RayIntersection<TV>> rays, const typename TV::Scalar half_thickness) {
+  GEODE_NOT_IMPLEMENTED();
+}
+
+template<> int intersection_packet_dispatch(const SimplexTree<Vector<real,2>,1>& self, RawArray<RayIntersection<Vector<real,2>>> rays, const real half_thickness) {
+  return intersection_packet_helper(self,rays,half_thickness);
+}
+
+template<> int intersection_packet_dispatch(const SimplexTree<Vector<real,3>,2>& self, RawArray<RayIntersection<Vector<real,3>>> rays, const real half_thickness) {
+  return intersection_packet_helper(self,rays,half_thickness);
+}
+
+template<class TV,int d> int SimplexTree<TV,d>::
+intersection_packet(RawArray<RayIntersection<TV>> rays, const T half_thickness) const {
+  GEODE_ASSERT(rays.size()<=packet_size);
+  if (boxes.size() == 0 || !rays.size())
+    return 0;
+  int save[packet_size];
+  for (int i=0;i<rays.size();i++) {
+    save[i] = rays[i].aggregate_id;
+    rays[i].aggregate_id = -1;
+  }
+  const int hits = intersection_packet_dispatch(*this,rays,half_thickness);
+  for (int i=0;i<rays.size();i++)
+    if (!(hits&1<<i))
+      rays[i].aggregate_id = save[i];
+  return hits;
+}
+
+template<class TV,int d> Array<RayIntersection<TV>> SimplexTree<TV,d>::
+intersection(RawArray<const Ray<TV>> rays, const T half_thickness) const {
+  Array<RayIntersection<TV>> results(rays.size(),uninit);
+  for (int i=0;i<rays.size();i++)
+    results[i] = RayIntersection<TV>(rays[i].start,rays[i].direction,true);
+  for (int i=0;i<rays.size();i+=packet_size)
+    intersection_packet(results.slice(i,min(i+packet_size,rays.size())),half_thickness);
+  return results;
+}
+
+template<class TV,int d> Tuple<Array<typename TV::Scalar>,Array<int>> SimplexTree<TV,d>::
+intersection_py(RawArray<const TV> starts, RawArray<const TV> directions, const T half_thickness) const {
+  GEODE_ASSERT(starts.size()==directions.size());
+  Array<Ray<TV>> rays(starts.size(),uninit);
+  for (int i=0;i<rays.size();i++)
+    rays[i] = Ray<TV>(starts[i],directions[i],true);
+  const auto hits = intersection(rays,half_thickness);
+  Array<T> t(hits.size(),uninit);
+  Array<int> simplex(hits.size(),uninit);
+  for (int i=0;i<hits.size();i++) {
+    t[i] = hits[i].t_max;
+    simplex[i] = hits[i].aggregate_id;
+  }
+  return tuple(t,simplex);
+}
+
+template<class TV,int d> Tuple<Array<typename TV::Scalar>,Array<int>> SimplexTree<TV,d>::
+single_ray_intersection_py(RawArray<const TV> starts, RawArray<const TV> directions, const T half_thickness) const {
+  GEODE_ASSERT(starts.size()==directions.size());
+  Array<T> t(starts.size(),uninit);
+  Array<int> simplex(starts.size(),uninit);
+  for (int i=0;i<starts.size();i++) {
+    RayIntersection<TV> ray(starts[i],directions[i],true);
+    intersection(ray,half_thickness);
+    t[i] = ray.t_max;
+    simplex[i] = ray.aggregate_id;
+  }
+  return tuple(t,simplex);
+}
+
 namespace {
 template<class TV,int d> struct SphereVisitor {
   const SimplexTree<TV,d>& self;
@@ -318,31 +574,19 @@ inside_given_closest_point(TV point, int simplex, Weights weights) const {
   return inside(point);
 }
 
-template<class TV,int d> static void closest_point_helper(const SimplexTree<TV,d>& self, TV point, int& triangle, typename TV::Scalar& sqr_distance, int node) {
-  typedef typename TV::Scalar T;
-  if (!self.is_leaf(node)) {
-    Vector<T,2> bounds(self.boxes[2*node+1].sqr_distance_bound(point),
-                       self.boxes[2*node+2].sqr_distance_bound(point));
-    int c = bounds.argmin();
-    if (bounds[c]<sqr_distance)
-      closest_point_helper<TV,d>(self,point,triangle,sqr_distance,2*node+1+c);
-    if (bounds[1-c]<sqr_distance)
-      closest_point_helper<TV,d>(self,point,triangle,sqr_distance,2*node+2-c);
-  } else
-    for (int t : self.prims(node)) {
-      T sqr_d = sqr_magnitude(point-self.simplices[t].closest_point(point).x);
-      if (sqr_distance>sqr_d) {
-        sqr_distance = sqr_d;
-        triangle = t;
-      }
-    }
-}
-
 template<class TV,int d> Tuple<TV,int,typename SimplexTree<TV,d>::Weights> SimplexTree<TV,d>::closest_point(const TV point, const T max_distance) const {
   int simplex = -1;
   if (nodes()) {
     T sqr_distance = sqr(max_distance);
-    closest_point_helper(*this,point,simplex,sqr_distance,0);
+    wide().closest_leaves(point,sqr_distance,[&](const int node) {
+      for (const int t : prims(node)) {
+        const T sqr_d = sqr_magnitude(point-simplices[t].closest_point(point).x);
+        if (sqr_distance>sqr_d) {
+          sqr_distance = sqr_d;
+          simplex = t;
+        }
+      }
+    });
   }
   if (simplex == -1) {
     TV x;
@@ -371,11 +615,13 @@ template<class T, int d> static int ray_traversal_test(const SimplexTree<Vector<
   const auto box = tree.bounding_box();
   const auto random = new_<Random>(819371111);
   int hits = 0;
+  Array<RayIntersection<TV>> packets;
   for (int i=0;i<rays;i++) {
     const TV start = random->uniform(box);
     RayIntersection<TV> ray(start,random->direction<TV>());
     ray.t_max = 2;
     auto copy = ray;
+    packets.append(ray);
     const bool hit = tree.intersection(ray,half_thickness);
     bool slow_hit = false;
     for (const auto& simplex : tree.simplices)
@@ -385,6 +631,18 @@ template<class T, int d> static int ray_traversal_test(const SimplexTree<Vector<
       }
     GEODE_ASSERT(hit==slow_hit);
     hits += hit;
+    // Packets must match single ray traversal exactly
+    if (packets.size()==16 || i==rays-1) {
+      const int mask = tree.intersection_packet(packets,half_thickness);
+      for (int j=0;j<packets.size();j++) {
+        RayIntersection<TV> single = packets[j];
+        single.t_max = 2;
+        single.aggregate_id = -1;
+        GEODE_ASSERT(tree.intersection(single,half_thickness)==((mask&1<<j)!=0));
+        GEODE_ASSERT(single.t_max==packets[j].t_max && single.aggregate_id==packets[j].aggregate_id);
+      }
+      packets.clear();
+    }
   }
   return hits;
 }
@@ -401,8 +659,11 @@ template<class TV,int d> static void wrap_helper() {
     .GEODE_FIELD(X)
     .GEODE_FIELD(d)
     .GEODE_METHOD(update)
+    .GEODE_METHOD(update_moved)
     .GEODE_METHOD(closest_point)
     .GEODE_METHOD(distance)
+    .GEODE_METHOD_2("intersection",intersection_py)
+    .GEODE_METHOD_2("single_ray_intersection",single_ray_intersection_py)
     ;
 }
 
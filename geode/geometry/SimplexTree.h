@@ -5,6 +5,7 @@
 #include <geode/utility/config.h>
 #include <geode/geometry/forward.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/geometry/WideBoxTree.h>
 #include <geode/mesh/SegmentSoup.h>
 #include <geode/mesh/TriangleSoup.h>
 #include <geode/math/constants.h>
@@ -28,20 +29,44 @@ public:
   const Array<Simplex> simplices;
 
 protected:
-  GEODE_CORE_EXPORT SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size);
+  LazyWideBoxTree<TV> wide_; // 4-ary layout of the same tree for faster closest point queries
+  Array<const int> simplex_leaves; // Leaf containing each simplex, computed on first use by update_moved
+
+  GEODE_CORE_EXPORT SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size, int threads=1, bool sah=false); // See BoxTree for threads and sah
   GEODE_CORE_EXPORT SimplexTree(const SimplexTree& other, Array<const TV> X); // Shares ownership for topology (mesh, tree structure, etc.) but not geometry (X,boxes,simplices)
 public:
   ~SimplexTree();
 
   GEODE_CORE_EXPORT void update(); // Call whenever X changes
+
+  // Call when only X[moved] have changed.  Only simplices touching moved vertices, their leaves, and the
+  // ancestors of those leaves are refit, so this is much cheaper than update() for small coherent changes.
+  // Check degradation() occasionally to decide when to rebuild instead.
+  GEODE_CORE_EXPORT void update_moved(RawArray<const int> moved);
   GEODE_CORE_EXPORT bool intersection(RayIntersection<TV>& ray, const T thickness_over_two) const;
   GEODE_CORE_EXPORT Array<RayIntersection<TV> > intersections(const RayIntersection<TV>& ray, const T thickness_over_two) const;
+
+  // Trace up to 16 rays at once, with the same effect on each ray as intersection(ray,thickness_over_two).
+  // Box tests are shared across the packet, so this is faster for coherent rays.  Returns a mask of rays with hits.
+  GEODE_CORE_EXPORT int intersection_packet(RawArray<RayIntersection<TV>> rays, const T thickness_over_two) const;
+
+  // Trace a batch of rays in packets.  Rays which miss have aggregate_id = -1 and t_max = inf.
+  GEODE_CORE_EXPORT Array<RayIntersection<TV>> intersection(RawArray<const Ray<TV>> rays, const T thickness_over_two) const;
+
+  // Python versions of the batch and single ray intersections, with rays given as starts and unit directions.
+  // Return the hit distance (inf for misses) and simplex (-1 for misses) of each ray.
+  GEODE_CORE_EXPORT Tuple<Array<T>,Array<int>> intersection_py(RawArray<const TV> starts, RawArray<const TV> directions, const T thickness_over_two) const;
+  GEODE_CORE_EXPORT Tuple<Array<T>,Array<int>> single_ray_intersection_py(RawArray<const TV> starts, RawArray<const TV> directions, const T thickness_over_two) const;
+
   GEODE_CORE_EXPORT void intersection(const Sphere<TV>& sphere, Array<int>& hits) const;
   GEODE_CORE_EXPORT void intersections(const Plane<T>& plane, Array<Segment<TV>>& result) const;
   GEODE_CORE_EXPORT bool inside(TV point) const;
   GEODE_CORE_EXPORT bool inside_given_closest_point(TV point, int simplex, Weights weights) const;
   GEODE_CORE_EXPORT T distance(TV point, T max_distance=inf) const; // return value is infinity if nothing is found
 
+  // 4-ary layout of the same tree for closest point queries, built on first use and refit after updates
+  const WideBoxTree<TV>& wide() const { return wide_.get(*this); }
+
   // Returns closest_point,simplex,weights.  If nothing is found, simplex = -1 and closet_point = inf.
   GEODE_CORE_EXPORT Tuple<TV,int,Weights> closest_point(const TV point, const T max_distance=inf) const;
 };
@@ -0,0 +1,133 @@
+//#####################################################################
+// Class WideBoxTree
+//#####################################################################
+#include <geode/geometry/WideBoxTree.h>
+#include <algorithm>
+namespace geode {
+
+template<class TV,int w> const int WideBoxTree<TV,w>::w;
+
+template<class TV,int w> WideBoxTree<TV,w>::WideBoxTree(const BoxTree<TV>& tree)
+  : depth(0)
+  , slots(tree.nodes()) {
+  slots.fill(-1);
+  if (!tree.nodes())
+    return;
+
+  // Build nodes in depth first order.  Each wide node starts from one binary node and repeatedly splits
+  // internal slots into their children, breadth first, until no further split fits.
+  Array<Vector<int,3>> stack; // (binary node, parent slot as w*node+slot or -1, wide depth)
+  stack.append(vec(0,-1,1));
+  Array<int> expand, next;
+  while (stack.size()) {
+    const auto top = stack.pop();
+    const int index = nodes.append(Node());
+    depth = max(depth,top.z);
+    if (top.y >= 0)
+      nodes[top.y/w].child[top.y%w] = index;
+
+    // Collect slots
+    expand.clear();
+    expand.append(top.x);
+    for (;;) {
+      int internal = 0;
+      for (const int n : expand)
+        internal += !tree.is_leaf(n);
+      if (!internal || expand.size()+internal>w)
+        break;
+      next.clear();
+      for (const int n : expand) {
+        if (tree.is_leaf(n))
+          next.append(n);
+        else
+          next.extend(asarray(tree.children(n)));
+      }
+      swap(expand,next);
+    }
+    // A leaf root is its own slot, but an internal root must be split at least once
+    GEODE_ASSERT(expand.size()>1 || tree.is_leaf(expand[0]));
+
+    auto& node = nodes[index];
+    for (int i=0;i<w;i++) {
+      node.child[i] = ~0;
+      node.binary[i] = -1;
+    }
+    for (int i=0;i<expand.size();i++) {
+      const int n = expand[i];
+      node.binary[i] = n;
+      slots[n] = w*index+i;
+      if (tree.is_leaf(n))
+        node.child[i] = ~n;
+    }
+    // Push internal slots in reverse so that the first slot's subtree comes next
+    for (int i=expand.size()-1;i>=0;i--)
+      if (!tree.is_leaf(expand[i]))
+        stack.append(vec(expand[i],w*index+i,top.z+1));
+  }
+  update(tree);
+}
+
+template<class TV,int w> static inline void copy_box(typename WideBoxTree<TV,w>::Node& node, const int i, const Box<TV>& box) {
+  for (int a=0;a<TV::m;a++) {
+    node.min[a][i] = box.min[a];
+    node.max[a][i] = box.max[a];
+  }
+}
+
+template<class TV,int w> void WideBoxTree<TV,w>::update(const BoxTree<TV>& tree) {
+  GEODE_ASSERT(slots.size()==tree.nodes());
+  const auto empty = Box<TV>::empty_box();
+  for (auto& node : nodes)
+    for (int i=0;i<w;i++)
+      copy_box<TV,w>(node,i,node.binary[i]>=0 ? tree.boxes[node.binary[i]] : empty);
+}
+
+template<class TV,int w> void WideBoxTree<TV,w>::update(const BoxTree<TV>& tree, RawArray<const int> dirty_leaves) {
+  GEODE_ASSERT(slots.size()==tree.nodes());
+  // Every binary node with a slot lies on the path from some dirty leaf to the root
+  Array<int> dirty;
+  for (int n : dirty_leaves) {
+    GEODE_ASSERT(tree.leaves.contains(n));
+    for (;;) {
+      if (slots[n] >= 0)
+        dirty.append(slots[n]);
+      if (!n)
+        break;
+      n = tree.parent(n);
+    }
+  }
+  std::sort(dirty.begin(),dirty.end());
+  dirty.resize(int(std::unique(dirty.begin(),dirty.end())-dirty.begin()));
+  for (const int s : dirty) {
+    auto& node = nodes[s/w];
+    copy_box<TV,w>(node,s%w,tree.boxes[node.binary[s%w]]);
+  }
+}
+
+template<class TV,int w> const WideBoxTree<TV,w>& LazyWideBoxTree<TV,w>::get(const BoxTree<TV>& binary) const {
+  if (!current.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!current.load(std::memory_order_relaxed)) {
+      if (!built)
+        tree = WideBoxTree<TV,w>(binary);
+      else if (all_dirty)
+        tree.update(binary);
+      else
+        tree.update(binary,dirty_leaves);
+      built = true;
+      all_dirty = false;
+      dirty_leaves.clear();
+      current.store(true,std::memory_order_release);
+    }
+  }
+  return tree;
+}
+
+#define INSTANTIATE(d,w) \
+  template class WideBoxTree<Vector<real,d>,w>; \
+  template class LazyWideBoxTree<Vector<real,d>,w>;
+INSTANTIATE(2,4)
+INSTANTIATE(2,8)
+INSTANTIATE(3,4)
+INSTANTIATE(3,8)
+}
@@ -0,0 +1,133 @@
+//#####################################################################
+// Class WideBoxTree
+//#####################################################################
+//
+// WideBoxTree is a flattened w-ary view of a BoxTree (w = 4 or 8), built by collapsing the top levels of
+// each binary subtree into one wide node.  Each wide node stores the boxes of its children as structure of
+// arrays, so that one vectorized loop tests a point against all children at once, and a traversal touches
+// a few cache lines per wide node instead of one per binary node.
+//
+// The wide tree only stores boxes: leaves refer back to binary leaves, so primitives are still found via
+// BoxTree::prims.  After changing the boxes of the binary tree, call update to refit.
+//
+// LazyWideBoxTree holds a WideBoxTree that is built on first use and refit on the next use after the binary
+// tree's boxes change, so trees that never need it pay nothing.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/geometry/BoxTree.h>
+#include <geode/array/alloca.h>
+#include <geode/array/RawStack.h>
+#include <geode/math/sqr.h>
+#include <geode/structure/Tuple.h>
+#include <atomic>
+#include <mutex>
+namespace geode {
+
+template<class TV,int w_=4> class WideBoxTree {
+  typedef typename TV::Scalar T;
+  static const int m = TV::m;
+public:
+  static const int w = w_;
+  static_assert(w==4 || w==8,"Only 4-ary and 8-ary trees are supported");
+
+  struct Node {
+    T min[m][w], max[m][w]; // Unused slots have empty boxes
+    int child[w]; // >= 0 for wide nodes, ~n for binary leaf n, and unused otherwise
+    int binary[w]; // Binary node corresponding to each slot, or -1 if unused
+  };
+
+  Array<Node> nodes; // Root first, then depth first order
+  int depth; // Maximum number of wide nodes on a path from root to leaf
+  Array<int> slots; // Binary node to w*node+slot for the wide slot containing it, or -1
+
+  WideBoxTree();
+  GEODE_CORE_EXPORT explicit WideBoxTree(const BoxTree<TV>& tree);
+
+  // Copy boxes from the binary tree, which must be the one we were built from
+  GEODE_CORE_EXPORT void update(const BoxTree<TV>& tree);
+
+  // Copy boxes of the given leaves and their ancestors from the binary tree.  Duplicates are fine.
+  GEODE_CORE_EXPORT void update(const BoxTree<TV>& tree, RawArray<const int> dirty_leaves);
+
+  // Lower bounds on the squared distance from point to the boxes of each slot, computed together
+  void sqr_distance_bounds(const Node& node, const TV& point, T* bounds) const {
+    for (int i=0;i<w;i++)
+      bounds[i] = 0;
+    for (int a=0;a<m;a++)
+      for (int i=0;i<w;i++) {
+        const T d = max(T(0),max(node.min[a][i]-point[a],point[a]-node.max[a][i]));
+        bounds[i] += d*d;
+      }
+  }
+
+  // Visit binary leaves in order of increasing box distance from point, skipping boxes no closer than
+  // sqr_distance.  leaf(n) may lower sqr_distance to prune the rest of the search.
+  template<class Leaf> void closest_leaves(const TV point, T& sqr_distance, Leaf&& leaf) const {
+    if (!nodes.size())
+      return;
+    RawStack<Tuple<int,T>> stack(GEODE_RAW_ALLOCA(w*depth,Tuple<int,T>)); // Each entry is (child,bound)
+    stack.push(tuple(0,T(0)));
+    T bounds[w];
+    int order[w];
+    while (stack.size()) {
+      const auto entry = stack.pop();
+      if (!(entry.y<sqr_distance)) // Check again since sqr_distance may have shrunk
+        continue;
+      if (entry.x < 0) {
+        leaf(~entry.x);
+        continue;
+      }
+      // Push children farthest first, so that the closest child is visited next
+      const Node& node = nodes[entry.x];
+      sqr_distance_bounds(node,point,bounds);
+      int n = 0;
+      for (int i=0;i<w;i++)
+        if (bounds[i]<sqr_distance) {
+          int j = n++;
+          for (;j && bounds[order[j-1]]<bounds[i];j--)
+            order[j] = order[j-1];
+          order[j] = i;
+        }
+      for (int j=0;j<n;j++)
+        stack.push(tuple(node.child[order[j]],bounds[order[j]]));
+    }
+  }
+};
+
+template<class TV,int w> inline WideBoxTree<TV,w>::WideBoxTree()
+  : depth(0) {}
+
+template<class TV,int w=4> class LazyWideBoxTree {
+  mutable WideBoxTree<TV,w> tree;
+  mutable std::mutex mutex;
+  mutable std::atomic<bool> current; // Is tree built and up to date?
+  mutable bool built, all_dirty;
+  mutable Array<int> dirty_leaves;
+public:
+  LazyWideBoxTree()
+    : current(false), built(false), all_dirty(false) {}
+
+  // The wide tree for the given binary tree, which must always be the same one.  Safe to call from several
+  // threads at once.
+  GEODE_CORE_EXPORT const WideBoxTree<TV,w>& get(const BoxTree<TV>& binary) const;
+
+  // Note that all boxes or those of the given leaves and their ancestors have changed.  These must not run
+  // concurrently with get.
+  void boxes_changed() {
+    if (built) {
+      all_dirty = true;
+      dirty_leaves.clear();
+    }
+    current = false;
+  }
+
+  void boxes_changed(RawArray<const int> leaves) {
+    if (built && !all_dirty)
+      dirty_leaves.extend(leaves);
+    current = false;
+  }
+};
+
+}
@@ -6,9 +6,9 @@ from geode import *
 from numpy import asarray
 
 BoxTrees = {2:BoxTree2d,3:BoxTree3d}
-def BoxTree(X,leaf_size):
+def BoxTree(X,leaf_size,threads=1,sah=False):
   X = asarray(X)
-  return BoxTrees[X.shape[1]](X,leaf_size)
+  return BoxTrees[X.shape[1]](X,leaf_size,threads,sah)
 
 ParticleTrees = {2:ParticleTree2d,3:ParticleTree3d}
 def ParticleTree(X,leaf_size=1):
@@ -50,5 +50,5 @@ def FrameImplicit(frame,object):
   return FrameImplicits[object.d](frame,object)
 
 surface_levelsets = {1:surface_levelset_c3d,2:surface_levelset_s3d}
-def surface_levelset(particles,surface,max_distance=inf,compute_signs=True):
-  return surface_levelsets[surface.d](particles,surface,max_distance,compute_signs)
+def surface_levelset(particles,surface,max_distance=inf,compute_signs=True,threads=1):
+  return surface_levelsets[surface.d](particles,surface,max_distance,compute_signs,threads)
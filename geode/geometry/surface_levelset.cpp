@@ -7,9 +7,9 @@
 #include <geode/geometry/Segment.h>
 #include <geode/geometry/Triangle3d.h>
 #include <geode/array/ProjectedArray.h>
-#include <geode/array/ConstantMap.h>
 #include <geode/python/wrap.h>
 #include <geode/utility/Log.h>
+#include <geode/utility/openmp.h>
 #include <limits>
 namespace geode {
 
@@ -23,63 +23,6 @@ namespace {
 
 static const bool profile = false;
 GEODE_UNUSED static uint64_t evaluation_count;
-
-static inline T lower_bound_sqr_phi(const TV& n1, const Box<TV>& n2) {
-  return sqr_magnitude(n1-n2.clamp(n1));
-}
-
-static inline T lower_bound_sqr_phi(const Box<TV>& n1, const Box<TV>& n2) {
-  return sqr_magnitude((n1-n2).clamp(TV()));
-}
-
-template<int d> struct Helper {
-  const ParticleTree<TV>& particles;
-  const SimplexTree<TV,d>& surface;
-  RawArray<T> sqr_phi_node;
-  RawArray<CloseInfo<d>> info; // phi = sqr_phi, normal = delta
-
-  void eval(const int pn, const int sn) const {
-    const Box<TV> &pbox = particles.boxes[pn],
-                  &sbox = surface.boxes[sn];
-    const bool pleaf = particles.is_leaf(pn),
-               sleaf = surface.is_leaf(sn);
-    if (pleaf && sleaf) { // Two leaves: compute all pairwise distances
-      sqr_phi_node[pn] = 0;
-      const auto particle_prims = particles.prims(pn);
-      const auto surface_prims = surface.prims(sn);
-      for (const int p : particle_prims) {
-        if (info[p].phi > lower_bound_sqr_phi(particles.X[p],sbox))
-          for (const int t : surface_prims) {
-            if (profile)
-              evaluation_count++;
-            const auto close = surface.simplices[t].closest_point(particles.X[p]);
-            const TV delta = particles.X[p] - close.x;
-            const T sd = sqr_magnitude(delta);
-            if (info[p].phi > sd)
-              info[p] = CloseInfo<d>({sd,delta,t,close.y});
-          }
-        sqr_phi_node[pn] = max(sqr_phi_node[pn],info[p].phi);
-      }
-    } else if (pleaf || (!sleaf && pbox.sizes().max()<=sbox.sizes().max())) {
-      // Recurse into surface_node
-      const auto sc = surface.children(sn);
-      const auto bounds = vec(lower_bound_sqr_phi(pbox,surface.boxes[sc.x]),
-                              lower_bound_sqr_phi(pbox,surface.boxes[sc.y]));
-      const int c = bounds.argmin();
-      if (sqr_phi_node[pn] > bounds[c])
-        eval(pn,sc[c]);
-      if (sqr_phi_node[pn] > bounds[1-c])
-        eval(pn,sc[1-c]);
-    } else { // Recurse into particle_node
-      sqr_phi_node[pn] = 0;
-      for (const int c : particles.children(pn)) {
-        if (sqr_phi_node[c] > lower_bound_sqr_phi(particles.boxes[c],sbox))
-          eval(c,sn);
-        sqr_phi_node[pn] = max(sqr_phi_node[pn],sqr_phi_node[c]);
-      }
-    }
-  }
-};
 }
 
 static TV normal_flip(const Segment<TV>& seg, const TV u) {
@@ -100,9 +43,24 @@ static TV normal_flip(const Triangle<TV>& tri, const TV u) {
 static TV normal_noflip(const Segment<TV>& seg) { GEODE_UNREACHABLE(); }
 static TV normal_noflip(const Triangle<TV>& tri) { return tri.n; }
 
+// Find the closest simplex to x closer than sqrt(I.phi), leaving I alone if there is none
+template<int d> static inline void closest(const SimplexTree<TV,d>& surface, const TV x, CloseInfo<d>& I) {
+  surface.wide().closest_leaves(x,I.phi,[&](const int node) {
+    for (const int t : surface.prims(node)) {
+      if (profile)
+        evaluation_count++;
+      const auto close = surface.simplices[t].closest_point(x);
+      const TV delta = x-close.x;
+      const T sd = sqr_magnitude(delta);
+      if (I.phi > sd)
+        I = CloseInfo<d>({sd,delta,t,close.y});
+    }
+  });
+}
+
 template<int d> void surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& surface,
                                       RawArray<typename Hide<CloseInfo<d>>::type> info,
-                                      const T max_distance, const bool compute_signs) {
+                                      const T max_distance, const bool compute_signs, const int threads) {
   GEODE_ASSERT(particles.X.size()==info.size());
   const T sqr_max_distance = sqr(max_distance);
   for (auto& I : info) {
@@ -111,9 +69,33 @@ template<int d> void surface_levelset(const ParticleTree<TV>& particles, const S
   }
   if (profile)
     evaluation_count = 0;
-  const auto sqr_phi_node = constant_map(particles.nodes(),sqr_max_distance).copy();
-  if (particles.X.size() && surface.simplices.size())
-    Helper<d>({particles,surface,sqr_phi_node,info}).eval(0,0);
+
+  // Particle leaves are independent tasks, so results do not depend on threads.  Within a leaf, the first
+  // particle's distance plus the distance between particles bounds the rest of the leaf.  Any strict upper
+  // bound prunes only subtrees farther than the closest simplex, so it changes nothing but the speed.
+  if (surface.simplices.size())
+    parallel_for(particles.leaves.size(),threads,[&](const int leaf) {
+      const auto prims = particles.prims(particles.leaves.lo+leaf);
+      if (!prims.size())
+        return;
+      const TV x0 = particles.X[prims[0]];
+      closest(surface,x0,info[prims[0]]);
+      const auto& I0 = info[prims[0]];
+      const T phi0 = I0.simplex>=0 ? sqrt(I0.phi) : inf;
+      for (const int p : prims.slice(1,prims.size())) {
+        const TV x = particles.X[p];
+        auto& I = info[p];
+        const T bound = (1+1e-8)*sqr(phi0+magnitude(x-x0));
+        if (bound < sqr_max_distance) {
+          I.phi = bound;
+          closest(surface,x,I);
+          if (I.simplex >= 0)
+            continue;
+          I.phi = sqr_max_distance; // Rounding defeated the bound, so search again without it
+        }
+        closest(surface,x,I);
+      }
+    });
   if (profile) {
     long slow_count = (long)particles.X.size()*surface.simplices.size();
     cout << "particles = "<<particles.X.size()<<", per particle "<<evaluation_count/particles.X.size()<<endl;
@@ -122,41 +104,46 @@ template<int d> void surface_levelset(const ParticleTree<TV>& particles, const S
   }
   const T epsilon = sqrt(numeric_limits<T>::epsilon())*max(particles.bounding_box().sizes().max(),
                                                              surface.bounding_box().sizes().max());
+  const int chunks = threads>1 ? 16*threads : 1;
   if (d<TV::m-1 || !compute_signs)
-    for (auto& I : info) {
-      I.phi = sqrt(I.phi);
-      I.normal = ((I.simplex) < 0)   ? TV()  // Parenthesis around I.simplex avoid parse error in MinGW-W64 version 4.9.2 of g++
-               : (I.phi > epsilon) ? I.normal / I.phi
-                                   : normal_flip(surface.simplices[I.simplex],I.normal);
-    }
+    parallel_for(chunks,threads,[&](const int chunk) {
+      for (auto& I : info.slice(partition_loop(info.size(),chunks,chunk))) {
+        I.phi = sqrt(I.phi);
+        I.normal = ((I.simplex) < 0)   ? TV()  // Parenthesis around I.simplex avoid parse error in MinGW-W64 version 4.9.2 of g++
+                 : (I.phi > epsilon) ? I.normal / I.phi
+                                     : normal_flip(surface.simplices[I.simplex],I.normal);
+      }
+    });
   else // compute_signs
-    for (const int i : range(info.size())) {
-      auto& I = info[i];
-      I.phi = sqrt(I.phi);
-      if ((I.simplex) < 0) // Parentheses needed for parse error in gcc 4.9
-        I.normal = TV();
-      else {
-        try {
-          const bool inside = surface.inside_given_closest_point(particles.X[i],I.simplex,I.weights);
-          if (inside)
-            I.phi = -I.phi;
-          if (abs(I.phi) > epsilon)
-            I.normal /= I.phi;
-          else
+    parallel_for(chunks,threads,[&](const int chunk) {
+      for (const int i : partition_loop(info.size(),chunks,chunk)) {
+        auto& I = info[i];
+        I.phi = sqrt(I.phi);
+        if ((I.simplex) < 0) // Parentheses needed for parse error in gcc 4.9
+          I.normal = TV();
+        else {
+          try {
+            const bool inside = surface.inside_given_closest_point(particles.X[i],I.simplex,I.weights);
+            if (inside)
+              I.phi = -I.phi;
+            if (abs(I.phi) > epsilon)
+              I.normal /= I.phi;
+            else
+              I.normal = normal_noflip(surface.simplices[I.simplex]);
+          } catch (const ArithmeticError&) { // Inside test failed, assume zero
+            I.phi = 0;
             I.normal = normal_noflip(surface.simplices[I.simplex]);
-        } catch (const ArithmeticError&) { // Inside test failed, assume zero
-          I.phi = 0;
-          I.normal = normal_noflip(surface.simplices[I.simplex]);
+          }
         }
       }
-    }
+    });
 }
 
 template<int d> Tuple<Array<T>,Array<TV>,Array<int>,Array<typename SimplexTree<TV,d>::Weights>>
 surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& surface,
-                 const T max_distance, const bool compute_signs) {
+                 const T max_distance, const bool compute_signs, const int threads) {
   Array<CloseInfo<d>> info(particles.X.size(),uninit);
-  surface_levelset<d>(particles,surface,info,max_distance,compute_signs);
+  surface_levelset<d>(particles,surface,info,max_distance,compute_signs,threads);
   return tuple(info.template project<T,&CloseInfo<d>::phi>().copy(),
                info.template project<TV,&CloseInfo<d>::normal>().copy(),
                info.template project<int,&CloseInfo<d>::simplex>().copy(),
@@ -164,9 +151,9 @@ surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& sur
 }
 
 #define INSTANTIATE(d) \
-  template void surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,RawArray<CloseInfo<d>>,T,bool); \
+  template void surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,RawArray<CloseInfo<d>>,T,bool,int); \
   template Tuple<Array<T>,Array<TV>,Array<int>,Array<typename SimplexTree<TV,d>::Weights>> \
-    surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,const T,const bool);
+    surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,const T,const bool,const int);
 INSTANTIATE(1)
 INSTANTIATE(2)
 
@@ -202,8 +189,8 @@ using namespace geode;
 
 void wrap_surface_levelset() {
   GEODE_FUNCTION_2(surface_levelset_c3d,static_cast<Tuple<Array<T>,Array<TV>,Array<int>,Array<T>>(*)(
-    const ParticleTree<TV>&,const SimplexTree<TV,1>&,T,bool)>(surface_levelset))
+    const ParticleTree<TV>&,const SimplexTree<TV,1>&,T,bool,int)>(surface_levelset))
   GEODE_FUNCTION_2(surface_levelset_s3d,static_cast<Tuple<Array<T>,Array<TV>,Array<int>,Array<TV>>(*)(
-    const ParticleTree<TV>&,const SimplexTree<TV,2>&,T,bool)>(surface_levelset))
+    const ParticleTree<TV>&,const SimplexTree<TV,2>&,T,bool,int)>(surface_levelset))
   GEODE_FUNCTION(slow_surface_levelset)
 }
@@ -20,15 +20,18 @@ template<int d> struct CloseInfo {
   typename SimplexTree<TV,d>::Weights weights;
 };
 
+// Particles are processed one ParticleTree leaf at a time, in parallel if threads > 1.  The results do not
+// depend on the number of threads.
 template<int d> GEODE_CORE_EXPORT void surface_levelset(const ParticleTree<Vector<real,3>>& particles,
                                                         const SimplexTree<Vector<real,3>,d>& surface,
                                                         RawArray<typename Hide<CloseInfo<d>>::type> info,
-                                                        const real max_distance=inf, const bool compute_signs=true);
+                                                        const real max_distance=inf, const bool compute_signs=true,
+                                                        const int threads=1);
 
 // Functional-style version: returns distance, normals, closest simplex, and barycentric weights per point.
 template<int d> GEODE_CORE_EXPORT Tuple<Array<real>,Array<Vector<real,3>>,
                                         Array<int>,Array<typename SimplexTree<Vector<real,3>,d>::Weights>>
 surface_levelset(const ParticleTree<Vector<real,3>>& particles, const SimplexTree<Vector<real,3>,d>& surface,
-                 const real max_distance=inf, const bool compute_signs=true);
+                 const real max_distance=inf, const bool compute_signs=true, const int threads=1);
 
 }
@@ -12,6 +12,16 @@ def test_box_tree():
     tree = BoxTree(x,10)
     tree.check(x)
 
+def test_box_tree_build():
+  random.seed(10098331)
+  for d in 2,3:
+    x = random.randn(20000,d).astype(real)
+    for sah in False,True:
+      tree = BoxTree(x,4,sah=sah)
+      tree.check(x)
+      for threads in 2,5:
+        assert all(BoxTree(x,4,threads=threads,sah=sah).p==tree.p)
+
 def test_particle_tree():
   random.seed(10098331)
   for n in 0,1,35,99,100,101,199,200,201:
@@ -23,6 +33,30 @@ def test_particle_tree():
     tree.update()
     tree.check(X)
 
+def test_remove_duplicates():
+  random.seed(10098331)
+  X = random.randn(5000,3).astype(real)
+  X = concatenate([X,X[:2000]+1e-7*random.randn(2000,3)])
+  tree = ParticleTree(X,4)
+  map = tree.remove_duplicates(1e-5)
+  assert map.max()==4999
+  for threads in 2,5:
+    assert all(tree.parallel_remove_duplicates(1e-5,threads)==map)
+
+def test_closest_point():
+  random.seed(10098331)
+  for leaf_size in 1,3:
+    X = random.randn(1000,3).astype(real)
+    tree = ParticleTree(X,leaf_size)
+    for p in random.randn(20,3):
+      x,i = tree.closest_point(p,inf)
+      assert i==argmin(magnitudes(X-p)) and all(x==X[i])
+    mesh,Y = sphere_mesh(3)
+    surface = SimplexTree(mesh,Y,leaf_size)
+    for p in 2*random.randn(20,3):
+      x,t,w = surface.closest_point(p,inf)
+      assert abs(magnitude(p-x)-abs(magnitude(p)-1))<.05
+
 def test_simplex_tree():
   mesh,X = sphere_mesh(4)
   tree = SimplexTree(mesh,X,4)
@@ -31,5 +65,36 @@ def test_simplex_tree():
   print 'rays = %d, hits = %d'%(rays,hits)
   assert hits==642
 
+def test_simplex_tree_batch():
+  random.seed(10098331)
+  mesh,X = sphere_mesh(3)
+  tree = SimplexTree(mesh,X,4)
+  # Random rays, many of which miss, plus rays through each vertex which hit several triangles at the same distance
+  starts = concatenate([4*random.rand(500,3)-2,3*X,3*X])
+  directions = concatenate([random.randn(500,3),-X,X])
+  directions /= magnitudes(directions)[:,None]
+  for thickness in 0,1e-6:
+    t,simplex = tree.intersection(starts,directions,thickness)
+    single = tree.single_ray_intersection(starts,directions,thickness)
+    assert all(t==single[0]) and all(simplex==single[1])
+    assert all((simplex<0)==(t==inf))
+    assert sum(simplex<0)>len(X)
+  assert sum(abs(t[500:500+len(X)]-2)<1e-5)>len(X)//2
+
+def test_simplex_tree_refit():
+  random.seed(10098331)
+  mesh,X = sphere_mesh(3)
+  X = X.copy()
+  full = SimplexTree(mesh,X,4)
+  partial = SimplexTree(mesh,X,4)
+  assert full.degradation()==1
+  moved = arange(0,len(X),7).astype(int32)
+  X[moved] += .2*random.randn(len(moved),3)
+  full.update()
+  partial.update_moved(moved)
+  assert full.degradation()==partial.degradation()>1
+  for p in random.randn(100,3):
+    assert all(full.closest_point(p)[0]==partial.closest_point(p)[0])
+
 if __name__=='__main__':
   test_simplex_tree()
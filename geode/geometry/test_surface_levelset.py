@@ -31,6 +31,10 @@ def test_surface_levelset():
   assert maxabs(magnitudes(closest)-1) < .002
   closest2 = (weights.reshape(-1,3,1)*X[mesh.elements[triangles]]).sum(axis=1)
   assert relative_error(closest,closest2) < 1e-7
+  # Threads must not change anything
+  for threads in 2,5:
+    for a,b in zip(surface_levelset(particles,surface,10,True,threads),(phi,normal,triangles,weights)):
+      assert all(a==b)
   # Compare with slow mesh distances
   print 'slow'
   phi2,normal2,_,_ = slow_surface_levelset(particles,surface)
@@ -7,15 +7,17 @@
 #include <geode/array/RawStack.h>
 #include <geode/array/view.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/math/integer_log.h>
+#include <geode/utility/openmp.h>
+#include <geode/utility/Unique.h>
+#include <vector>
 namespace geode {
 
-// Traverse one box tree.  There is no automatic culling: the visitor is responsible for everything.
-template<class Visitor,class TV> static void single_traverse(const BoxTree<TV>& tree, Visitor&& visitor) {
-  if (!tree.nodes())
-    return;
+// Helper function for traversal of one box tree starting at a given node
+template<class Visitor,class TV> static void
+single_traverse_helper(const BoxTree<TV>& tree, Visitor&& visitor, RawStack<int> stack, const int start) {
   const int internal = tree.leaves.lo;
-  RawStack<int> stack(GEODE_RAW_ALLOCA(tree.depth,int));
-  stack.push(0);
+  stack.push(start);
   while (stack.size()) {
     const int n = stack.pop();
     if (visitor.cull(n))
@@ -28,6 +30,13 @@ template<class Visitor,class TV> static void single_traverse(const BoxTree<TV>&
   }
 }
 
+// Traverse one box tree.  There is no automatic culling: the visitor is responsible for everything.
+template<class Visitor,class TV> static void single_traverse(const BoxTree<TV>& tree, Visitor&& visitor) {
+  if (!tree.nodes())
+    return;
+  single_traverse_helper(tree,visitor,RawStack<int>(GEODE_RAW_ALLOCA(tree.depth,int)),0);
+}
+
 // Helper function for doubly recursive traversal of two box trees starting at given nodes
 template<class Visitor,class Thickness,class TV> static void
 double_traverse_helper(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor&& visitor,
@@ -72,14 +81,12 @@ double_traverse_helper(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visit
   double_traverse_helper(tree0,tree1,visitor,stack,0,0,thickness);
 }
 
-// Helper function traversing a hierarchy against itself starting at the roots.
+// Helper function traversing a hierarchy against itself starting at a given node.
+// The stack must have room for 6*tree.depth entries.
 template<class Visitor,class Thickness,class TV> static void
-double_traverse_helper(const BoxTree<TV>& tree, Visitor&& visitor, Thickness thickness) {
-  if (!tree.nodes())
-    return;
+double_traverse_helper(const BoxTree<TV>& tree, Visitor&& visitor, RawStack<int> stack, const int start, Thickness thickness) {
   const int internal = tree.leaves.lo;
-  RawStack<int> stack(GEODE_RAW_ALLOCA(6*tree.depth,int));
-  stack.push(0);
+  stack.push(start);
   while (stack.size()) {
     const int n = stack.pop();
     if (visitor.cull(n))
@@ -95,6 +102,14 @@ double_traverse_helper(const BoxTree<TV>& tree, Visitor&& visitor, Thickness thi
   }
 }
 
+// Helper function traversing a hierarchy against itself starting at the roots.
+template<class Visitor,class Thickness,class TV> static void
+double_traverse_helper(const BoxTree<TV>& tree, Visitor&& visitor, Thickness thickness) {
+  if (!tree.nodes())
+    return;
+  double_traverse_helper(tree,visitor,RawStack<int>(GEODE_RAW_ALLOCA(6*tree.depth,int)),0,thickness);
+}
+
 // Traverse all intersecting pairs of leaf boxes between two distinct hierarchies.  Box/box intersection culling
 // is automatic, but the visitor can provide additional culling by returning true from visitor.cull(...).
 template<class Visitor,class TV> static void
@@ -123,4 +138,224 @@ template<class Visitor,class TV> static void double_traverse(const BoxTree<TV>&
   double_traverse_helper(tree,visitor,Zero());
 }
 
+// Parallel traversal
+//
+// The parallel variants below split the top levels of the tree(s) into independent tasks and traverse the
+// tasks concurrently, each with its own stack and its own visitor.  In addition to cull and leaf, the visitor
+// must provide
+//
+//   Visitor split() const;    // A fresh visitor for one task, sharing any read-only state
+//   void join(Visitor& task); // Absorb the results of a finished task
+//
+// Culls above the task level are evaluated serially on the original visitor, and tasks are joined on the
+// calling thread in serial traversal order.  A visitor which only accumulates results in leaf therefore
+// reproduces the serial result exactly.  For per thread setup (e.g., rounding modes), use the *_tasks and
+// *_task routines directly.
+
+// Tasks start roughly this many levels below the root, giving each thread several tasks to balance load
+static inline int traverse_task_level(const int threads) {
+  return integer_log(uint32_t(64*max(threads,1)));
+}
+
+static inline int traverse_level(const int node) {
+  return integer_log(uint32_t(node+1));
+}
+
+// Split a traversal of one tree into subtrees, in serial traversal order
+template<class Visitor,class TV> static Array<const int>
+single_traverse_tasks(const BoxTree<TV>& tree, Visitor&& visitor, const int threads) {
+  Array<int> tasks;
+  if (!tree.nodes())
+    return tasks;
+  const int level = traverse_task_level(threads);
+  RawStack<int> stack(GEODE_RAW_ALLOCA(tree.depth,int));
+  stack.push(0);
+  while (stack.size()) {
+    const int n = stack.pop();
+    if (tree.is_leaf(n) || traverse_level(n) >= level)
+      tasks.append(n);
+    else if (!visitor.cull(n)) {
+      stack.push(2*n+1);
+      stack.push(2*n+2);
+    }
+  }
+  return tasks;
+}
+
+template<class Visitor,class TV> static void
+single_traverse_task(const BoxTree<TV>& tree, Visitor&& visitor, const int task) {
+  single_traverse_helper(tree,visitor,RawStack<int>(GEODE_RAW_ALLOCA(tree.depth,int)),task);
+}
+
+// Split a traversal of two distinct trees into pairs of subtrees, in serial traversal order
+template<class Visitor,class Thickness,class TV> static Array<const Vector<int,2>>
+double_traverse_tasks(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor&& visitor, const int threads,
+                      Thickness thickness) {
+  Array<Vector<int,2>> tasks;
+  if (!tree0.nodes() || !tree1.nodes())
+    return tasks;
+  const int level = traverse_task_level(threads),
+            internal0 = tree0.leaves.lo,
+            internal1 = tree1.leaves.lo;
+  RawStack<Vector<int,2>> stack(GEODE_RAW_ALLOCA(3*max(tree0.depth,tree1.depth),Vector<int,2>));
+  stack.push(vec(0,0));
+  while (stack.size()) {
+    const auto n = stack.pop();
+    if (   (n.x >= internal0 && n.y >= internal1)
+        || traverse_level(n.x)+traverse_level(n.y) >= level)
+      tasks.append(n);
+    else if (!visitor.cull(n.x,n.y) && tree0.boxes[n.x].intersects(tree1.boxes[n.y],thickness)) {
+      if (n.x < internal0) {
+        if (n.y < internal1) {
+          stack.push(vec(2*n.x+1,2*n.y+1));
+          stack.push(vec(2*n.x+1,2*n.y+2));
+          stack.push(vec(2*n.x+2,2*n.y+1));
+          stack.push(vec(2*n.x+2,2*n.y+2));
+        } else {
+          stack.push(vec(2*n.x+1,n.y));
+          stack.push(vec(2*n.x+2,n.y));
+        }
+      } else {
+        stack.push(vec(n.x,2*n.y+1));
+        stack.push(vec(n.x,2*n.y+2));
+      }
+    }
+  }
+  return tasks;
+}
+
+template<class Visitor,class Thickness,class TV> static void
+double_traverse_task(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor&& visitor, const Vector<int,2> task,
+                     Thickness thickness) {
+  const int buffer_size = 3*max(tree0.depth,tree1.depth);
+  double_traverse_helper(tree0,tree1,visitor,RawStack<Vector<int,2>>(GEODE_RAW_ALLOCA(buffer_size,Vector<int,2>)),
+                         task.x,task.y,thickness);
+}
+
+// Split a traversal of a tree against itself into tasks, in serial traversal order.  A task (n,-1) traverses
+// the subtree at n against itself, and a task (n0,n1) traverses two disjoint subtrees against each other.
+template<class Visitor,class Thickness,class TV> static Array<const Vector<int,2>>
+double_traverse_tasks(const BoxTree<TV>& tree, Visitor&& visitor, const int threads, Thickness thickness) {
+  Array<Vector<int,2>> tasks;
+  if (!tree.nodes())
+    return tasks;
+  const int level = traverse_task_level(threads),
+            internal = tree.leaves.lo;
+  Array<Vector<int,2>> stack;
+  stack.append(vec(0,-1));
+  while (stack.size()) {
+    const auto n = stack.pop();
+    if (n.y < 0) {
+      if (n.x >= internal || traverse_level(n.x) >= level)
+        tasks.append(n);
+      else if (!visitor.cull(n.x)) {
+        // Match the serial order: the two children against each other, then each child against itself
+        stack.append(vec(2*n.x+1,-1));
+        stack.append(vec(2*n.x+2,-1));
+        stack.append(vec(2*n.x+1,2*n.x+2));
+      }
+    } else if (   (n.x >= internal && n.y >= internal)
+               || traverse_level(n.x)+traverse_level(n.y) >= level+1)
+      tasks.append(n);
+    else if (!visitor.cull(n.x,n.y) && tree.boxes[n.x].intersects(tree.boxes[n.y],thickness)) {
+      if (n.x < internal) {
+        if (n.y < internal) {
+          stack.append(vec(2*n.x+1,2*n.y+1));
+          stack.append(vec(2*n.x+1,2*n.y+2));
+          stack.append(vec(2*n.x+2,2*n.y+1));
+          stack.append(vec(2*n.x+2,2*n.y+2));
+        } else {
+          stack.append(vec(2*n.x+1,n.y));
+          stack.append(vec(2*n.x+2,n.y));
+        }
+      } else {
+        stack.append(vec(n.x,2*n.y+1));
+        stack.append(vec(n.x,2*n.y+2));
+      }
+    }
+  }
+  return tasks;
+}
+
+template<class Visitor,class Thickness,class TV> static void
+double_traverse_task(const BoxTree<TV>& tree, Visitor&& visitor, const Vector<int,2> task, Thickness thickness) {
+  if (task.y < 0)
+    double_traverse_helper(tree,visitor,RawStack<int>(GEODE_RAW_ALLOCA(6*tree.depth,int)),task.x,thickness);
+  else
+    double_traverse_task(tree,tree,visitor,task,thickness);
+}
+
+// Traverse each task with a fresh visitor from visitor.split(), then join the task visitors in order
+template<class Visitor,class Tasks,class Traverse> static void
+parallel_traverse_helper(Visitor& visitor, const Tasks& tasks, const int threads, const Traverse& traverse) {
+  std::vector<Unique<Visitor>> locals(tasks.size());
+  parallel_for(tasks.size(),threads,[&](const int t) {
+    locals[t].reset(new Visitor(visitor.split()));
+    traverse(*locals[t],tasks[t]);
+  });
+  for (auto& local : locals)
+    visitor.join(*local);
+}
+
+// Parallel version of single_traverse
+template<class Visitor,class TV> static void
+parallel_single_traverse(const BoxTree<TV>& tree, Visitor& visitor, const int threads) {
+  if (threads <= 1)
+    return single_traverse(tree,visitor);
+  parallel_traverse_helper(visitor,single_traverse_tasks(tree,visitor,threads),threads,
+    [&](Visitor& local, const int task) { single_traverse_task(tree,local,task); });
+}
+
+template<class Visitor,class Thickness,class TV> static void
+parallel_double_traverse_helper(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor& visitor, const int threads,
+                                Thickness thickness) {
+  parallel_traverse_helper(visitor,double_traverse_tasks(tree0,tree1,visitor,threads,thickness),threads,
+    [&](Visitor& local, const Vector<int,2> task) { double_traverse_task(tree0,tree1,local,task,thickness); });
+}
+
+template<class Visitor,class Thickness,class TV> static void
+parallel_double_traverse_helper(const BoxTree<TV>& tree, Visitor& visitor, const int threads, Thickness thickness) {
+  parallel_traverse_helper(visitor,double_traverse_tasks(tree,visitor,threads,thickness),threads,
+    [&](Visitor& local, const Vector<int,2> task) { double_traverse_task(tree,local,task,thickness); });
+}
+
+// Parallel versions of double_traverse for two distinct hierarchies
+template<class Visitor,class TV> static void
+parallel_double_traverse(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor& visitor, const int threads,
+                         typename TV::Scalar thickness) {
+  GEODE_ASSERT(&tree0 != &tree1,"Identical trees should use the dedicated routine below");
+  if (threads <= 1)
+    double_traverse(tree0,tree1,visitor,thickness);
+  else if (thickness)
+    parallel_double_traverse_helper(tree0,tree1,visitor,threads,thickness);
+  else
+    parallel_double_traverse_helper(tree0,tree1,visitor,threads,Zero());
+}
+template<class Visitor,class TV> static void
+parallel_double_traverse(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor& visitor, const int threads) {
+  GEODE_ASSERT(&tree0 != &tree1,"Identical trees should use the dedicated routine below");
+  if (threads <= 1)
+    double_traverse(tree0,tree1,visitor);
+  else
+    parallel_double_traverse_helper(tree0,tree1,visitor,threads,Zero());
+}
+
+// Parallel versions of double_traverse for a hierarchy against itself
+template<class Visitor,class TV> static void
+parallel_double_traverse(const BoxTree<TV>& tree, Visitor& visitor, const int threads, typename TV::Scalar thickness) {
+  if (threads <= 1)
+    double_traverse(tree,visitor,thickness);
+  else if (thickness)
+    parallel_double_traverse_helper(tree,visitor,threads,thickness);
+  else
+    parallel_double_traverse_helper(tree,visitor,threads,Zero());
+}
+template<class Visitor,class TV> static void
+parallel_double_traverse(const BoxTree<TV>& tree, Visitor& visitor, const int threads) {
+  if (threads <= 1)
+    double_traverse(tree,visitor);
+  else
+    parallel_double_traverse_helper(tree,visitor,threads,Zero());
+}
+
 }
@@ -3,16 +3,22 @@
 //#####################################################################
 #include <geode/geometry/Box.h>
 #include <geode/image/Image.h>
+#include <geode/array/view.h>
 #include <geode/image/JpgFile.h>
 #include <geode/image/PngFile.h>
 #include <geode/image/ExrFile.h>
 #include <geode/python/Class.h>
 #include <geode/python/stl.h>
 #include <geode/utility/convert_case.h>
-#include <geode/random/Random.h>
+#include <geode/random/counter.h>
+#include <geode/utility/openmp.h>
 #include <geode/utility/path.h>
 #include <geode/utility/Log.h>
 #include <cmath>
+#include <cfloat>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
 
 namespace geode {
 
@@ -67,51 +73,180 @@ write_png_to_memory(RawArray<const Vector<T,4>,2> image) {
   return PngFile<T>::write_to_memory(image);
 }
 
+#if defined(__AVX2__) && defined(__FMA__)
+
+static inline __m256d load4(const double* x) { return _mm256_loadu_pd(x); }
+static inline __m256d load4(const float* x) { return _mm256_cvtps_pd(_mm_loadu_ps(x)); }
+static inline void store4(double* y, const __m256d v) { _mm256_storeu_pd(y,v); }
+static inline void store4(float* y, const __m256d v) { _mm_storeu_ps(y,_mm256_cvtpd_ps(v)); }
+
+// y = pow(x,p) = exp2(p*log2(x)) on four lanes, computed in double precision.  Lanes where x is not a positive
+// normal number, or where the result would leave the normal range, fall back to std::pow.  Rounding log2(x)
+// carries through exp2, so for T = double the relative error is below 3*max(1,|t|)*2^-52 with t = p*log2(x)
+// (at most 2.1*max(1,|t|)*2^-52 over random x and p).
+template<class T> static inline void pow4(const T* x, T* y, const double p) {
+  const __m256d X = load4(x),
+                one = _mm256_set1_pd(1);
+
+  // log2(x) = e+log2(m) with m in [sqrt(1/2),sqrt(2)), and log(m) = 2 atanh(s) with s = (m-1)/(m+1)
+  const __m256i bits = _mm256_castpd_si256(X);
+  const __m256d two52 = _mm256_set1_pd(4503599627370496.);
+  __m256d e = _mm256_sub_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits,52),
+                                                                           _mm256_castpd_si256(two52))),two52),
+                            _mm256_set1_pd(1023));
+  __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits,_mm256_set1_epi64x(0x000fffffffffffff)),
+                                                  _mm256_castpd_si256(one)));
+  const __m256d big = _mm256_cmp_pd(m,_mm256_set1_pd(1.4142135623730951),_CMP_GT_OQ);
+  m = _mm256_blendv_pd(m,_mm256_mul_pd(m,_mm256_set1_pd(.5)),big);
+  e = _mm256_add_pd(e,_mm256_and_pd(big,one));
+  const __m256d s = _mm256_div_pd(_mm256_sub_pd(m,one),_mm256_add_pd(m,one)),
+                s2 = _mm256_mul_pd(s,s);
+  __m256d series = _mm256_set1_pd(1./23);
+  for (int k=10;k>=0;k--)
+    series = _mm256_fmadd_pd(series,s2,_mm256_set1_pd(1./(2*k+1)));
+  const __m256d log2x = _mm256_fmadd_pd(_mm256_mul_pd(s,series),_mm256_set1_pd(2*1.4426950408889634),e);
+
+  // exp2(t) = 2^n exp(r) with n = round(t) and r = (t-n) log 2
+  static const double inverse_factorials[14] = {1,1,1./2,1./6,1./24,1./120,1./720,1./5040,1./40320,1./362880,
+                                                1./3628800,1./39916800,1./479001600,1./6227020800};
+  const __m256d t = _mm256_mul_pd(log2x,_mm256_set1_pd(p)),
+                n = _mm256_round_pd(t,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC),
+                r = _mm256_mul_pd(_mm256_sub_pd(t,n),_mm256_set1_pd(0.6931471805599453));
+  __m256d exp = _mm256_set1_pd(inverse_factorials[13]);
+  for (int k=12;k>=0;k--)
+    exp = _mm256_fmadd_pd(exp,r,_mm256_set1_pd(inverse_factorials[k]));
+  const __m256i scale = _mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)),
+                                                           _mm256_set1_epi64x(1023)),52);
+  store4(y,_mm256_mul_pd(exp,_mm256_castsi256_pd(scale)));
+
+  // Fix up special lanes
+  const __m256d good = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(X,_mm256_set1_pd(DBL_MIN),_CMP_GE_OQ),
+                                                   _mm256_cmp_pd(X,_mm256_set1_pd(DBL_MAX),_CMP_LE_OQ)),
+                                     _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.),t),_mm256_set1_pd(1000),_CMP_LE_OQ));
+  const int bad = ~_mm256_movemask_pd(good)&15;
+  if (bad)
+    for (int k=0;k<4;k++)
+      if (bad>>k&1)
+        y[k] = T(std::pow(double(x[k]),p));
+}
+
+#else
+
+template<class T> static inline void pow4(const T* x, T* y, const double p) {
+  for (int k=0;k<4;k++)
+    y[k] = T(std::pow(double(x[k]),p));
+}
+
+#endif
+
 template<class T> Array<Vector<T,3>,2> Image<T>::
-gamma_compress(Array<const Vector<T,3>,2> image,const real gamma)
+gamma_compress(Array<const Vector<T,3>,2> image,const real gamma,const int threads)
 {
-    T one_over_gamma = T(1/gamma);
-    Array<Vector<T,3>,2> result(image.sizes());
-    for(int t=0;t<result.flat.size();t++)
-      for (int i = 0; i < 3; ++i)
-        result.flat[t][i] = pow(image.flat(t)[i],one_over_gamma);
+    const double one_over_gamma = 1/gamma;
+    if (one_over_gamma==1) // pow4 is only accurate to a few ulps, so keep the identity exact
+      return image.copy();
+    Array<Vector<T,3>,2> result(image.sizes(),uninit);
+    const T* x = image.flat.data()->data();
+    T* y = result.flat.data()->data();
+    // Every value goes through pow4, including the partial group at the end, so values don't depend on the partition
+    const int size = 3*image.flat.size(),
+              groups = size/4;
+    #pragma omp parallel for schedule(static) num_threads(max(threads,1))
+    for(int g=0;g<groups;g++)
+      pow4(x+4*g,y+4*g,one_over_gamma);
+    if (const int n = size-4*groups) {
+      T in[4] = {1,1,1,1}, out[4];
+      for (int k=0;k<n;k++)
+        in[k] = x[4*groups+k];
+      pow4(in,out,one_over_gamma);
+      for (int k=0;k<n;k++)
+        y[4*groups+k] = out[k];
+    }
     return result;
 }
 
 template<class T> Array<Vector<T,3>,2> Image<T>::
-dither(Array<const Vector<T,3>,2> image)
+dither(Array<const Vector<T,3>,2> image,const int threads)
 {
-    Ref<Random> random=new_<Random>(324032); // want uniform seed so noise perturbation pattern is temporally coherent
-
-    Array<Vector<T,3>,2> result(image.sizes());
-    for(int t=0;t<result.flat.size();t++){
-        result.flat(t)=image.flat(t);
-        Vector<T,3> pixel_values((T)255*result.flat(t));
-        Vector<int,3> floored_values((int)pixel_values[0],(int)pixel_values[1],(int)pixel_values[2]);
-        Vector<real,3> random_stuff=random->uniform<Vector<real,3> >(0,1);
-        Vector<T,3> normalized_values=pixel_values-Vector<T,3>(floored_values);
-        for(int k=0;k<3;k++)
-            if(random_stuff[k]>normalized_values[k]) result.flat(t)[k]=(floored_values[k]+(T).5001)/255; // use normal quantized floor
-            else result.flat(t)[k]=(floored_values[k]+(T)1.5001)/255;} // jump to next value
+    // Noise for each pixel comes from threefry of the pixel index under a fixed key, so the perturbation
+    // pattern is temporally coherent and independent of the thread count
+    const uint128_t key = 324032;
+    const int pixels = image.flat.size(),
+              chunk = 1024,
+              chunks = (pixels+chunk-1)/chunk;
+    Array<Vector<T,3>,2> result(image.sizes(),uninit);
+    #pragma omp parallel for schedule(static) num_threads(max(threads,1))
+    for(int c=0;c<chunks;c++){
+        uint128_t noise[chunk];
+        const int start = chunk*c,
+                  n = min(chunk,pixels-start);
+        threefry(key,start,RawArray<uint128_t>(n,noise));
+        for(int j=0;j<n;j++){
+            const int t = start+j;
+            Vector<T,3> pixel_values((T)255*image.flat(t));
+            Vector<int,3> floored_values((int)pixel_values[0],(int)pixel_values[1],(int)pixel_values[2]);
+            Vector<T,3> normalized_values=pixel_values-Vector<T,3>(floored_values);
+            for(int k=0;k<3;k++){
+                const real random_stuff = real(cast_uint128<uint32_t>(noise[j]>>32*k))/4294967296.;
+                if(random_stuff>normalized_values[k]) result.flat(t)[k]=(floored_values[k]+(T).5001)/255; // use normal quantized floor
+                else result.flat(t)[k]=(floored_values[k]+(T)1.5001)/255;}}} // jump to next value
     return result;
 }
 
 template<class T>
-Array<Vector<T,3>,2> Image<T>::median(const vector<Array<const Vector<T,3>,2> >& images) {
+Array<Vector<T,3>,2> Image<T>::median(const vector<Array<const Vector<T,3>,2> >& images,const int threads) {
   GEODE_ASSERT(images.size());
-  int n = (int)images.size();
+  const int n = (int)images.size();
   for (int k=1;k<n;k++)
     GEODE_ASSERT(images[0].sizes()==images[k].sizes());
 
-  Array<T,2> pixel(3,n);
-  Array<Vector<T,3>,2> result(images[0].sizes());
-  for(int t=0; t<result.flat.size(); t++){
-    for (int k=0;k<n;k++)
-      images[k].flat[t].get(pixel(0,k),pixel(1,k),pixel(2,k));
-    for (int a=0;a<3;a++) {
-      RawArray<T> samples = pixel[a];
-      nth_element(&samples[0],&samples[n/2],&samples[n-1]);
-      result.flat[t][a] = samples[n/2];
+  // Work on channels independently, as flat scalar arrays
+  vector<RawArray<const T>> channels;
+  for (const auto& image : images)
+    channels.push_back(scalar_view(image.flat));
+  Array<Vector<T,3>,2> result(images[0].sizes(),uninit);
+  const RawArray<T> flat = scalar_view(result.flat);
+  const int size = flat.size(),
+            block = 64,
+            blocks = (size+block-1)/block;
+
+  if (n<=16) {
+    // Odd-even transposition sort across frames, a block of values at a time, so that each compare-exchange
+    // is a vectorizable min/max over the block
+    #pragma omp parallel for schedule(static) num_threads(max(threads,1))
+    for (int b=0;b<blocks;b++) {
+      T values[16][block];
+      const int start = block*b,
+                m = min(block,size-start);
+      for (int k=0;k<n;k++) {
+        for (int j=0;j<m;j++)
+          values[k][j] = channels[k][start+j];
+        for (int j=m;j<block;j++)
+          values[k][j] = 0;
+      }
+      for (int round=0;round<n;round++)
+        for (int k=round&1;k+1<n;k+=2) {
+          T* lo = values[k];
+          T* hi = values[k+1];
+          for (int j=0;j<block;j++) {
+            const T a = lo[j], c = hi[j];
+            lo[j] = min(a,c);
+            hi[j] = max(a,c);
+          }
+        }
+      for (int j=0;j<m;j++)
+        flat[start+j] = values[n/2][j];
+    }
+  } else {
+    #pragma omp parallel for schedule(static) num_threads(max(threads,1))
+    for (int b=0;b<blocks;b++) {
+      Array<T> samples(n,uninit);
+      for (int i=block*b,e=min(i+block,size);i<e;i++) {
+        for (int k=0;k<n;k++)
+          samples[k] = channels[k][i];
+        nth_element(samples.data(),samples.data()+n/2,samples.data()+n);
+        flat[i] = samples[n/2];
+      }
     }
   }
   return result;
@@ -153,9 +288,12 @@ void wrap_Image()
   Class<Self>("Image")
     .GEODE_METHOD(read)
     .GEODE_METHOD(write)
-    .GEODE_METHOD(gamma_compress)
-    .GEODE_METHOD(dither)
-    .GEODE_METHOD(median)
+    .GEODE_NOGIL_METHOD_2("gamma_compress",gamma_compress_py)
+    .GEODE_NOGIL_METHOD_2("dither",dither_py)
+    .GEODE_NOGIL_METHOD_2("median",median_py)
+    .GEODE_NOGIL_METHOD_2("parallel_gamma_compress",gamma_compress)
+    .GEODE_NOGIL_METHOD_2("parallel_dither",dither)
+    .GEODE_NOGIL_METHOD_2("parallel_median",median)
     .GEODE_METHOD(is_supported)
     ;
 }
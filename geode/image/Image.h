@@ -71,10 +71,20 @@ public:
     GEODE_CORE_EXPORT static void write_alpha(const string& filename,RawArray<const Vector<T,4>,2> image);
     GEODE_CORE_EXPORT static std::vector<unsigned char> write_png_to_memory(RawArray<const Vector<T,3>,2> image);
     GEODE_CORE_EXPORT static std::vector<unsigned char> write_png_to_memory(RawArray<const Vector<T,4>,2> image);
-    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> gamma_compress(Array<const Vector<T,3>,2> image,const real gamma);
-    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> dither(Array<const Vector<T,3>,2> image);
+    // The following are parallel over pixels, and give the same results for any number of threads.
+    // gamma_compress evaluates pow on SIMD lanes where available, dither draws counter based noise per pixel,
+    // and median uses a sorting network across frames when there are at most 16.
+    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> gamma_compress(Array<const Vector<T,3>,2> image,const real gamma,const int threads=1);
+    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> dither(Array<const Vector<T,3>,2> image,const int threads=1);
     GEODE_CORE_EXPORT static bool is_supported(const string& filename);
-    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> median(const vector<Array<const Vector<T,3>,2> >& images);
+    GEODE_CORE_EXPORT static Array<Vector<T,3>,2> median(const vector<Array<const Vector<T,3>,2> >& images,const int threads=1);
+    // Python versions with the original signatures.  The threaded ones are wrapped as parallel_*.
+    static Array<Vector<T,3>,2> gamma_compress_py(Array<const Vector<T,3>,2> image,const real gamma)
+    {return gamma_compress(image,gamma);}
+    static Array<Vector<T,3>,2> dither_py(Array<const Vector<T,3>,2> image)
+    {return dither(image);}
+    static Array<Vector<T,3>,2> median_py(const vector<Array<const Vector<T,3>,2> >& images)
+    {return median(images);}
     //#####################################################################
 };
 }
@@ -21,10 +21,14 @@ extern "C"{
 #include <geode/image/Image.h>
 #include <geode/image/MovFile.h>
 #include <geode/utility/endian.h>
+#include <geode/utility/time.h>
 #include <string>
 #include <iostream>
 #include <cassert>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <stdlib.h>
 #include <stdio.h>
 namespace geode {
@@ -73,9 +77,181 @@ public:
     {return start_offset;}
 };
 
+#ifdef GEODE_LIBJPEG
+
+// libjpeg destination appending to a std::vector
+struct VectorDest {
+    jpeg_destination_mgr mgr; // must be first
+    std::vector<unsigned char>* out;
+};
+
+static void vector_dest_init(j_compress_ptr cinfo)
+{
+    VectorDest& dest=*(VectorDest*)cinfo->dest;
+    dest.out->resize(1<<16);
+    dest.mgr.next_output_byte=dest.out->data();
+    dest.mgr.free_in_buffer=dest.out->size();
+}
+
+static boolean vector_dest_empty(j_compress_ptr cinfo)
+{
+    // libjpeg calls this only when the buffer is entirely full
+    VectorDest& dest=*(VectorDest*)cinfo->dest;
+    const size_t n=dest.out->size();
+    dest.out->resize(2*n);
+    dest.mgr.next_output_byte=dest.out->data()+n;
+    dest.mgr.free_in_buffer=n;
+    return TRUE;
+}
+
+static void vector_dest_term(j_compress_ptr cinfo)
+{
+    VectorDest& dest=*(VectorDest*)cinfo->dest;
+    dest.out->resize(dest.out->size()-dest.mgr.free_in_buffer);
+}
+
+// Encode rgb scanlines, top row first, as baseline jpeg
+static void encode_jpeg(std::vector<unsigned char>& jpeg,const std::vector<unsigned char>& scanlines,const int width,const int height)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err=jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    VectorDest dest;
+    dest.mgr.init_destination=vector_dest_init;
+    dest.mgr.empty_output_buffer=vector_dest_empty;
+    dest.mgr.term_destination=vector_dest_term;
+    dest.out=&jpeg;
+    cinfo.dest=&dest.mgr;
+    cinfo.image_width=width;
+    cinfo.image_height=height;
+    cinfo.input_components=3;
+    cinfo.in_color_space=JCS_RGB; // colorspace of input image
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo,95,TRUE); // limit to baseline-Jpeg values
+    jpeg_start_compress(&cinfo,TRUE);
+
+    const int row_stride=width*3; // JSAMPLEs per row in image_buffer
+    while(cinfo.next_scanline < cinfo.image_height){
+        JSAMPROW row_pointer[]={(JSAMPLE*)&scanlines[cinfo.next_scanline*row_stride]};
+        jpeg_write_scanlines(&cinfo,row_pointer,1);}
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+}
+
+// Convert an m by n image, stored column by column, to rgb bytes, top row first.  Read in storage order.
+static void to_scanlines(std::vector<unsigned char>& scanlines,const Vector<real,3>* image,const int m,const int n)
+{
+    scanlines.resize(3*m*n);
+    for(int i=0;i<m;i++){
+        const Vector<real,3>* column=image+i*n;
+        for(int j=0;j<n;j++){
+            unsigned char* pixel=&scanlines[3*((n-j-1)*m+i)];
+            for(int k=0;k<3;k++)
+                pixel[k]=(unsigned char)component_to_byte_color(column[j][k]);}}
+}
+
+#endif
+
+// Bounded ring of frames being encoded by worker threads.  Frame f lives in slot f%capacity from when it is added
+// until it is written, so at most capacity frames are in flight.  Adding a frame only copies it into the slot, whose
+// buffers are reused from frame to frame; workers convert to bytes and compress.  Whichever worker finishes a frame
+// writes all consecutive encoded frames, unless another worker is already doing so, which keeps writes in order.
+struct MovQueue {
+    struct Slot {
+        std::vector<Vector<real,3>> image;
+        std::vector<unsigned char> scanlines;
+        std::vector<unsigned char> jpeg;
+        bool encoded;
+        Slot():encoded(false){}
+    };
+
+    MovWriter& mov;
+    std::vector<Slot> slots;
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable work; // signaled when a frame is added, or on shutdown
+    std::condition_variable space; // signaled when a frame is written
+    int64_t added,taken,written; // frame counts
+    bool writing,stopping;
+    int64_t stalls,max_queued;
+    double stall_time;
+
+    MovQueue(MovWriter& mov,const int threads,const int capacity)
+        :mov(mov),slots(capacity),added(mov.sample_offsets.size()),taken(added),written(added),writing(false),stopping(false),
+        stalls(0),max_queued(0),stall_time(0)
+    {
+        for(int t=0;t<threads;t++)
+            workers.push_back(std::thread(&MovQueue::run,this));
+    }
+
+    ~MovQueue()
+    {
+        {std::lock_guard<std::mutex> lock(mutex);
+            stopping=true;}
+        work.notify_all();
+        for(auto& worker : workers)
+            worker.join();
+    }
+
+    // Only one thread may add frames at a time
+    void add(const Array<Vector<real,3>,2>& image)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const int64_t capacity=slots.size();
+        if(added-written>=capacity){
+            stalls++;
+            const double start=get_time();
+            space.wait(lock,[&]{return added-written<capacity;});
+            stall_time+=get_time()-start;}
+        // Workers leave the free slot alone until added is incremented, so copy without the lock
+        lock.unlock();
+        slots[added%capacity].image.assign(image.flat.begin(),image.flat.end());
+        lock.lock();
+        added++;
+        max_queued=max(max_queued,added-written);
+        work.notify_one();
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock,[&]{return written==added;});
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const int64_t capacity=slots.size();
+        for(;;){
+            work.wait(lock,[&]{return stopping || taken<added;});
+            if(taken==added) return;
+            Slot& slot=slots[taken++%capacity];
+            lock.unlock();
+#ifdef GEODE_LIBJPEG
+            to_scanlines(slot.scanlines,slot.image.data(),mov.width,mov.height);
+            encode_jpeg(slot.jpeg,slot.scanlines,mov.width,mov.height);
+#endif
+            lock.lock();
+            slot.encoded=true;
+            if(writing) continue;
+            writing=true;
+            for(;;){
+                Slot& next=slots[written%capacity];
+                if(written==taken || !next.encoded) break;
+                lock.unlock();
+                mov.write_sample(next.jpeg);
+                lock.lock();
+                next.encoded=false;
+                written++;
+                space.notify_all();}
+            writing=false;}
+    }
+};
+
 MovWriter::
 MovWriter(const std::string& filename,const int frames_per_second)
-    :frames_per_second(frames_per_second),width(0),height(0)
+    :frames_per_second(frames_per_second),width(0),height(0),queue(0)
 {
     GEODE_ASSERT(enabled());
     fp=fopen(filename.c_str(),"wb");
@@ -86,6 +262,7 @@ MovWriter(const std::string& filename,const int frames_per_second)
 MovWriter::
 ~MovWriter()
 {
+    set_async(0,1);
     delete current_mov;
     write_footer();
     fclose(fp);
@@ -101,44 +278,71 @@ add_frame(const Array<Vector<T,3>,2>& image)
     frame++;
 */
 
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
     if(width==0 && height==0){width=image.m;height=image.n;}
     if(width!=image.m || height!=image.n) throw RuntimeError("Frame does not have same size as previous frame(s)");
 
-    cinfo.err=jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
-    long frame_begin=ftell(fp);
-    jpeg_stdio_dest(&cinfo,fp);
-    cinfo.image_width=image.m;
-    cinfo.image_height=image.n;
-    cinfo.input_components=3;
-    cinfo.in_color_space=JCS_RGB; // colorspace of input image
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo,95,TRUE); // limit to baseline-Jpeg values
-    jpeg_start_compress(&cinfo,TRUE);
+    if(queue)
+        queue->add(image);
+    else{
+        std::vector<unsigned char> scanlines,jpeg;
+        to_scanlines(scanlines,image.data(),image.m,image.n);
+        encode_jpeg(jpeg,scanlines,width,height);
+        write_sample(jpeg);}
+#endif
+}
 
-    int row_stride=cinfo.image_width*3; // JSAMPLEs per row in image_buffer
-    JSAMPLE* row=new JSAMPLE[row_stride];
-    JSAMPROW row_pointer[]={row};
-    while(cinfo.next_scanline < cinfo.image_height){
-        int index=0;
-        for(int i=0;i<image.m;i++){ // copy row
-            Vector<unsigned char,3> pixel=Image<T>::to_byte_color(image(i,image.n-cinfo.next_scanline-1));
-            row[index++]=pixel.x;row[index++]=pixel.y;row[index++]=pixel.z;}
-        jpeg_write_scanlines(&cinfo,row_pointer,1);}
-    delete[] row;
-    jpeg_finish_compress(&cinfo);
-    jpeg_destroy_compress(&cinfo);
-    long frame_end=ftell(fp);
-    sample_lengths.append(int(frame_end-frame_begin));
+void MovWriter::
+write_sample(const std::vector<unsigned char>& jpeg)
+{
+    long frame_begin=ftell(fp);
+    fwrite(jpeg.data(),1,jpeg.size(),fp);
+    sample_lengths.append(int(jpeg.size()));
     sample_offsets.append(int(frame_begin-current_mov->offset()));
-#endif
+}
+
+void MovWriter::
+set_async(const int threads,const int capacity)
+{
+    GEODE_ASSERT(threads>=0 && capacity>=1);
+    flush();
+    delete queue;
+    queue=0;
+    if(threads)
+        queue=new MovQueue(*this,threads,max(capacity,threads));
+}
+
+void MovWriter::
+flush()
+{
+    if(queue)
+        queue->flush();
+}
+
+Hashtable<string,double> MovWriter::
+queue_stats() const
+{
+    Hashtable<string,double> stats;
+    if(queue){
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        stats.set("frames",double(queue->added));
+        stats.set("queued",double(queue->added-queue->written));
+        stats.set("max_queued",double(queue->max_queued));
+        stats.set("stalls",double(queue->stalls));
+        stats.set("stall_time",queue->stall_time);
+    }else{
+        stats.set("frames",sample_offsets.size());
+        stats.set("queued",0);
+        stats.set("max_queued",0);
+        stats.set("stalls",0);
+        stats.set("stall_time",0);
+    }
+    return stats;
 }
 
 void MovWriter::
 write_footer()
 {
+    flush();
     const int frames=sample_offsets.size();
     GEODE_ASSERT(sample_offsets.size()==sample_lengths.size());
     QtAtom a(fp,"moov");
@@ -286,8 +490,11 @@ void wrap_mov()
     typedef MovWriter Self;
     Class<Self>("MovWriter")
         .GEODE_INIT(const string&,int)
-        .GEODE_METHOD(add_frame)
+        .GEODE_NOGIL_METHOD(add_frame)
         .GEODE_METHOD(write_footer)
         .GEODE_METHOD(enabled)
+        .GEODE_NOGIL_METHOD(set_async)
+        .GEODE_NOGIL_METHOD(flush)
+        .GEODE_METHOD(queue_stats)
         ;
 }
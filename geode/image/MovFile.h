@@ -4,9 +4,14 @@
 #pragma once
 
 #include <geode/array/Array.h>
+#include <geode/structure/Hashtable.h>
+#include <geode/vector/Vector.h>
+#include <string>
+#include <vector>
 namespace geode {
 
 class QtAtom;
+struct MovQueue;
 
 class MovWriter : public Object {
 public:
@@ -18,6 +23,7 @@ private:
   int width,height;
   FILE* fp;
   QtAtom* current_mov;
+  MovQueue* queue; // Frames in flight if encoding asynchronously, otherwise null
   Array<int> sample_offsets;
   Array<int> sample_lengths;
 
@@ -28,6 +34,23 @@ public:
   GEODE_CORE_EXPORT void add_frame(const Array<Vector<T,3>,2>& image);
   GEODE_CORE_EXPORT void write_footer();
   GEODE_CORE_EXPORT static bool enabled();
+
+  // Encode frames on the given number of background threads, with at most capacity frames queued.  add_frame then
+  // copies the frame into a free queue slot and returns, blocking only if the queue is full; the workers convert
+  // and encode it.  Frames are written in the order added.  threads=0 returns to synchronous encoding.  Queued
+  // frames are flushed first.
+  GEODE_CORE_EXPORT void set_async(const int threads,const int capacity);
+
+  // Wait until all queued frames are written
+  GEODE_CORE_EXPORT void flush();
+
+  // Queue statistics: frames (added so far), queued (currently in flight), max_queued, stalls (add_frame calls that
+  // waited for a free slot), and stall_time (seconds spent waiting)
+  GEODE_CORE_EXPORT Hashtable<std::string,double> queue_stats() const;
+
+private:
+  friend struct MovQueue;
+  void write_sample(const std::vector<unsigned char>& jpeg);
 };
 
 }
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+from __future__ import division
+from numpy import *
+from geode import *
+
+def random_image(m=37,n=29):
+  # 3*m*n is not a multiple of the SIMD width or the block sizes, so partial groups are exercised
+  return random.rand(m,n,3).astype(real)
+
+def test_gamma():
+  random.seed(18231)
+  im = random_image()
+  im.reshape(-1)[:5] = 0,1,1e-310,1e-300,2
+  for gamma in 2.2,1/2.4,3,1:
+    exact = im**(1/gamma)
+    g = Image.gamma_compress(im,gamma)
+    # The SIMD path goes through exp2 and log2, so the relative error is bounded by 3*max(1,|t|) ulps with
+    # t = log2(x)/gamma, as documented next to pow4
+    with errstate(divide='ignore'):
+      t = log2(im)/gamma
+    assert all((g==exact)|(abs(g-exact)<=3*maximum(1,abs(t))*2.**-52*exact))
+    for threads in 1,3:
+      assert all(Image.parallel_gamma_compress(im,gamma,threads)==g)
+  # Gamma 1 is exact
+  assert all(Image.gamma_compress(im,1)==im)
+  assert all(Image.parallel_gamma_compress(im,1,3)==im)
+
+def test_dither():
+  random.seed(18232)
+  im = random_image()
+  d = Image.dither(im)
+  # Each value rounds to one of the two nearest levels
+  f = floor(255*im)
+  assert all((abs(255*d-f-.5001)<1e-6)|(abs(255*d-f-1.5001)<1e-6))
+  for threads in 1,3:
+    assert all(Image.parallel_dither(im,threads)==d)
+
+def test_median():
+  random.seed(18233)
+  for n in xrange(1,21):
+    # Round so that some values tie
+    frames = [around(random_image(),2) for _ in xrange(n)]
+    m = Image.median(frames)
+    # Even counts take the upper median
+    assert all(m==sort(frames,axis=0)[n//2])
+    if n&1:
+      assert all(m==median(frames,axis=0))
+    for threads in 1,3:
+      assert all(Image.parallel_median(frames,threads)==m)
+
+if __name__=='__main__':
+  test_gamma()
+  test_dither()
+  test_median()
@@ -4,11 +4,10 @@ from __future__ import division
 from geode import *
 
 if MovWriter.enabled():
-  def test_mov(filename=None):
-    if not filename:
-      file = named_tmpfile(suffix='.mov')
-      filename = file.name
-    mov = MovWriter(filename,24) 
+  def write_mov(filename,threads=0):
+    mov = MovWriter(filename,24)
+    if threads:
+      mov.set_async(threads,4)
     w,h = 60,50
     y,x = meshgrid(arange(h),arange(w))
     assert x.shape==y.shape==(w,h)
@@ -25,6 +24,24 @@ if MovWriter.enabled():
       a = 4*pi*t/3
       image = c*(x*cos(a)+y*sin(a)+.5).reshape(w,h,1)
       mov.add_frame(image)
+    return mov
+
+  def test_mov(filename=None):
+    if not filename:
+      file = named_tmpfile(suffix='.mov')
+      filename = file.name
+    write_mov(filename)
+
+  def test_async():
+    files = [named_tmpfile(suffix='.mov') for _ in xrange(2)]
+    write_mov(files[0].name)
+    mov = write_mov(files[1].name,threads=3)
+    mov.flush()
+    stats = mov.queue_stats()
+    assert stats['frames']==100 and stats['queued']==0 and 1<=stats['max_queued']<=4
+    del mov
+    data = [open(f.name,'rb').read() for f in files]
+    assert data[0]==data[1]
 
 if __name__=='__main__':
   test_mov('test.mov')
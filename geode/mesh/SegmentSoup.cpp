@@ -2,6 +2,7 @@
 // Class SegmentSoup
 //#####################################################################
 #include <geode/mesh/SegmentSoup.h>
+#include <geode/mesh/incident.h>
 #include <geode/array/Nested.h>
 #include <geode/array/sort.h>
 #include <geode/array/view.h>
@@ -25,8 +26,7 @@ const int SegmentSoup::d;
 SegmentSoup::SegmentSoup(Array<const Vector<int,2>> elements, const int min_nodes)
   : vertices(scalar_view_own(elements))
   , elements(elements)
-  , node_count(max(min_nodes,compute_node_count()))
-  , bending_tuples_valid(false) {}
+  , node_count(max(min_nodes,compute_node_count())) {}
 
 int SegmentSoup::compute_node_count() const {
   // Assert validity and compute counts
@@ -41,8 +41,23 @@ int SegmentSoup::compute_node_count() const {
 
 SegmentSoup::~SegmentSoup() {}
 
+void SegmentSoup::precompute(const int caches, const int threads) const {
+  if (caches & NeighborsCache)
+    build_neighbors(threads);
+  if (caches & IncidentElementsCache)
+    build_incident_elements(threads);
+  if (caches & AdjacentElementsCache)
+    build_adjacent_elements(threads);
+  if (caches & PolygonsCache) {
+    build_incident_elements(threads);
+    polygons();
+  }
+  if (caches & BendingTuplesCache)
+    build_bending_tuples(threads);
+}
+
 const Tuple<Nested<const int>,Nested<const int>>& SegmentSoup::polygons() const {
-  if (nodes() && !polygons_.x.size() && !polygons_.y.size()) {
+  std::call_once(polygons_once,[this]() {
     const auto incident = incident_elements();
     // Start from each segment, compute the contour that contains it and classify as either closed or open
     vector<vector<int>> closed, open;
@@ -85,73 +100,83 @@ const Tuple<Nested<const int>,Nested<const int>>& SegmentSoup::polygons() const
     }
     // Store results
     polygons_ = tuple(Nested<const int>::copy(closed),Nested<const int>::copy(open));
-  }
+  });
   return polygons_;
 }
 
-Nested<const int> SegmentSoup::neighbors() const {
-  if (nodes() && !neighbors_.size()) {
-    Array<int> lengths(nodes());
-    for(int s=0;s<elements.size();s++)
-      for(int a=0;a<2;a++)
-        lengths[elements[s][a]]++;
-    neighbors_ = Nested<int>(lengths);
-    for(int s=0;s<elements.size();s++) {
-      int i,j;elements[s].get(i,j);
-      neighbors_(i,neighbors_.size(i)-lengths[i]--) = j;
-      neighbors_(j,neighbors_.size(j)-lengths[j]--) = i;
-    }
-    // Sort and remove duplicates if necessary
-    bool need_copy = false;
-    for(int i=0;i<nodes();i++) {
-      RawArray<int> n = neighbors_[i];
-      sort(n);
-      int* last = std::unique(n.begin(),n.end());
-      if(last!=n.end())
-        need_copy = true;
-      lengths[i] = int(last-n.begin());
-    }
-    if (need_copy) {
-      Nested<int> copy(lengths);
-      for(int i=0;i<nodes();i++)
-        copy[i] = neighbors_[i].slice(0,lengths[i]);
+void SegmentSoup::build_neighbors(const int threads) const {
+  std::call_once(neighbors_once,[=]() {
+    // Collect the segment ends at each node, and replace each by the other end of its segment
+    const auto ends = incident_lists(vertices,nodes(),threads,[](const int k) { return k; });
+    const int blocks = parallel_blocks(threads);
+    Array<int> lengths(nodes(),uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      for (const int i : partition_loop(nodes(),blocks,c)) {
+        const auto n = ends[i];
+        for (auto& k : n)
+          k = vertices[k^1];
+        // Sort and remove duplicates if necessary
+        sort(n);
+        lengths[i] = int(std::unique(n.begin(),n.end())-n.begin());
+      }
+    });
+    const auto offsets = parallel_offsets(lengths,threads);
+    if (offsets.back()==ends.total_size())
+      neighbors_ = ends;
+    else {
+      const Nested<int> copy(offsets,Array<int>(offsets.back(),uninit));
+      parallel_for(blocks,threads,[&](const int c) {
+        for (const int i : partition_loop(nodes(),blocks,c))
+          copy[i] = ends[i].slice(0,lengths[i]);
+      });
       neighbors_ = copy;
     }
-  }
+  });
+}
+
+Nested<const int> SegmentSoup::neighbors() const {
+  build_neighbors(1);
   return neighbors_;
 }
 
+void SegmentSoup::build_incident_elements(const int threads) const {
+  std::call_once(incident_elements_once,[=]() {
+    incident_elements_ = incident_lists(vertices,nodes(),threads,[](const int k) { return k/2; });
+  });
+}
+
 Nested<const int> SegmentSoup::incident_elements() const {
-  if (nodes() && !incident_elements_.size()) {
-    Array<int> lengths(nodes());
-    for (int i=0;i<vertices.size();i++)
-      lengths[vertices[i]]++;
-    incident_elements_=Nested<int>(lengths);
-    for (int s=0;s<elements.size();s++) for(int i=0;i<2;i++) {
-      int p=elements[s][i];
-      incident_elements_(p,incident_elements_.size(p)-lengths[p]--)=s;
-    }
-  }
+  build_incident_elements(1);
   return incident_elements_;
 }
 
-Array<const Vector<int,2>> SegmentSoup::adjacent_elements() const {
-  if (!adjacent_elements_.size() && nodes()) {
-    adjacent_elements_.resize(elements.size(),uninit);
-    Nested<const int> incident = incident_elements();
-    for (int s=0;s<elements.size();s++) {
-      Vector<int,2> seg = elements[s];
-      for (int i=0;i<2;i++) {
-        for (int s2 : incident[seg[i]])
-          if (elements[s2][i]!=seg[i]) {
-            adjacent_elements_[s][i] = s2;
-            goto found;
-          }
-        adjacent_elements_[s][i] = -1;
-        found:;
+void SegmentSoup::build_adjacent_elements(const int threads) const {
+  build_incident_elements(threads);
+  std::call_once(adjacent_elements_once,[=]() {
+    const auto incident = incident_elements_;
+    const int n = elements.size(),
+              blocks = parallel_blocks(threads);
+    Array<Vector<int,2>> adjacent(n,uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      for (const int s : partition_loop(n,blocks,c)) {
+        Vector<int,2> seg = elements[s];
+        for (int i=0;i<2;i++) {
+          for (int s2 : incident[seg[i]])
+            if (elements[s2][i]!=seg[i]) {
+              adjacent[s][i] = s2;
+              goto found;
+            }
+          adjacent[s][i] = -1;
+          found:;
+        }
       }
-    }
-  }
+    });
+    adjacent_elements_ = adjacent;
+  });
+}
+
+Array<const Vector<int,2>> SegmentSoup::adjacent_elements() const {
+  build_adjacent_elements(1);
   return adjacent_elements_;
 }
 
@@ -178,17 +203,32 @@ Array<int> SegmentSoup::nonmanifold_nodes(bool allow_boundary) const {
   return nonmanifold;
 }
 
-Array<const Vector<int,3>> SegmentSoup::bending_tuples() const {
-  if (!bending_tuples_valid) {
-    Nested<const int> neighbors = this->neighbors();
-    Array<Vector<int,3>> tuples;
+void SegmentSoup::build_bending_tuples(const int threads) const {
+  build_neighbors(threads);
+  std::call_once(bending_tuples_once,[=]() {
+    const auto neighbors = neighbors_;
+    const int blocks = parallel_blocks(threads);
+    Array<int> counts(nodes(),uninit);
     for (const int p : range(nodes())) {
-      RawArray<const int> near = neighbors[p];
-      for (int i=0;i<near.size();i++) for(int j=i+1;j<near.size();j++)
-        tuples.append(vec(near[i],p,near[j]));
+      const int k = neighbors.size(p);
+      counts[p] = k*(k-1)/2;
     }
+    const auto offsets = parallel_offsets(counts,threads);
+    Array<Vector<int,3>> tuples(offsets.back(),uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      for (const int p : partition_loop(nodes(),blocks,c)) {
+        RawArray<const int> near = neighbors[p];
+        int next = offsets[p];
+        for (int i=0;i<near.size();i++) for(int j=i+1;j<near.size();j++)
+          tuples[next++] = vec(near[i],p,near[j]);
+      }
+    });
     bending_tuples_ = tuples;
-  }
+  });
+}
+
+Array<const Vector<int,3>> SegmentSoup::bending_tuples() const {
+  build_bending_tuples(1);
   return bending_tuples_;
 }
 
@@ -211,5 +251,6 @@ void wrap_segment_soup() {
     .GEODE_METHOD(nonmanifold_nodes)
     .GEODE_METHOD(polygons)
     .GEODE_METHOD(bending_tuples)
+    .GEODE_METHOD(precompute)
     ;
 }
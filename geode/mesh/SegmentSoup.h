@@ -6,6 +6,9 @@
 // of immutability is that we don't have to worry about acceleration structures
 // becoming invalid, and we can check validity once at construction time.
 //
+// As with TriangleSoup, derived topology is computed lazily at most once, so a SegmentSoup can be queried
+// from several threads at once.  Use precompute to compute caches up front with several threads.
+//
 //#####################################################################
 #pragma once
 
@@ -16,6 +19,7 @@
 #include <geode/python/Ref.h>
 #include <geode/vector/Vector.h>
 #include <geode/structure/Tuple.h>
+#include <mutex>
 namespace geode {
 
 class SegmentSoup : public Object {
@@ -29,18 +33,33 @@ public:
   Array<const Vector<int,2>> elements;
 private:
   const int node_count;
+  mutable std::once_flag neighbors_once, incident_elements_once, adjacent_elements_once, polygons_once,
+                         bending_tuples_once;
   mutable Nested<int> neighbors_;
   mutable Nested<int> incident_elements_;
   mutable Array<Vector<int,2>> adjacent_elements_;
   mutable Tuple<Nested<const int>,Nested<const int>> polygons_;
-  mutable bool bending_tuples_valid;
   mutable Array<Vector<int,3>> bending_tuples_;
 
 protected:
   GEODE_CORE_EXPORT explicit SegmentSoup(Array<const Vector<int,2>> elements, const int min_nodes=0);
 
   int compute_node_count() const;
+  void build_neighbors(const int threads) const;
+  void build_incident_elements(const int threads) const;
+  void build_adjacent_elements(const int threads) const;
+  void build_bending_tuples(const int threads) const;
 public:
+  // Caches for precompute, which can be or'ed together
+  enum Cache {
+    NeighborsCache        = 1<<0,
+    IncidentElementsCache = 1<<1,
+    AdjacentElementsCache = 1<<2,
+    PolygonsCache         = 1<<3,
+    BendingTuplesCache    = 1<<4,
+    AllCaches             = -1
+  };
+
   ~SegmentSoup();
 
   int nodes() const
@@ -50,6 +69,9 @@ public:
     return ref(*this);
   }
 
+  // Compute the given caches now using the given number of threads.  The results are the same as lazy computation.
+  GEODE_CORE_EXPORT void precompute(const int caches, const int threads=1) const;
+
   // Decompose segment mesh into maximal manifold contours, returning closed-contours, open-contours.
   // Nonmanifold vertices will show up several times in different open contours.
   GEODE_CORE_EXPORT const Tuple<Nested<const int>,Nested<const int>>& polygons() const;
@@ -3,6 +3,7 @@
 //#####################################################################
 #include <geode/mesh/TriangleSoup.h>
 #include <geode/mesh/SegmentSoup.h>
+#include <geode/mesh/incident.h>
 #include <geode/array/sort.h>
 #include <geode/array/view.h>
 #include <geode/structure/Hashtable.h>
@@ -22,8 +23,7 @@ const int TriangleSoup::d;
 
 TriangleSoup::TriangleSoup(Array<const Vector<int,3>> elements, const int min_nodes)
   : vertices(scalar_view_own(elements))
-  , elements(elements)
-  , bending_tuples_valid(false) {
+  , elements(elements) {
   // Assert validity and compute counts
   node_count = max(0,min_nodes);
   for (int i=0;i<vertices.size();i++) {
@@ -35,78 +35,140 @@ TriangleSoup::TriangleSoup(Array<const Vector<int,3>> elements, const int min_no
 
 TriangleSoup::~TriangleSoup() {}
 
-Ref<const SegmentSoup> TriangleSoup::segment_soup() const {
-  if (!segment_soup_) {
-    Hashtable<Vector<int,2>> hash;
-    Array<Vector<int,2>> edges;
-    for (const auto t : elements) {
-      const auto e0 = vec(t.x,t.y).sorted(),
-                 e1 = vec(t.y,t.z).sorted(),
-                 e2 = vec(t.z,t.x).sorted();
-      if (hash.set(e0)) edges.append(e0);
-      if (hash.set(e1)) edges.append(e1);
-      if (hash.set(e2)) edges.append(e2);
-    }
-    segment_soup_ = new_<SegmentSoup>(edges,nodes());
+void TriangleSoup::precompute(const int caches, const int threads) const {
+  if (caches & EdgesCache)
+    build_edges(threads);
+  if (caches & IncidentElementsCache)
+    build_incident_elements(threads);
+  if (caches & AdjacentElementsCache)
+    build_adjacent_elements(threads);
+  if (caches & BoundaryMeshCache) {
+    build_edges(threads);
+    boundary_mesh();
   }
+  if (caches & BendingTuplesCache)
+    build_bending_tuples(threads);
+  if (caches & NodesTouchedCache)
+    nodes_touched();
+  if (caches & SortedNeighborsCache)
+    build_sorted_neighbors(threads);
+}
+
+void TriangleSoup::build_edges(const int threads) const {
+  build_incident_elements(threads);
+  std::call_once(edges_once,[=]() {
+    // Number edges in order of their first triangle side, as if sides were inserted into a hashtable one at a
+    // time.  Each side finds the first side with the same edge by scanning the incident elements of an endpoint,
+    // so all sides are independent.
+    const auto incident = incident_elements_;
+    const int n = elements.size(),
+              blocks = parallel_blocks(threads);
+    Array<int> first(3*n,uninit);
+    Array<int> starts(blocks+1);
+    parallel_for(blocks,threads,[&](const int c) {
+      int count = 0;
+      for (const int t : partition_loop(n,blocks,c)) {
+        const auto tri = elements[t];
+        for (int i=0;i<3;i++) {
+          const auto e = vec(tri[i],tri[(i+1)%3]).sorted();
+          for (const int s : incident[incident.size(e.x)<=incident.size(e.y) ? e.x : e.y]) {
+            const auto other = elements[s];
+            for (int j=0;j<3;j++)
+              if (vec(other[j],other[(j+1)%3]).sorted()==e) {
+                first[3*t+i] = 3*s+j;
+                goto found;
+              }
+          }
+          found:
+          count += first[3*t+i]==3*t+i;
+        }
+      }
+      starts[c+1] = count;
+    });
+    for (int c=0;c<blocks;c++)
+      starts[c+1] += starts[c];
+
+    // Number first sides, then copy their numbers to the remaining sides
+    Array<Vector<int,2>> edges(starts[blocks],uninit);
+    Array<Vector<int,3>> triangle_edges(n,uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      int next = starts[c];
+      for (const int t : partition_loop(n,blocks,c))
+        for (int i=0;i<3;i++)
+          if (first[3*t+i]==3*t+i) {
+            edges[next] = vec(elements[t][i],elements[t][(i+1)%3]).sorted();
+            triangle_edges[t][i] = next++;
+          }
+    });
+    parallel_for(blocks,threads,[&](const int c) {
+      for (const int t : partition_loop(n,blocks,c))
+        for (int i=0;i<3;i++) {
+          const int f = first[3*t+i];
+          if (f!=3*t+i)
+            triangle_edges[t][i] = triangle_edges[f/3][f%3];
+        }
+    });
+    triangle_edges_ = triangle_edges;
+    segment_soup_ = new_<SegmentSoup>(edges,nodes());
+  });
+}
+
+Ref<const SegmentSoup> TriangleSoup::segment_soup() const {
+  build_edges(1);
   return ref(segment_soup_);
 }
 
 Array<const Vector<int,3>> TriangleSoup::triangle_edges() const {
-  if (!triangle_edges_.size() && nodes()) {
-    // Must match the algorithm of segment_soup() exactly
-    Hashtable<Vector<int,2>,int> hash;
-    triangle_edges_.resize(elements.size(),uninit);
-    for (int i=0;i<elements.size();i++) {
-      const auto t = elements[i];
-      const int e0 = hash.get_or_insert(vec(t.x,t.y).sorted(),hash.size()),
-                e1 = hash.get_or_insert(vec(t.y,t.z).sorted(),hash.size()),
-                e2 = hash.get_or_insert(vec(t.z,t.x).sorted(),hash.size());
-      triangle_edges_[i] = vec(e0,e1,e2);
-    }
-  }
+  build_edges(1);
   return triangle_edges_;
 }
 
+void TriangleSoup::build_incident_elements(const int threads) const {
+  std::call_once(incident_elements_once,[=]() {
+    incident_elements_ = incident_lists(vertices,nodes(),threads,[](const int k) { return k/3; });
+  });
+}
+
 Nested<const int> TriangleSoup::incident_elements() const {
-  if (!incident_elements_.size() && nodes()) {
-    Array<int> lengths(nodes());
-    for (int i=0;i<vertices.size();i++)
-      lengths[vertices[i]]++;
-    incident_elements_ = Nested<int>(lengths);
-    for (int t=0;t<elements.size();t++) for(int i=0;i<3;i++) {
-      int p = elements[t][i];
-      incident_elements_(p,incident_elements_.size(p)-lengths[p]--)=t;
-    }
-  }
+  build_incident_elements(1);
   return incident_elements_;
 }
 
-Array<const Vector<int,3>> TriangleSoup::adjacent_elements() const {
-  if (!adjacent_elements_.size() && nodes()) {
-    adjacent_elements_.resize(elements.size(),uninit);
-    Nested<const int> incident = incident_elements();
-    for (int t=0;t<elements.size();t++) {
-      Vector<int,3> tri = elements[t];
-      for (int j=0,i=2;j<3;i=j++) {
-        for (int t2 : incident[tri[i]])
-          if (t!=t2) {
-            int a = elements[t2].find(tri[i]);
-            if (elements[t2][(a+2)%3]==tri[j])  {
-              adjacent_elements_[t][i] = t2;
-              goto found;
+void TriangleSoup::build_adjacent_elements(const int threads) const {
+  build_incident_elements(threads);
+  std::call_once(adjacent_elements_once,[=]() {
+    const auto incident = incident_elements_;
+    const int n = elements.size(),
+              blocks = parallel_blocks(threads);
+    Array<Vector<int,3>> adjacent(n,uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      for (const int t : partition_loop(n,blocks,c)) {
+        const auto tri = elements[t];
+        for (int j=0,i=2;j<3;i=j++) {
+          for (const int t2 : incident[tri[i]])
+            if (t!=t2) {
+              const int a = elements[t2].find(tri[i]);
+              if (elements[t2][(a+2)%3]==tri[j]) {
+                adjacent[t][i] = t2;
+                goto found;
+              }
             }
-          }
-        adjacent_elements_[t][i] = -1;
-        found:;
+          adjacent[t][i] = -1;
+          found:;
+        }
       }
-    }
-  }
+    });
+    adjacent_elements_ = adjacent;
+  });
+}
+
+Array<const Vector<int,3>> TriangleSoup::adjacent_elements() const {
+  build_adjacent_elements(1);
   return adjacent_elements_;
 }
 
 Ref<SegmentSoup> TriangleSoup::boundary_mesh() const {
-  if (!boundary_mesh_) {
+  std::call_once(boundary_mesh_once,[this]() {
     Hashtable<Vector<int,2>,int> hash;
     for (int t=0;t<elements.size();t++)
       for (int i=0;i<3;i++) {
@@ -125,91 +187,127 @@ Ref<SegmentSoup> TriangleSoup::boundary_mesh() const {
         segments.append(vec(j,i));
     }
     boundary_mesh_ = new_<SegmentSoup>(segments);
-  }
+  });
   return ref(boundary_mesh_);
 }
 
-Array<const Vector<int,4>> TriangleSoup::bending_tuples() const {
-  if (!bending_tuples_valid) {
-    Hashtable<Vector<int,2>,Array<int>> edge_to_face;
-    for (int t=0;t<elements.size();t++) {
-      Vector<int,3> nodes = elements[t];
-      for (int a=0;a<3;a++)
-        edge_to_face.get_or_insert(vec(nodes[a],nodes[(a+1)%3]).sorted()).append(t);
+void TriangleSoup::build_bending_tuples(const int threads) const {
+  build_edges(threads);
+  std::call_once(bending_tuples_once,[=]() {
+    // Collect the triangles around each edge, then emit each pair of them in edge order
+    const auto edges = segment_soup_->elements;
+    const auto faces = incident_lists(scalar_view(triangle_edges_),edges.size(),threads,
+                                      [](const int k) { return k/3; });
+    const int blocks = parallel_blocks(threads);
+    Array<int> counts(edges.size(),uninit);
+    for (int e=0;e<edges.size();e++) {
+      const int k = faces.size(e);
+      counts[e] = k*(k-1)/2;
     }
-    Array<int> other;
-    Array<bool> flipped;
-    for (const auto& it : edge_to_face) {
-      Vector<int,2> sn = it.x;
-      RawArray<const int> tris(it.y);
-      other.clear();
-      other.resize(tris.size(),uninit);
-      flipped.clear();
-      flipped.resize(tris.size(),uninit);
-      for (int a=0;a<tris.size();a++) {
-        Vector<int,3> tn = elements[tris[a]];
-        int b = !sn.contains(tn[0])?0:!sn.contains(tn[1])?1:2;
-        other[a] = tn[b];
-        flipped[a] = tn[(b+1)%3]!=sn[0];
-        assert(tn[(b+1)%3]==sn[flipped[a]] && tn[(b+2)%3]==sn[1-flipped[a]]);}
-      for (int a=0;a<tris.size();a++) for (int b=a+1;b<tris.size();b++)
-        bending_tuples_.append(vec(other[a],sn[flipped[a]],sn[1-flipped[a]],other[b]));
-    }
-    bending_tuples_valid = true;
-  }
+    const auto offsets = parallel_offsets(counts,threads);
+    Array<Vector<int,4>> tuples(offsets.back(),uninit);
+    parallel_for(blocks,threads,[&](const int c) {
+      Array<int> other;
+      Array<bool> flipped;
+      for (const int e : partition_loop(edges.size(),blocks,c)) {
+        const auto sn = edges[e];
+        const auto tris = faces[e];
+        other.clear();
+        other.resize(tris.size(),uninit);
+        flipped.clear();
+        flipped.resize(tris.size(),uninit);
+        for (int a=0;a<tris.size();a++) {
+          Vector<int,3> tn = elements[tris[a]];
+          int b = !sn.contains(tn[0])?0:!sn.contains(tn[1])?1:2;
+          other[a] = tn[b];
+          flipped[a] = tn[(b+1)%3]!=sn[0];
+          assert(tn[(b+1)%3]==sn[flipped[a]] && tn[(b+2)%3]==sn[1-flipped[a]]);}
+        int next = offsets[e];
+        for (int a=0;a<tris.size();a++) for (int b=a+1;b<tris.size();b++)
+          tuples[next++] = vec(other[a],sn[flipped[a]],sn[1-flipped[a]],other[b]);
+      }
+    });
+    bending_tuples_ = tuples;
+  });
+}
+
+Array<const Vector<int,4>> TriangleSoup::bending_tuples() const {
+  build_bending_tuples(1);
   return bending_tuples_;
 }
 
 Array<const int> TriangleSoup::nodes_touched() const {
-  if (!nodes_touched_.size() && elements.size()) {
-    Hashtable<int> hash;
-    for (int t=0;t<elements.size();t++) for (int i=0;i<3;i++)
-      if (hash.set(elements[t][i]))
-        nodes_touched_.append(elements[t][i]);
-    sort(nodes_touched_);
-  }
+  std::call_once(nodes_touched_once,[this]() {
+    Array<bool> touched(nodes());
+    for (const int v : vertices)
+      touched[v] = true;
+    for (int i=0;i<nodes();i++)
+      if (touched[i])
+        nodes_touched_.append(i);
+  });
   return nodes_touched_;
 }
 
-Nested<const int> TriangleSoup::sorted_neighbors() const {
-  if (!sorted_neighbors_.size() && elements.size()) {
-    Hashtable<Vector<int,2>,int> next; // next[(i,j)] = k if (i,j,k) is a triangle
-    Hashtable<Vector<int,2>,int> prev; // prev[(i,k)] = j if (i,j,k) is a triangle
-    for (const Vector<int,3>& tri : elements) {
-      next.set(vec(tri[0],tri[1]),tri[2]);
-      next.set(vec(tri[1],tri[2]),tri[0]);
-      next.set(vec(tri[2],tri[0]),tri[1]);
-      prev.set(vec(tri[0],tri[2]),tri[1]);
-      prev.set(vec(tri[1],tri[0]),tri[2]);
-      prev.set(vec(tri[2],tri[1]),tri[0]);
-    }
-    Nested<const int> neighbors = segment_soup()->neighbors();
-    Nested<int> sorted_neighbors = Nested<int>::empty_like(neighbors);
-    Hashtable<Vector<int,2>> done;
-    for (int i=0;i<node_count;i++) {
-      if (!neighbors.size(i))
-        continue;
-      // Find a node with no predecessor if one exists
-      int j = neighbors(i,0);
-      for (int a=1;a<neighbors.size(i);a++) {
-        if (int* p = prev.get_pointer(vec(i,j)))
-          j = *p;
-        else
-          break;
-      }
-      // Walk around boundary.  Note that we assume the mesh is manifold (possibly with boundary)
-      sorted_neighbors(i,0) = j;
-      try {
-        for (int a=1;a<neighbors.size(i);a++) {
-          j = next.get(vec(i,j));
+void TriangleSoup::build_sorted_neighbors(const int threads) const {
+  if (!elements.size())
+    return;
+  build_edges(threads);
+  build_incident_elements(threads);
+  segment_soup_->precompute(SegmentSoup::NeighborsCache,threads);
+  std::call_once(sorted_neighbors_once,[=]() {
+    const auto incident = incident_elements_;
+    const auto neighbors = segment_soup_->neighbors();
+    const auto sorted_neighbors = Nested<int>::empty_like(neighbors);
+    const int blocks = parallel_blocks(threads);
+    parallel_for(blocks,threads,[&](const int c) {
+      // For neighbor j = near[a] of node i, next[a] = k if (i,j,k) is a triangle, and prev[a] = k if (i,k,j) is a
+      // triangle, or -1 if there is no such triangle.  Later triangles win, as if inserted into a hashtable in order.
+      Array<int> next, prev;
+      for (const int i : partition_loop(node_count,blocks,c)) {
+        const auto near = neighbors[i];
+        if (!near.size())
+          continue;
+        const auto slot = [=](const int j) { return int(std::lower_bound(near.begin(),near.end(),j)-near.begin()); };
+        next.clear();
+        next.resize(near.size(),uninit);
+        next.fill(-1);
+        prev.clear();
+        prev.resize(near.size(),uninit);
+        prev.fill(-1);
+        for (const int t : incident[i]) {
+          const auto tri = elements[t];
+          for (int r=0;r<3;r++)
+            if (tri[r]==i) {
+              const int j = tri[(r+1)%3],
+                        k = tri[(r+2)%3];
+              next[slot(j)] = k;
+              prev[slot(k)] = j;
+            }
+        }
+        // Find a node with no predecessor if one exists
+        int j = near[0];
+        for (int a=1;a<near.size();a++) {
+          const int p = prev[slot(j)];
+          if (p<0)
+            break;
+          j = p;
+        }
+        // Walk around boundary.  Note that we assume the mesh is manifold (possibly with boundary)
+        sorted_neighbors(i,0) = j;
+        for (int a=1;a<near.size();a++) {
+          j = next[slot(j)];
+          if (j<0)
+            throw RuntimeError(format("TriangleSoup::sorted_neighbors failed: node %d",i));
           sorted_neighbors(i,a) = j;
         }
-      } catch (const KeyError&) {
-        throw RuntimeError(format("TriangleSoup::sorted_neighbors failed: node %d",i));
       }
-    }
+    });
     sorted_neighbors_ = sorted_neighbors;
-  }
+  });
+}
+
+Nested<const int> TriangleSoup::sorted_neighbors() const {
+  build_sorted_neighbors(1);
   return sorted_neighbors_;
 }
 
@@ -380,5 +478,6 @@ void wrap_triangle_mesh() {
     .GEODE_METHOD(nodes)
     .GEODE_METHOD(nonmanifold_nodes)
     .GEODE_METHOD(sorted_neighbors)
+    .GEODE_METHOD(precompute)
     ;
 }
@@ -6,6 +6,10 @@
 // of immutability is that we don't have to worry about acceleration structures
 // becoming invalid, and we can check validity once at construction time.
 //
+// Derived topology (incident elements, edges, etc.) is computed lazily on first use, at most once, so
+// a TriangleSoup can be queried from several threads at once.  Lazy computation is serial; use precompute
+// to compute caches up front with several threads.
+//
 //#####################################################################
 #pragma once
 
@@ -16,6 +20,7 @@
 #include <geode/python/Ptr.h>
 #include <geode/python/Ref.h>
 #include <geode/vector/Vector.h>
+#include <mutex>
 namespace geode {
 
 class TriangleSoup : public Object {
@@ -31,8 +36,9 @@ public:
   Array<const Vector<int,3>> elements;
 private:
   int node_count;
+  mutable std::once_flag edges_once, incident_elements_once, adjacent_elements_once, boundary_mesh_once,
+                         bending_tuples_once, nodes_touched_once, sorted_neighbors_once;
   mutable Ptr<SegmentSoup> segment_soup_;
-  mutable bool bending_tuples_valid;
   mutable Array<Vector<int,4>> bending_tuples_; // i,j,k,l means triangles (i,j,k),(k,j,l)
   mutable Nested<int> incident_elements_;
   mutable Array<Vector<int,3>> triangle_edges_;
@@ -43,7 +49,25 @@ private:
 
 protected:
   GEODE_CORE_EXPORT explicit TriangleSoup(Array<const Vector<int,3>> elements, const int min_nodes=0);
+
+  void build_edges(const int threads) const;
+  void build_incident_elements(const int threads) const;
+  void build_adjacent_elements(const int threads) const;
+  void build_bending_tuples(const int threads) const;
+  void build_sorted_neighbors(const int threads) const;
 public:
+  // Caches for precompute, which can be or'ed together
+  enum Cache {
+    EdgesCache            = 1<<0, // segment_soup and triangle_edges
+    IncidentElementsCache = 1<<1,
+    AdjacentElementsCache = 1<<2,
+    BoundaryMeshCache     = 1<<3,
+    BendingTuplesCache    = 1<<4,
+    NodesTouchedCache     = 1<<5,
+    SortedNeighborsCache  = 1<<6,
+    AllCaches             = -1
+  };
+
   ~TriangleSoup();
 
   int nodes() const {
@@ -55,6 +79,9 @@ public:
     return ref(*this);
   }
 
+  // Compute the given caches now using the given number of threads.  The results are the same as lazy computation.
+  GEODE_CORE_EXPORT void precompute(const int caches, const int threads=1) const;
+
   GEODE_CORE_EXPORT Ref<const SegmentSoup> segment_soup() const;
   GEODE_CORE_EXPORT Array<const Vector<int,3>> triangle_edges() const; // triangles to edges
   GEODE_CORE_EXPORT Nested<const int> incident_elements() const; // vertices to triangles
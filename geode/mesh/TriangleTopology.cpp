@@ -1869,6 +1869,22 @@ Array<int> MutableTriangleTopology::collect_boundary_garbage() {
   return p;
 }
 
+void MutableTriangleTopology::clear() {
+  mutable_n_vertices_ = 0;
+  mutable_n_faces_ = 0;
+  mutable_n_boundary_edges_ = 0;
+  mutable_vertex_to_edge_.flat.clear();
+  mutable_faces_.flat.clear();
+  mutable_boundaries_.clear();
+  mutable_erased_boundaries_ = HalfedgeId();
+  for (auto& s : vertex_fields)
+    s.resize(0);
+  for (auto& s : face_fields)
+    s.resize(0);
+  for (auto& s : halfedge_fields)
+    s.resize(0);
+}
+
 bool TriangleTopology::is_garbage_collected() const {
   return n_vertices_ == vertex_to_edge_.size() &&
          n_faces_ == faces_.size() &&
@@ -633,6 +633,10 @@ public:
   // The complexity is linear in the size of the boundary (including garbage).
   GEODE_CORE_EXPORT Array<int> collect_boundary_garbage();
 
+  // Erase everything, keeping allocated storage (including that of fields) so that refilling the mesh does not
+  // allocate.  Fields remain attached, with size zero.
+  GEODE_CORE_EXPORT void clear();
+
   // The remaining functions are mainly for internal use, or for external routines that perform direct surgery
   // on the internal structure.  Use with caution!
 
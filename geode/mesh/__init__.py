@@ -19,6 +19,15 @@ def TriangleTopology(soup=TriangleSoup(empty((0,3),int32))):
     soup = TriangleSoup(soup)
   return geode_wrap.TriangleTopology(soup)
 
+def read_soup(filename,threads=1):
+  return read_soup_py(filename,threads)
+
+def read_polygon_soup(filename,threads=1):
+  return read_polygon_soup_py(filename,threads)
+
+def read_mesh(filename,threads=1):
+  return read_mesh_py(filename,threads)
+
 def linear_subdivide(mesh,X,steps=1):
   for _ in xrange(steps):
     subdivide = TriangleSubdivision(mesh)
@@ -181,8 +190,11 @@ def mesh_lower_hull(mesh, up, offset, draft_angle = 0., division_angle = 30./180
 def mesh_offset(mesh, offset):
   return meshify(*rough_offset_mesh(mesh, mesh.vertex_field(vertex_position_id), offset))
 
-def decimate(mesh,X,distance,max_angle=pi/2,min_vertices=-1,boundary_distance=0):
-  return geode_wrap.decimate(mesh,X,distance,max_angle,min_vertices,boundary_distance)
+def decimate(mesh,X,distance,max_angle=pi/2,min_vertices=-1,boundary_distance=0,threads=1):
+  return geode_wrap.decimate(mesh,X,distance,max_angle,min_vertices,boundary_distance,threads)
+
+def streaming_decimate(filename,distance,max_angle=pi/2,boundary_distance=0,memory_limit=2**30,threads=1):
+  return geode_wrap.streaming_decimate(filename,distance,max_angle,boundary_distance,memory_limit,threads)
 
 def simplify(mesh,X,distance,max_angle=pi/2,min_vertices=-1,boundary_distance=0):
   return geode_wrap.simplify(mesh,X,distance,max_angle,min_vertices,boundary_distance)
@@ -6,6 +6,8 @@
 #include <geode/mesh/quadric.h>
 #include <geode/python/wrap.h>
 #include <geode/structure/Heap.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
 
 namespace geode {
 
@@ -176,8 +178,107 @@ static CollapseRank collapse_rank(const MutableTriangleTopology& mesh, const Hal
   return CollapseRank::not_allowed;
 }
 
+// Parallel decimation in rounds.  Each round reevaluates the dirty vertices in parallel, sorts the cheapest
+// quarter of the candidate collapses as the heap would, and greedily accepts collapses that can't affect each
+// other: collapsing vs into vd only changes faces incident to vs, and the evaluation of a collapse only reads
+// faces incident to its two endpoints, so it suffices that the src of every accepted collapse lies outside the
+// closed one-rings of the endpoints of every other.  The accepted collapses therefore remain valid with the
+// same cost, and every collapse satisfies the same distance, angle and boundary constraints as in the serial
+// version.  The result depends only on the mesh, and is the same for any threads > 1 (threads <= 1 runs the serial
+// heap instead, which collapses in a different order).
+template<class BestCollapse> static void batched_decimate(MutableTriangleTopology& mesh, const int min_vertices,
+                                                          const int threads, const BestCollapse& best_collapse) {
+  const int nv = mesh.allocated_vertices();
+  Field<Tuple<CollapsePriority,VertexId>,VertexId> best(nv,uninit); // Valid for candidates and dirty vertices
+  Field<int,VertexId> region(nv), source(nv), seen(nv); // Marks for the current round
+  Field<bool,VertexId> listed(nv); // Is the vertex in candidates?
+  Array<VertexId> dirty, candidates, accepted;
+  for (const auto v : mesh.vertices())
+    dirty.append(v);
+
+  const auto order = [&best](const VertexId a, const VertexId b) {
+    return best[a].x < best[b].x || (best[a].x == best[b].x && a < b);
+  };
+
+  for (int round=1;;round++) {
+    // Evaluate dirty vertices in parallel
+    const int blocks = min(4*threads,(dirty.size()+255)/256);
+    parallel_for(blocks,threads,[&](const int b) {
+      for (const int i : partition_loop(dirty.size(),blocks,b))
+        best[dirty[i]] = best_collapse(dirty[i]);
+    });
+
+    // Update candidates, dropping erased vertices and those without a valid collapse
+    for (const auto v : dirty)
+      if (!listed[v]) {
+        listed[v] = true;
+        candidates.append(v);
+      }
+    int kept = 0;
+    for (const auto v : candidates) {
+      if (mesh.valid(v) && best[v].y.valid())
+        candidates[kept++] = v;
+      else
+        listed[v] = false;
+    }
+    candidates.resize(kept);
+    if (!kept)
+      break;
+
+    // Sort the cheapest quarter
+    const int k = max(min(kept,64),kept/4);
+    std::nth_element(candidates.begin(),candidates.begin()+k-1,candidates.end(),order);
+    std::sort(candidates.begin(),candidates.begin()+k,order);
+
+    // Greedily choose independent collapses
+    accepted.clear();
+    for (const auto vs : candidates.slice(0,k)) {
+      const auto vd = best[vs].y;
+      if (region[vs] == round)
+        continue;
+      bool independent = source[vd] != round;
+      for (const auto v : {vs,vd})
+        for (const auto e : mesh.outgoing(v))
+          if (source[mesh.dst(e)] == round)
+            independent = false;
+      if (!independent)
+        continue;
+      for (const auto v : {vs,vd}) {
+        region[v] = round;
+        for (const auto e : mesh.outgoing(v))
+          region[mesh.dst(e)] = round;
+      }
+      source[vs] = round;
+      accepted.append(vs);
+    }
+
+    // Apply them, collecting the vertices whose best collapse may have changed
+    dirty.clear();
+    for (const auto vs : accepted) {
+      const auto vd = best[vs].y;
+      const auto e = mesh.halfedge(vs,vd);
+      assert(e.valid() && mesh.is_collapse_safe(e));
+      mesh.unsafe_collapse(e);
+      if (mesh.n_vertices() <= min_vertices)
+        return;
+      if (seen[vd] != round) {
+        seen[vd] = round;
+        dirty.append(vd);
+      }
+      for (const auto e : mesh.outgoing(vd)) {
+        const auto v = mesh.dst(e);
+        if (seen[v] != round) {
+          seen[v] = round;
+          dirty.append(v);
+        }
+      }
+    }
+  }
+}
+
 template<ReduceMode reduce_mode, class TField> static void mesh_reduce_helper(MutableTriangleTopology& mesh, const TField& X,
-                      const T distance, const T max_angle, const int min_vertices, const T boundary_distance) {
+                      const T distance, const T max_angle, const int min_vertices, const T boundary_distance,
+                      const int threads, RawField<const bool,VertexId> locked=RawField<const bool,VertexId>()) {
   if (mesh.n_vertices() <= min_vertices)
     return;
 
@@ -244,8 +345,8 @@ template<ReduceMode reduce_mode, class TField> static void mesh_reduce_helper(Mu
 
   // Finds the best edge to collapse v along.  Returns (q(e),dst(e)).
   // Best edge to collapse doesn't require splitting any vertices if possible and has smallest error cost for quadric
-  const auto best_collapse = [&mesh,&X,&collapse_changes_normal_too_much,area,boundary_distance](const VertexId v) {
-    if(mesh.isolated(v)) {
+  const auto best_collapse = [&mesh,&X,&collapse_changes_normal_too_much,area,boundary_distance,locked](const VertexId v) {
+    if(mesh.isolated(v) || (locked.size() && locked[v])) {
       return tuple(CollapsePriority{},VertexId{});
     }
     Quadric q = compute_quadric(mesh,X,v);
@@ -284,6 +385,12 @@ template<ReduceMode reduce_mode, class TField> static void mesh_reduce_helper(Mu
                  mesh.valid(min_e) ? mesh.dst(min_e) : VertexId{}); // Catch isolated vertices and ones we can't collapse
   };
 
+  // Without splitting, every collapse is simple and independent collapses can be batched
+  if (!splitting_enabled(reduce_mode) && threads > 1) {
+    batched_decimate(mesh,min_vertices,threads,best_collapse);
+    return;
+  }
+
   // TODO: Best collapse from a given vertex depends on every neighbor of every neighbor
   //   It might be faster to maintain a heap of halfedges only tracking error from quadrics so that normals and boundary distances don't get evaluated as often
   //   Need to be careful that an invalid collapse with a lower error doesn't hide another valid collapse
@@ -381,10 +488,11 @@ template<ReduceMode reduce_mode, class TField> static void mesh_reduce_helper(Mu
 
 Tuple<Ref<const TriangleTopology>,Field<const TV,VertexId>>
 decimate(const TriangleTopology& mesh, RawField<const TV,VertexId> X,
-         const T distance, const T max_angle, const int min_vertices, const T boundary_distance) {
+         const T distance, const T max_angle, const int min_vertices, const T boundary_distance,
+         const int threads) {
   const auto rmesh = mesh.mutate();
   const auto rX = X.copy();
-  decimate_inplace(rmesh,rX,distance,max_angle,min_vertices,boundary_distance);
+  decimate_inplace(rmesh,rX,distance,max_angle,min_vertices,boundary_distance,threads);
   return Tuple<Ref<const TriangleTopology>,Field<const TV,VertexId>>(rmesh,rX);
 }
 
@@ -393,8 +501,21 @@ void decimate_inplace(MutableTriangleTopology& mesh,
                  const real distance,
                  const real max_angle,
                  const int min_vertices,
-                 const real boundary_distance) {
-  mesh_reduce_helper<ReduceMode::decimate_only>(mesh, X, distance, max_angle, min_vertices, boundary_distance);
+                 const real boundary_distance,
+                 const int threads) {
+  mesh_reduce_helper<ReduceMode::decimate_only>(mesh, X, distance, max_angle, min_vertices, boundary_distance, threads);
+}
+
+void decimate_locked_inplace(MutableTriangleTopology& mesh,
+                 RawField<const Vector<real,3>,VertexId> X,
+                 RawField<const bool,VertexId> locked,
+                 const real distance,
+                 const real max_angle,
+                 const int min_vertices,
+                 const real boundary_distance,
+                 const int threads) {
+  GEODE_ASSERT(locked.size()==mesh.allocated_vertices());
+  mesh_reduce_helper<ReduceMode::decimate_only>(mesh, X, distance, max_angle, min_vertices, boundary_distance, threads, locked);
 }
 
 void simplify_inplace_deprecated(MutableTriangleTopology& mesh,
@@ -403,7 +524,7 @@ void simplify_inplace_deprecated(MutableTriangleTopology& mesh,
                  const real max_angle,
                  const int min_vertices,
                  const real boundary_distance) {
-  mesh_reduce_helper<ReduceMode::simplify_topology>(mesh, mesh.field(X_id), distance, max_angle, min_vertices, boundary_distance);
+  mesh_reduce_helper<ReduceMode::simplify_topology>(mesh, mesh.field(X_id), distance, max_angle, min_vertices, boundary_distance, 1);
 }
 
 #ifdef GEODE_PYTHON
@@ -416,7 +537,7 @@ void simplify_inplace_deprecated_python(MutableTriangleTopology& mesh,
                  const real boundary_distance) {
   GEODE_ASSERT(X_id.prim == PyFieldId::Vertex);
   GEODE_ASSERT(X_id.type && (*X_id.type == typeid(Vector<real,3>)));
-  mesh_reduce_helper<ReduceMode::simplify_topology>(mesh, mesh.field(FieldId<Vector<real,3>,VertexId>{X_id.id}), distance, max_angle, min_vertices, boundary_distance);
+  mesh_reduce_helper<ReduceMode::simplify_topology>(mesh, mesh.field(FieldId<Vector<real,3>,VertexId>{X_id.id}), distance, max_angle, min_vertices, boundary_distance, 1);
 }
 
 void simplify_inplace_python(MutableTriangleTopology& mesh,
@@ -508,8 +629,8 @@ void test_simplify_helper() {
 using namespace geode;
 
 void wrap_decimate() {
-  GEODE_FUNCTION(decimate)
-  GEODE_FUNCTION(decimate_inplace)
+  GEODE_NOGIL_FUNCTION(decimate)
+  GEODE_NOGIL_FUNCTION(decimate_inplace)
   GEODE_FUNCTION(simplify)
 #ifdef GEODE_PYTHON
   GEODE_FUNCTION_2(simplify_inplace, simplify_inplace_python)
@@ -10,7 +10,8 @@ decimate(const TriangleTopology& mesh,
          const real distance,             // (Very) approximate distance between original and decimation
          const real max_angle=pi/2,       // Max normal angle change in radians for one decimation step
          const int min_vertices=-1,       // Stop if we decimate down to this many vertices (-1 for no limit)
-         const real boundary_distance=0); // How far we're allowed to move the boundary
+         const real boundary_distance=0,  // How far we're allowed to move the boundary
+         const int threads=1);            // If > 1, collapse in parallel batches of independent edges
 
 GEODE_CORE_EXPORT void
 decimate_inplace(MutableTriangleTopology& mesh,
@@ -18,7 +19,20 @@ decimate_inplace(MutableTriangleTopology& mesh,
                  const real distance,             // (Very) approximate distance between original and decimation
                  const real max_angle=pi/2,       // Max normal angle change in radians for one decimation step
                  const int min_vertices=-1,       // Stop if we decimate down to this many vertices (-1 for no limit)
-                 const real boundary_distance=0); // How far we're allowed to move the boundary
+                 const real boundary_distance=0,  // How far we're allowed to move the boundary
+                 const int threads=1);            // If > 1, collapse in parallel batches of independent edges
+
+// As decimate_inplace, but vertices with locked[v] set are never collapsed away.  Other vertices may still collapse
+// into them, so their positions are preserved exactly.
+GEODE_CORE_EXPORT void
+decimate_locked_inplace(MutableTriangleTopology& mesh,
+                        RawField<const Vector<real,3>,VertexId> X,
+                        RawField<const bool,VertexId> locked,
+                        const real distance,
+                        const real max_angle=pi/2,
+                        const int min_vertices=-1,
+                        const real boundary_distance=0,
+                        const int threads=1);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleTopology>,Field<const Vector<real,3>,VertexId>>
 simplify_deprecated(const TriangleTopology& mesh,
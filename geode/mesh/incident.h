@@ -0,0 +1,93 @@
+// Parallel counting sort helpers for building mesh topology caches
+#pragma once
+
+#include <geode/array/Nested.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
+namespace geode {
+
+// Number of chunks to split a parallel loop into, for load balancing under parallel_for
+static inline int parallel_blocks(const int threads) {
+  return threads>1 ? 4*threads : 1;
+}
+
+// Exclusive prefix sum of nonnegative counts, computed in contiguous blocks.  The result has one more entry
+// than counts, and ends with the total.
+static inline Array<int> parallel_offsets(RawArray<const int> counts, const int threads) {
+  const int n = counts.size();
+  Array<int> offsets(n+1,uninit);
+  offsets[0] = 0;
+  if (threads<=1 || n<4096) {
+    for (int i=0;i<n;i++)
+      offsets[i+1] = offsets[i]+counts[i];
+    return offsets;
+  }
+  const int blocks = threads;
+  Array<int> starts(blocks+1);
+  parallel_for(blocks,threads,[&](const int b) {
+    int sum = 0;
+    for (const int i : partition_loop(n,blocks,b))
+      sum += counts[i];
+    starts[b+1] = sum;
+  });
+  for (int b=0;b<blocks;b++)
+    starts[b+1] += starts[b];
+  parallel_for(blocks,threads,[&](const int b) {
+    int sum = starts[b];
+    for (const int i : partition_loop(n,blocks,b))
+      offsets[i+1] = sum += counts[i];
+  });
+  return offsets;
+}
+
+// Invert a flat element to vertex map: list value(k) for each k with vertices[k]==v, in order of increasing k.
+// value must be nondecreasing in k; value(k) = k/degree gives the elements incident to each vertex.  Vertices
+// must lie in [0,nodes).  The result is independent of the number of threads.
+template<class Value> static Nested<int> incident_lists(RawArray<const int> vertices, const int nodes,
+                                                        const int threads, const Value& value) {
+  const int n = vertices.size();
+  Array<int> counts(nodes);
+  int* const cursor = counts.data();
+  if (threads<=1) {
+    for (int k=0;k<n;k++)
+      cursor[vertices[k]]++;
+  } else {
+    #pragma omp parallel for num_threads(threads)
+    for (int k=0;k<n;k++) {
+      #pragma omp atomic
+      cursor[vertices[k]]++;
+    }
+  }
+  const Nested<int> lists(parallel_offsets(counts,threads),Array<int>(n,uninit));
+
+  // Scatter backwards from the end of each list, counting down to zero
+  if (threads<=1) {
+    for (int k=n-1;k>=0;k--) {
+      const int v = vertices[k];
+      lists.flat[lists.offsets[v]+--cursor[v]] = value(k);
+    }
+  } else {
+    #pragma omp parallel for num_threads(threads)
+    for (int k=0;k<n;k++) {
+      const int v = vertices[k];
+      int c;
+      #pragma omp atomic capture
+      c = --cursor[v];
+      lists.flat[lists.offsets[v]+c] = value(k);
+    }
+  }
+
+  // Parallel scatter order depends on scheduling, so sort each list
+  if (threads>1) {
+    const int blocks = parallel_blocks(threads);
+    parallel_for(blocks,threads,[&](const int b) {
+      for (const int v : partition_loop(nodes,blocks,b)) {
+        const auto list = lists[v];
+        std::sort(list.begin(),list.end());
+      }
+    });
+  }
+  return lists;
+}
+
+}
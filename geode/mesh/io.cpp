@@ -4,12 +4,20 @@
 #include <geode/mesh/PolygonSoup.h>
 #include <geode/array/view.h>
 #include <geode/geometry/Triangle3d.h>
+#include <geode/math/integer_log.h>
 #include <geode/python/cast.h>
 #include <geode/python/wrap.h>
 #include <geode/utility/endian.h>
 #include <geode/utility/function.h>
+#include <geode/utility/openmp.h>
 #include <geode/utility/path.h>
 #include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 namespace geode {
 
 typedef real T;
@@ -41,6 +49,66 @@ struct File {
     return f;
   }
 };
+
+// A read only view of an entire file.  Where possible we map the file into memory, so that large binary formats
+// can be parsed in place (and in parallel) without first copying the whole file.  On Windows we just read it.
+struct MappedFile {
+  const char* data;
+  size_t size;
+#ifdef _WIN32
+  vector<char> buffer;
+#endif
+
+  MappedFile(const string& filename)
+    : data(0), size(0) {
+#ifdef _WIN32
+    File f(filename,"rb");
+    if (_fseeki64(f,0,SEEK_END) || _fseeki64(f,0,SEEK_SET))
+      throw IOError(format("can't seek in '%s': %s",filename,strerror(errno)));
+    buffer.resize(size_t(_ftelli64(f)));
+    size = fread(buffer.data(),1,buffer.size(),f);
+    data = buffer.data();
+#else
+    const int fd = open(filename.c_str(),O_RDONLY);
+    if (fd < 0)
+      throw IOError(format("can't open '%s' for reading: %s",filename,strerror(errno)));
+    struct stat st;
+    if (fstat(fd,&st) < 0) {
+      const int e = errno;
+      close(fd);
+      throw IOError(format("can't stat '%s': %s",filename,strerror(e)));
+    }
+    size = size_t(st.st_size);
+    if (size) {
+      void* const p = mmap(0,size,PROT_READ,MAP_PRIVATE,fd,0);
+      if (p == MAP_FAILED) {
+        const int e = errno;
+        close(fd);
+        throw IOError(format("can't map '%s': %s",filename,strerror(e)));
+      }
+      data = (const char*)p;
+    }
+    close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (size)
+      munmap((void*)data,size);
+#endif
+  }
+};
+}
+
+// Load a possibly unaligned value from a file in memory
+template<class T> static inline T load(const char* p, const bool flip) {
+  T x;
+  memcpy(&x,p,sizeof(T));
+  return flip ? flip_endian(x) : x;
 }
 
 // Determine whether a file is probably binary or ascii
@@ -71,50 +139,116 @@ struct StlTri {
 };
 static_assert(sizeof(StlTri)==12*4+2,"");
 
-// See http://en.wikipedia.org/wiki/STL_file for details
-static Tuple<Ref<TriangleSoup>,Array<TV>> read_stl(const string& filename) {
-  if (is_binary(filename)) {
-    File f(filename,"rb");
+// Read a binary stl in place, welding vertices with identical positions.  Corners are scattered into buckets by the high
+// bits of their hash, each bucket finds the first corner at each position independently, and vertices are numbered in
+// order of first appearance, so the result does not depend on the number of threads.
+static Tuple<Ref<TriangleSoup>,Array<TV>> read_binary_stl(const string& filename, const int threads) {
+  const MappedFile file(filename);
+  if (file.size < 84)
+    throw IOError(format("invalid binary stl '%s': incomplete header",filename));
+
+  // Read count
+  const bool flip = GEODE_ENDIAN != GEODE_LITTLE_ENDIAN;
+  const auto count = load<uint32_t>(file.data+80,flip);
+  if (count > (1u<<31)/3-1)
+    throw IOError(format("binary stl has too many triangles: %u > 2^31/3-1",count));
+  if (file.size < 84+sizeof(StlTri)*size_t(count))
+    throw IOError(format("invalid binary stl '%s': failed to read triangles",filename));
+
+  // Corner c is vertex c%3 of triangle c/3.  We weld -0 and 0.
+  const char* const data = file.data+84;
+  const auto corner = [=](const int c) {
+    const char* p = data+sizeof(StlTri)*(c/3)+sizeof(Vector<float,3>)*(1+c%3);
+    Vector<float,3> x;
+    for (int a=0;a<3;a++) {
+      x[a] = load<float>(p+sizeof(float)*a,flip);
+      if (!x[a])
+        x[a] = 0;
+    }
+    return x;
+  };
+  const int n = 3*count,
+            chunks = threads>1 ? 16*threads : 1,
+            log_buckets = integer_log(chunks),
+            buckets = 1<<log_buckets;
+  const auto bucket = [=](const Vector<float,3>& x) {
+    return log_buckets ? int(uint32_t(hash(x))>>(32-log_buckets)) : 0;
+  };
+
+  // Scatter corners into buckets, preserving order within each bucket
+  Array<int> order, bucket_starts;
+  if (buckets > 1) {
+    Array<int> offsets(chunks*buckets);
+    parallel_for(chunks,threads,[&](const int k) {
+      for (const int c : partition_loop(n,chunks,k))
+        offsets[k*buckets+bucket(corner(c))]++;
+    });
+    bucket_starts.resize(buckets+1,uninit);
+    for (int b=0,offset=0;b<=buckets;b++) {
+      bucket_starts[b] = offset;
+      if (b < buckets)
+        for (const int k : range(chunks)) {
+          const int m = offsets[k*buckets+b];
+          offsets[k*buckets+b] = offset;
+          offset += m;
+        }
+    }
+    order.resize(n,uninit);
+    parallel_for(chunks,threads,[&](const int k) {
+      for (const int c : partition_loop(n,chunks,k))
+        order[offsets[k*buckets+bucket(corner(c))]++] = c;
+    });
+  }
 
-    // Skip header
-    char header[80];
-    const auto nh = fread(header,1,sizeof(header),f);
-    if (nh < sizeof(header))
-      throw IOError(format("invalid binary stl '%s': %s",filename,
-        ferror(f) ? format("read failed: %s",strerror(errno)) : "incomplete header"));
-
-    // Read count
-    uint32_t count;
-    const auto nc = fread(&count,sizeof(count),1,f);
-    if (nc < 1)
-      throw IOError(format("invalid binary stl '%s': failed to read count",filename));
-    if (count > (1u<<31)/3-1)
-      throw IOError(format("binary stl has too many triangles: %u > 2^31/3-1",count));
-
-    // Read triangles
-    Array<StlTri> data(count,uninit);
-    const auto nt = fread(data.data(),sizeof(StlTri),count,f);
-    if (nt < count)
-      throw IOError(format("invalid binary stl '%s': failed to read triangles",filename));
-
-    // Deduplicate
+  // Map each corner to the first corner with the same position
+  Array<Vector<int,3>> tris(count,uninit);
+  const auto first = scalar_view(tris);
+  parallel_for(buckets,threads,[&](const int b) {
     Hashtable<Vector<float,3>,int> id;
-    Array<Vector<int,3>> tris;
-    Array<TV> X;
-    for (auto& t : data) {
-      StlTriData d;
-      memcpy(&d,t.d,sizeof(d));
-      Vector<int,3> tri;
-      for (int a=0;a<3;a++) {
-        const int i = id.get_or_insert(d.x[a],X.size());
-        if (i == X.size())
-          X.append(TV(d.x[a]));
-        tri[a] = i;
+    if (buckets == 1)
+      for (const int c : range(n))
+        first[c] = id.get_or_insert(corner(c),c);
+    else
+      for (const int c : order.slice(bucket_starts[b],bucket_starts[b+1]))
+        first[c] = id.get_or_insert(corner(c),c);
+  });
+  order.clean_memory();
+
+  // Number first corners in order, marking them with ~vertex so that other corners can find them
+  Array<int> chunk_vertices(chunks+1);
+  parallel_for(chunks,threads,[&](const int k) {
+    for (const int c : partition_loop(n,chunks,k))
+      chunk_vertices[k+1] += first[c]==c;
+  });
+  for (const int k : range(chunks))
+    chunk_vertices[k+1] += chunk_vertices[k];
+  Array<TV> X(chunk_vertices.back(),uninit);
+  parallel_for(chunks,threads,[&](const int k) {
+    int v = chunk_vertices[k];
+    for (const int c : partition_loop(n,chunks,k))
+      if (first[c]==c) {
+        X[v] = TV(corner(c));
+        first[c] = ~v++;
       }
-      tris.append(tri);
-    }
-    return tuple(new_<TriangleSoup>(tris,X.size()),X);
-  } else { // ASCII
+  });
+  parallel_for(chunks,threads,[&](const int k) {
+    for (const int c : partition_loop(n,chunks,k))
+      if (first[c] >= 0)
+        first[c] = ~first[first[c]];
+  });
+  parallel_for(chunks,threads,[&](const int k) {
+    for (const int c : partition_loop(n,chunks,k))
+      if (first[c] < 0)
+        first[c] = ~first[c];
+  });
+  return tuple(new_<TriangleSoup>(tris,X.size()),X);
+}
+
+// See http://en.wikipedia.org/wiki/STL_file for details
+static Tuple<Ref<TriangleSoup>,Array<TV>> read_stl(const string& filename, const int threads) {
+  if (is_binary(filename))
+    return read_binary_stl(filename,threads);
+  else { // ASCII
     File f(filename,"r");
 
     // Prepare for deduplication
@@ -356,9 +490,10 @@ protected:
   PlyProp(const string& name)
     : name(name) {}
 public:
+  virtual void preallocate(const int count) = 0;
   virtual void read_ascii(RawArray<const char*> words, int& i) = 0;
-  virtual void read_binary_same_endian(FILE* f) = 0;
-  virtual void read_binary_flip_endian(FILE* f) = 0;
+  virtual bool is_list() const = 0;
+  virtual size_t binary_size(const char* p) const = 0; // Size in bytes of a binary value starting at p
   virtual string type() const = 0;
 };
 
@@ -415,8 +550,10 @@ template<class T> struct PlyPropSingle : public PlyProp {
   GEODE_NEW_FRIEND
   Array<T> a;
 protected:
-  PlyPropSingle(const string& name, const int count)
-    : PlyProp(name) {
+  PlyPropSingle(const string& name)
+    : PlyProp(name) {}
+
+  void preallocate(const int count) {
     a.preallocate(count);
   }
 
@@ -426,18 +563,12 @@ protected:
     a.append_assuming_enough_space(parse<T>(words[i++]));
   }
 
-  void read_binary_same_endian(FILE* f) {
-    T x;
-    if (fread(&x,sizeof(T),1,f) < 1)
-      throw IOError(format("incomplete element (no %s)",name));
-    a.append(x);
+  bool is_list() const {
+    return false;
   }
 
-  void read_binary_flip_endian(FILE* f) {
-    T x;
-    if (fread(&x,sizeof(T),1,f) < 1)
-      throw IOError(format("incomplete element (no %s)",name));
-    a.append(flip_endian(x));
+  size_t binary_size(const char* p) const {
+    return sizeof(T);
   }
 
   string type() const {
@@ -451,9 +582,11 @@ template<class L,class T> struct PlyPropList : public PlyProp {
   Array<int> counts;
   Array<T> flat;
 protected:
-  PlyPropList(const string& name, const int n)
-    : PlyProp(name) {
-    counts.preallocate(n);
+  PlyPropList(const string& name)
+    : PlyProp(name) {}
+
+  void preallocate(const int count) {
+    counts.preallocate(count);
   }
 
   void read_ascii(RawArray<const char*> words, int& i) {
@@ -469,29 +602,12 @@ protected:
     }
   }
 
-  void read_binary_same_endian(FILE* f) {
-    L n;
-    if (fread(&n,sizeof(L),1,f) < 1)
-      throw IOError(format("incomplete element (no %s size)",name));
-    counts.append_assuming_enough_space(n);
-    const int offset = flat.size();
-    flat.resize(flat.size()+n);
-    if (fread(flat.data()+offset,sizeof(T),n,f) < n)
-      throw IOError(format("incomplete element (incomplete %s list)",name));
+  bool is_list() const {
+    return true;
   }
 
-  void read_binary_flip_endian(FILE* f) {
-    L n;
-    if (fread(&n,sizeof(L),1,f) < 1)
-      throw IOError(format("incomplete element (no %s size)",name));
-    n = flip_endian(n);
-    counts.append_assuming_enough_space(n);
-    const int offset = flat.size();
-    flat.resize(flat.size()+n);
-    if (fread(flat.data()+offset,sizeof(T),n,f) < n)
-      throw IOError(format("incomplete element (incomplete %s list)",name));
-    for (int i=0;i<n;i++)
-      flat[offset+i] = flip_endian(flat[offset+i]);
+  size_t binary_size(const char* p) const {
+    return sizeof(L)+sizeof(T)*size_t(uint8_t(*p));
   }
 
   string type() const {
@@ -509,165 +625,368 @@ protected:
   PlyElement(const string& name, const int count)
     : name(name)
     , count(count) {}
+public:
+  int prop_index(const string& prop) const {
+    for (const int i : range(int(props.size())))
+      if (props[i]->name == prop)
+        return i;
+    return -1;
+  }
+};
+
+// Record locations of one element in a binary ply file
+struct PlyRecords {
+  const char* start;
+  size_t stride; // If nonzero, record i starts at start+stride*i
+  Array<size_t> offsets; // Otherwise, record i starts at start+offsets[i], and the end is start+offsets.back()
+  size_t size; // Total size in bytes
+
+  const char* operator[](const int i) const {
+    return start+(stride ? stride*i : offsets[i]);
+  }
+
+  // Start of a property within a record
+  const char* prop(const PlyElement& E, const char* p, const int index) const {
+    for (const int i : range(index))
+      p += E.props[i]->binary_size(p);
+    return p;
+  }
+};
+
+// Face lists and vertex positions read from a ply file
+struct PlyData {
+  int degree; // If positive, every face has this many vertices and counts is empty
+  Array<int> counts, vertices;
+  Array<TV> X;
 };
 }
 
-static Tuple<Ref<PolygonSoup>,Array<TV>> read_ply(const string& filename) {
-  File f(filename,"rb");
-  Line line;
-  try {
-    // Read magic string
-    if (!line.read(f) || line.words.size()!=1 || strcmp(line.words[0],"ply")) {
-      cout << "words = "<<line.words<<endl;
-      throw IOError(format("expected magic string 'ply', got %s",repr(line)));
+// Locate the records of a binary ply element.  If every list has the same length as in the first record, records have
+// a fixed stride, which we verify in parallel.  Otherwise, we scan serially for record offsets.
+static PlyRecords ply_records(const PlyElement& E, const char* start, const char* end, const int threads) {
+  PlyRecords R;
+  R.start = start;
+  R.stride = 0;
+  R.size = 0;
+  if (!E.count)
+    return R;
+
+  // Walk one record, checking bounds as we go
+  const auto record_size = [&](const int i, const char* p) {
+    size_t size = 0;
+    for (const auto& prop : E.props) {
+      if (p+size >= end)
+        throw IOError(format("failed to read element %s, index %d, prop %s: unexpected end of file",
+          repr(E.name),i,repr(prop->name)));
+      size += prop->binary_size(p+size);
     }
+    if (size > size_t(end-p))
+      throw IOError(format("failed to read element %s, index %d: unexpected end of file",repr(E.name),i));
+    return size;
+  };
+
+  // Try a fixed stride based on the first record
+  const size_t stride = record_size(0,start);
+  Array<Vector<size_t,2>> lists; // (offset,length) of each list within the first record
+  for (size_t i=0,offset=0;i<E.props.size();i++) {
+    if (E.props[i]->is_list())
+      lists.append(vec(offset,size_t(uint8_t(start[offset]))));
+    offset += E.props[i]->binary_size(start+offset);
+  }
+  bool fixed = stride*E.count <= size_t(end-start);
+  if (fixed && lists.size()) {
+    const int chunks = threads>1 ? 16*threads : 1;
+    Array<bool> bad(chunks);
+    parallel_for(chunks,threads,[&](const int k) {
+      for (const int i : partition_loop(E.count,chunks,k))
+        for (const auto& l : lists)
+          if (size_t(uint8_t(start[stride*i+l.x])) != l.y) {
+            bad[k] = true;
+            return;
+          }
+    });
+    fixed = !bad.contains(true);
+  }
+  if (fixed) {
+    R.stride = stride;
+    R.size = stride*E.count;
+    return R;
+  }
 
-    // Read rest of header
-    int fmt = 0; // 1 for ascii, 2 for binary little endian, 3 for binary big endian
-    vector<Ref<PlyElement>> elements;
-    Hashtable<string,Ref<PlyElement>> element_names;
-    for (;;) {
-      if (!line.read(f))
-        throw IOError("eof before end of header");
-      const auto words = line.words.raw();
-      if (!words.size() || !strcmp(words[0],"comment"))
-        continue;
-      else if (!strcmp(words[0],"format")) {
-        if (fmt)
-          throw IOError("duplicate format line");
-        if (words.size() != 3)
-          throw IOError(format("invalid format line %s",repr(line)));
-        try {
-          const double version = parse<double>(words[2]);
-          if (version != 1)
-            throw IOError("");
-        } catch (const IOError&) {
-          throw IOError(format("unsupported version %s",repr(words[2])));
-        }
-        if      (!strcmp(words[1],"ascii"))                fmt = 1;
-        else if (!strcmp(words[1],"binary_little_endian")) fmt = 2;
-        else if (!strcmp(words[1],"binary_big_endian"))    fmt = 3;
-      } else if (!strcmp(words[0],"element")) {
-        try {
-          if (words.size() != 3)
-            throw IOError("expected 'element <name> <count>'");
-          const auto E = new_<PlyElement>(words[1],parse<int>(words[2]));
-          if (!element_names.set(E->name,E))
-            throw IOError(format("duplicate element name %s",repr(E->name)));
-          elements.push_back(E);
-        } catch (const IOError& e) {
-          throw IOError(format("invalid element declaration %s: %s",repr(line),e.what()));
+  // Fall back to a serial scan
+  R.offsets.resize(E.count+1,uninit);
+  size_t offset = 0;
+  for (const int i : range(E.count)) {
+    R.offsets[i] = offset;
+    offset += record_size(i,start+offset);
+  }
+  R.offsets[E.count] = R.size = offset;
+  return R;
+}
+
+// Find the x,y,z properties of a binary ply vertex element, and whether each is double precision
+static void ply_position_props(const PlyElement& E, int index[3], bool dp[3]) {
+  for (const int a : range(3)) {
+    const string c(1,"xyz"[a]);
+    index[a] = E.prop_index(c);
+    if (index[a] < 0)
+      throw IOError(format("vertex element missing property %s",c));
+    const auto& prop = *E.props[index[a]];
+    dp[a] = dynamic_cast<const PlyPropSingle<double>*>(&prop)!=0;
+    if (!dp[a] && !dynamic_cast<const PlyPropSingle<float>*>(&prop))
+      throw IOError(format("vertex.%s has invalid type %s",c,prop.type()));
+  }
+}
+
+// Find the vertex_indices property of a binary ply face element
+static int ply_face_prop(const PlyElement& E) {
+  const int index = E.prop_index("vertex_indices");
+  if (index < 0)
+    throw IOError("face element missing vertex_indices");
+  const auto& prop = *E.props[index];
+  if (!dynamic_cast<const PlyPropList<uint8_t,int>*>(&prop))
+    throw IOError(format("face.vertex_indices has unsupported type %s",prop.type()));
+  return index;
+}
+
+// Read a binary ply in place from a memory map, parsing vertices and faces in parallel chunks
+static PlyData read_binary_ply(const string& filename, const size_t header, const vector<Ref<PlyElement>>& elements,
+                               const bool flip, const int threads) {
+  const MappedFile file(filename);
+  if (file.size < header)
+    throw IOError("file shrank while reading");
+  const char* p = file.data+header;
+  const char* const end = file.data+file.size;
+  const int chunks = threads>1 ? 16*threads : 1;
+  PlyData data;
+  data.degree = 0;
+  bool found_vertex = false, found_face = false;
+  for (const auto& E : elements) {
+    const auto R = ply_records(E,p,end,threads);
+    p += R.size;
+    if (E->name == "vertex") {
+      found_vertex = true;
+      int index[3];
+      bool dp[3];
+      ply_position_props(E,index,dp);
+      data.X = Array<TV>(E->count,uninit);
+      parallel_for(chunks,threads,[&](const int k) {
+        for (const int i : partition_loop(E->count,chunks,k))
+          for (const int a : range(3)) {
+            const char* q = R.prop(E,R[i],index[a]);
+            data.X[i][a] = dp[a] ? load<double>(q,flip) : load<float>(q,flip);
+          }
+      });
+    } else if (E->name == "face") {
+      found_face = true;
+      const int index = ply_face_prop(E);
+      const auto count = [&](const int i) { return int(uint8_t(*R.prop(E,R[i],index))); };
+
+      // Find where each face starts
+      Array<int> starts;
+      if (R.stride) {
+        data.degree = E->count ? count(0) : 0;
+        if (size_t(data.degree)*E->count > size_t(numeric_limits<int>::max()))
+          throw IOError("too many face vertices, our limit is 2^31-1");
+        data.vertices = Array<int>(data.degree*E->count,uninit);
+        if (!data.degree)
+          data.counts = Array<int>(E->count);
+      } else {
+        data.counts = Array<int>(E->count,uninit);
+        parallel_for(chunks,threads,[&](const int k) {
+          for (const int i : partition_loop(E->count,chunks,k))
+            data.counts[i] = count(i);
+        });
+        starts.resize(E->count,uninit);
+        size_t offset = 0;
+        for (const int i : range(E->count)) {
+          starts[i] = int(offset);
+          offset += data.counts[i];
         }
-      } else if (!strcmp(words[0],"property")) {
-        if (!elements.size())
-          throw IOError("property before element");
-        PlyElement& E = elements.back();
-        if (words.size() < 3)
-          throw IOError("incomplete property declaration, expected 'property [list uchar] type name'");
-        Ptr<PlyProp> prop;
-        #define SINGLE_CASE(name,T) \
-          else if (!strcmp(words[1],#name)) \
-            prop = new_<PlyPropSingle<T>>(words[2],E.count);
-        #define LIST_CASE(name,T) \
-          else if (!strcmp(words[3],#name)) \
-            prop = new_<PlyPropList<uint8_t,T>>(words[4],E.count);
-        if (!strcmp(words[1],"list")) {
-          if (words.size() != 5)
-            throw IOError("invalid list property declaration, expected 'property list uchar type name'");
-          if (strcmp(words[2],"uchar"))
-            throw IOError(format("unsupported list property declaration, only uchar sizes are supported, got %s",
-              repr(words[2])));
-          PLY_TYPE_NAMES(LIST_CASE)
-          else
-            throw IOError(format("invalid list property type %s",repr(words[3])));
-        } else {
-          if (words.size() != 3)
-            throw IOError("invalid single property declaration, expected 'property type name'");
-          PLY_TYPE_NAMES(SINGLE_CASE)
-          else
-            throw IOError(format("invalid property type %s",repr(words[1])));
+        if (offset > size_t(numeric_limits<int>::max()))
+          throw IOError("too many face vertices, our limit is 2^31-1");
+        data.vertices = Array<int>(int(offset),uninit);
+      }
+
+      // Read vertex indices
+      parallel_for(chunks,threads,[&](const int k) {
+        for (const int i : partition_loop(E->count,chunks,k)) {
+          const char* q = R.prop(E,R[i],index);
+          const int n = uint8_t(*q++),
+                    start = R.stride ? data.degree*i : starts[i];
+          for (const int j : range(n))
+            data.vertices[start+j] = load<int>(q+sizeof(int)*j,flip);
         }
-        if (!E.prop_names.set(prop->name,ref(prop)))
-          throw IOError(format("duplicate property name %s for element %s",repr(prop->name),repr(E.name)));
-        E.props.push_back(ref(prop));
-      } else if (!strcmp(words[0],"end_header"))
-        break;
-      else
-        throw IOError(format("invalid header command %s",repr(words[0])));
+      });
     }
-    if (!fmt)
-      throw IOError("missing format declaration");
+  }
+  if (!found_vertex)
+    throw IOError("missing vertex element");
+  if (!found_face)
+    throw IOError("missing face element");
+  return data;
+}
 
+namespace {
+// The parsed header of a ply file
+struct PlyHeader {
+  int fmt; // 1 for ascii, 2 for binary little endian, 3 for binary big endian
+  vector<Ref<PlyElement>> elements;
+  Hashtable<string,Ref<PlyElement>> element_names;
+  size_t size; // Bytes up to and including end_header
+
+  // Do binary values need byte swapping?
+  bool flip() const {
     #if GEODE_ENDIAN == GEODE_LITTLE_ENDIAN
-      const int native = 2;
+      return fmt==3;
     #elif GEODE_ENDIAN == GEODE_BIG_ENDIAN
-      const int native = 3;
+      return fmt==2;
     #endif
+  }
+};
+}
 
-    // Read all elements
-    if (fmt == 1) {
-      for (const auto& E : elements) {
-        for (const int i : range(E->count)) {
-          if (!line.read(f))
-            throw IOError(format("failed to read element %s, index %d: unexpected end of file",repr(E->name),i));
-          int n = 0;
-          for (const auto& prop : E->props) {
-            try {
-              prop->read_ascii(line.words,n);
-            } catch (const IOError& e) {
-              throw IOError(format("failed to read element %s, index %d, prop %s: %s",
-                repr(E->name),i,repr(prop->name),e.what()));
-            }
-          }
-          if (n != line.words.size())
-            throw IOError(format("failed to read element %s, index %d: extra fields",repr(E->name),i));
-        }
+// Read a ply header, leaving f positioned at the start of the data
+static PlyHeader read_ply_header(File& f, Line& line) {
+  // Read magic string
+  if (!line.read(f) || line.words.size()!=1 || strcmp(line.words[0],"ply")) {
+    cout << "words = "<<line.words<<endl;
+    throw IOError(format("expected magic string 'ply', got %s",repr(line)));
+  }
+
+  // Read rest of header
+  PlyHeader H;
+  H.fmt = 0;
+  for (;;) {
+    if (!line.read(f))
+      throw IOError("eof before end of header");
+    const auto words = line.words.raw();
+    if (!words.size() || !strcmp(words[0],"comment"))
+      continue;
+    else if (!strcmp(words[0],"format")) {
+      if (H.fmt)
+        throw IOError("duplicate format line");
+      if (words.size() != 3)
+        throw IOError(format("invalid format line %s",repr(line)));
+      try {
+        const double version = parse<double>(words[2]);
+        if (version != 1)
+          throw IOError("");
+      } catch (const IOError&) {
+        throw IOError(format("unsupported version %s",repr(words[2])));
       }
-    } else if (fmt == native) {
-      for (const auto& E : elements) {
-        for (const int i : range(E->count)) {
-          for (const auto& prop : E->props) {
-            try {
-              prop->read_binary_same_endian(f);
-            } catch (const IOError& e) {
-              throw IOError(format("failed to read element %s, index %d, prop %s: %s",
-                repr(E->name),i,repr(prop->name),e.what()));
-            }
-          }
-        }
+      if      (!strcmp(words[1],"ascii"))                H.fmt = 1;
+      else if (!strcmp(words[1],"binary_little_endian")) H.fmt = 2;
+      else if (!strcmp(words[1],"binary_big_endian"))    H.fmt = 3;
+    } else if (!strcmp(words[0],"element")) {
+      try {
+        if (words.size() != 3)
+          throw IOError("expected 'element <name> <count>'");
+        const auto E = new_<PlyElement>(words[1],parse<int>(words[2]));
+        if (!H.element_names.set(E->name,E))
+          throw IOError(format("duplicate element name %s",repr(E->name)));
+        H.elements.push_back(E);
+      } catch (const IOError& e) {
+        throw IOError(format("invalid element declaration %s: %s",repr(line),e.what()));
       }
-    } else { // fmt == nonnative
-      for (const auto& E : elements) {
-        for (const int i : range(E->count)) {
-          for (const auto& prop : E->props) {
-            try {
-              prop->read_binary_flip_endian(f);
-            } catch (const IOError& e) {
-              throw IOError(format("failed to read element %s, index %d, prop %s: %s",
-                repr(E->name),i,repr(prop->name),e.what()));
-            }
+    } else if (!strcmp(words[0],"property")) {
+      if (!H.elements.size())
+        throw IOError("property before element");
+      PlyElement& E = H.elements.back();
+      if (words.size() < 3)
+        throw IOError("incomplete property declaration, expected 'property [list uchar] type name'");
+      Ptr<PlyProp> prop;
+      #define SINGLE_CASE(name,T) \
+        else if (!strcmp(words[1],#name)) \
+          prop = new_<PlyPropSingle<T>>(words[2]);
+      #define LIST_CASE(name,T) \
+        else if (!strcmp(words[3],#name)) \
+          prop = new_<PlyPropList<uint8_t,T>>(words[4]);
+      if (!strcmp(words[1],"list")) {
+        if (words.size() != 5)
+          throw IOError("invalid list property declaration, expected 'property list uchar type name'");
+        if (strcmp(words[2],"uchar"))
+          throw IOError(format("unsupported list property declaration, only uchar sizes are supported, got %s",
+            repr(words[2])));
+        PLY_TYPE_NAMES(LIST_CASE)
+        else
+          throw IOError(format("invalid list property type %s",repr(words[3])));
+      } else {
+        if (words.size() != 3)
+          throw IOError("invalid single property declaration, expected 'property type name'");
+        PLY_TYPE_NAMES(SINGLE_CASE)
+        else
+          throw IOError(format("invalid property type %s",repr(words[1])));
+      }
+      if (!E.prop_names.set(prop->name,ref(prop)))
+        throw IOError(format("duplicate property name %s for element %s",repr(prop->name),repr(E.name)));
+      E.props.push_back(ref(prop));
+    } else if (!strcmp(words[0],"end_header"))
+      break;
+    else
+      throw IOError(format("invalid header command %s",repr(words[0])));
+  }
+  if (!H.fmt)
+    throw IOError("missing format declaration");
+  const long header = ftell(f);
+  if (header < 0)
+    throw IOError(format("ftell failed: %s",strerror(errno)));
+  H.size = size_t(header);
+  return H;
+}
+
+static PlyData read_ply_data(const string& filename, const int threads) {
+  File f(filename,"rb");
+  Line line;
+  try {
+    const auto H = read_ply_header(f,line);
+    const auto& elements = H.elements;
+    const auto& element_names = H.element_names;
+
+    // Binary files are read in place
+    if (H.fmt != 1)
+      return read_binary_ply(filename,H.size,elements,H.flip(),threads);
+
+    // Read all elements
+    for (const auto& E : elements) {
+      for (const auto& prop : E->props)
+        prop->preallocate(E->count);
+      for (const int i : range(E->count)) {
+        if (!line.read(f))
+          throw IOError(format("failed to read element %s, index %d: unexpected end of file",repr(E->name),i));
+        int n = 0;
+        for (const auto& prop : E->props) {
+          try {
+            prop->read_ascii(line.words,n);
+          } catch (const IOError& e) {
+            throw IOError(format("failed to read element %s, index %d, prop %s: %s",
+              repr(E->name),i,repr(prop->name),e.what()));
           }
         }
+        if (n != line.words.size())
+          throw IOError(format("failed to read element %s, index %d: extra fields",repr(E->name),i));
       }
     }
 
     // Pull out all the data we need
     // TODO: Don't discard all the rest of the data
+    PlyData data;
+    data.degree = 0;
     if (!element_names.contains("vertex"))
       throw IOError("missing vertex element");
     const auto vertex = element_names.get("vertex");
-    Array<TV> X(vertex->count,uninit);
+    data.X = Array<TV>(vertex->count,uninit);
     for (const int i : range(3)) {
       const string c(1,"xyz"[i]);
       if (!vertex->prop_names.contains(c))
         throw IOError(format("vertex element missing property %s",c));
       const auto x_ = vertex->prop_names.get(c);
       if (const auto* x = dynamic_cast<PlyPropSingle<float>*>(&*x_)) {
-        for (const int j : range(X.size()))
-          X[j][i] = x->a[j];
+        for (const int j : range(data.X.size()))
+          data.X[j][i] = x->a[j];
       } else if (const auto& x = dynamic_cast<PlyPropSingle<double>*>(&*x_)) {
-        for (const int j : range(X.size()))
-          X[j][i] = x->a[j];
+        for (const int j : range(data.X.size()))
+          data.X[j][i] = x->a[j];
       } else
         throw IOError(format("vertex.%s has invalid type %s",c,x_->type()));
     }
@@ -677,15 +996,159 @@ static Tuple<Ref<PolygonSoup>,Array<TV>> read_ply(const string& filename) {
     if (!face->prop_names.contains("vertex_indices"))
       throw IOError("face element missing vertex_indices");
     const auto vertices = face->prop_names.get("vertex_indices");
-    if (const auto* v = dynamic_cast<PlyPropList<uint8_t,int>*>(&*vertices))
-      return tuple(new_<PolygonSoup>(v->counts,v->flat,X.size()),X);
-    else
+    if (const auto* v = dynamic_cast<PlyPropList<uint8_t,int>*>(&*vertices)) {
+      data.counts = v->counts;
+      data.vertices = v->flat;
+      return data;
+    } else
       throw IOError(format("face.vertex_indices has unsupported type %s",vertices->type()));
   } catch (const IOError& e) {
     throw IOError(format("invalid ply file %s:%d: %s",filename,line.lineno,e.what()));
   }
 }
 
+// Stream triangles from a binary stl in order
+static void stream_binary_stl(const string& filename, const int batch,
+                              const function<void(RawArray<const Vector<TV,3>>)>& visit) {
+  const MappedFile file(filename);
+  if (file.size < 84)
+    throw IOError(format("invalid binary stl '%s': incomplete header",filename));
+  const bool flip = GEODE_ENDIAN != GEODE_LITTLE_ENDIAN;
+  const auto count = load<uint32_t>(file.data+80,flip);
+  if (file.size < 84+sizeof(StlTri)*size_t(count))
+    throw IOError(format("invalid binary stl '%s': failed to read triangles",filename));
+  Array<Vector<TV,3>> tris;
+  tris.preallocate(batch);
+  for (uint32_t t=0;t<count;t++) {
+    const char* p = file.data+84+sizeof(StlTri)*size_t(t)+sizeof(Vector<float,3>);
+    Vector<TV,3> tri;
+    for (int i=0;i<3;i++)
+      for (int a=0;a<3;a++) {
+        const float x = load<float>(p+sizeof(float)*(3*i+a),flip);
+        tri[i][a] = x ? x : 0; // Weld -0 and 0, as read_binary_stl does
+      }
+    tris.append(tri);
+    if (tris.size()==batch) {
+      visit(tris);
+      tris.clear();
+    }
+  }
+  if (tris.size())
+    visit(tris);
+}
+
+// Stream triangles from a binary ply in order.  Vertices are read on demand from the memory map, and faces are
+// walked sequentially, so no per face storage is needed.
+static void stream_binary_ply(const string& filename, const PlyHeader& H, const int batch,
+                              const function<void(RawArray<const Vector<TV,3>>)>& visit) {
+  const MappedFile file(filename);
+  if (file.size < H.size)
+    throw IOError("file shrank while reading");
+  const bool flip = H.flip();
+  const char* p = file.data+H.size;
+  const char* const end = file.data+file.size;
+  const PlyElement* vertex = 0;
+  PlyRecords V;
+  int index[3];
+  bool dp[3];
+  for (const auto& E : H.elements) {
+    if (E->name == "face") {
+      if (!vertex)
+        throw IOError("streaming requires the vertex element before the face element");
+      const auto position = [&](const int v) {
+        if (unsigned(v) >= unsigned(vertex->count))
+          throw IOError(format("face vertex index %d out of range [0,%d)",v,vertex->count));
+        TV x;
+        for (const int a : range(3)) {
+          const char* q = V.prop(*vertex,V[v],index[a]);
+          x[a] = dp[a] ? load<double>(q,flip) : load<float>(q,flip);
+        }
+        return x;
+      };
+      const int face = ply_face_prop(E);
+      Array<Vector<TV,3>> tris;
+      tris.preallocate(batch+254);
+      for (const int i : range(E->count)) {
+        // Walk over the record, noting where the vertex indices start
+        const char* q = 0;
+        int j = 0;
+        for (;j<int(E->props.size()) && p<end;j++) {
+          if (j == face)
+            q = p;
+          p += E->props[j]->binary_size(p);
+        }
+        if (j < int(E->props.size()) || p > end)
+          throw IOError(format("failed to read element face, index %d: unexpected end of file",i));
+        const int n = uint8_t(*q);
+        const auto vertex_index = [=](const int j) { return load<int>(q+1+sizeof(int)*j,flip); };
+        if (n >= 3) {
+          const TV x0 = position(vertex_index(0));
+          TV x1 = position(vertex_index(1));
+          for (int j=2;j<n;j++) { // Fan polygons into triangles
+            const TV x2 = position(vertex_index(j));
+            tris.append(vec(x0,x1,x2));
+            x1 = x2;
+          }
+        }
+        if (tris.size() >= batch) {
+          visit(tris);
+          tris.clear();
+        }
+      }
+      if (tris.size())
+        visit(tris);
+      return;
+    }
+    const auto R = ply_records(E,p,end,1);
+    if (E->name == "vertex") {
+      vertex = &*E;
+      V = R;
+      ply_position_props(E,index,dp);
+    }
+    p += R.size;
+  }
+  throw IOError("missing face element");
+}
+
+void stream_triangles(const string& filename, const int batch,
+                      const function<void(RawArray<const Vector<TV,3>>)>& visit) {
+  GEODE_ASSERT(batch > 0);
+  const auto ext = path::extension(filename);
+  if (ext == ".stl" && is_binary(filename))
+    stream_binary_stl(filename,batch,visit);
+  else if (ext == ".ply") {
+    File f(filename,"rb");
+    Line line;
+    try {
+      const auto H = read_ply_header(f,line);
+      if (H.fmt == 1)
+        throw IOError("streaming requires a binary ply file");
+      stream_binary_ply(filename,H,batch,visit);
+    } catch (const IOError& e) {
+      throw IOError(format("invalid ply file %s:%d: %s",filename,line.lineno,e.what()));
+    }
+  } else
+    throw ValueError(format("can't stream mesh file '%s', expected a binary .stl or .ply",filename));
+}
+
+static Tuple<Ref<PolygonSoup>,Array<TV>> read_ply(const string& filename, const int threads) {
+  auto data = read_ply_data(filename,threads);
+  if (data.degree) {
+    data.counts = Array<int>(data.vertices.size()/data.degree,uninit);
+    data.counts.fill(data.degree);
+  }
+  return tuple(new_<PolygonSoup>(data.counts,data.vertices,data.X.size()),data.X);
+}
+
+// Read a ply file as a triangle soup, without copying if all faces are triangles
+static Tuple<Ref<TriangleSoup>,Array<TV>> read_ply_triangles(const string& filename, const int threads) {
+  const auto data = read_ply_data(filename,threads);
+  if (data.degree == 3)
+    return tuple(new_<TriangleSoup>(vector_view_own<3>(data.vertices),data.X.size()),data.X);
+  const auto soup = new_<PolygonSoup>(data.counts,data.vertices,data.X.size());
+  return tuple(soup->triangle_mesh(),data.X);
+}
+
 static void write_ply_helper(File& f, const int nfaces, RawArray<const TV> X) {
   fprintf(f,"ply\n"
             "format binary_little_endian 1.0\n"
@@ -787,26 +1250,26 @@ static Tuple<Ref<PolygonSoup>,Array<TV>> convert(const Tuple<Ref<TriangleSoup>,A
   return tuple(new_<PolygonSoup>(arange(d.x->elements.size()).copy(),scalar_view_own(d.x->elements),d.y.size()),d.y);
 }
 
-Tuple<Ref<TriangleSoup>,Array<TV>> read_soup(const string& filename) {
+Tuple<Ref<TriangleSoup>,Array<TV>> read_soup(const string& filename, const int threads) {
   const auto ext = path::extension(filename);
-  if      (ext == ".stl") return         read_stl(filename);
+  if      (ext == ".stl") return         read_stl(filename,threads);
   else if (ext == ".obj") return convert(read_obj(filename));
-  else if (ext == ".ply") return convert(read_ply(filename));
+  else if (ext == ".ply") return         read_ply_triangles(filename,threads);
   else
     throw ValueError(format("unsupported mesh filename '%s', expected one of .stl, .obj, .ply",filename));
 }
 
-Tuple<Ref<PolygonSoup>,Array<TV>> read_polygon_soup(const string& filename) {
+Tuple<Ref<PolygonSoup>,Array<TV>> read_polygon_soup(const string& filename, const int threads) {
   const auto ext = path::extension(filename);
-  if      (ext == ".stl") return convert(read_stl(filename));
+  if      (ext == ".stl") return convert(read_stl(filename,threads));
   else if (ext == ".obj") return         read_obj(filename);
-  else if (ext == ".ply") return         read_ply(filename);
+  else if (ext == ".ply") return         read_ply(filename,threads);
   else
     throw ValueError(format("unsupported mesh filename '%s', expected one of .stl, .obj, .ply",filename));
 }
 
-Tuple<Ref<TriangleTopology>,Array<TV>> read_mesh(const string& filename) {
-  const auto soup = read_soup(filename);
+Tuple<Ref<TriangleTopology>,Array<TV>> read_mesh(const string& filename, const int threads) {
+  const auto soup = read_soup(filename,threads);
   return tuple(new_<TriangleTopology>(soup.x),soup.y);
 }
 
@@ -860,8 +1323,8 @@ static void write_mesh_py(const string& filename, PyObject* mesh, RawArray<const
 using namespace geode;
 
 void wrap_mesh_io() {
-  GEODE_FUNCTION(read_soup)
-  GEODE_FUNCTION(read_polygon_soup)
-  GEODE_FUNCTION(read_mesh)
+  GEODE_NOGIL_FUNCTION_2(read_soup_py,read_soup)
+  GEODE_NOGIL_FUNCTION_2(read_polygon_soup_py,read_polygon_soup)
+  GEODE_NOGIL_FUNCTION_2(read_mesh_py,read_mesh)
   GEODE_FUNCTION_2(write_mesh,write_mesh_py)
 }
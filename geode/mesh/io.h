@@ -3,14 +3,22 @@
 
 #include <geode/mesh/TriangleSoup.h>
 #include <geode/mesh/TriangleTopology.h>
+#include <geode/utility/function.h>
 namespace geode {
 
-// Read a mesh format as triangle or polygon soup
-GEODE_EXPORT Tuple<Ref<TriangleSoup>,Array<Vector<real,3>>> read_soup(const string& filename);
-GEODE_EXPORT Tuple<Ref<PolygonSoup>,Array<Vector<real,3>>> read_polygon_soup(const string& filename);
+// Read a mesh format as triangle or polygon soup.  Binary .stl and .ply files are memory mapped and parsed
+// with the given number of threads; the result does not depend on threads.
+GEODE_EXPORT Tuple<Ref<TriangleSoup>,Array<Vector<real,3>>> read_soup(const string& filename, const int threads=1);
+GEODE_EXPORT Tuple<Ref<PolygonSoup>,Array<Vector<real,3>>> read_polygon_soup(const string& filename, const int threads=1);
 
 // Read a mesh format and convert to a manifold mesh.  If the mesh is not manifold, an exception is thrown.
-GEODE_EXPORT Tuple<Ref<TriangleTopology>,Array<Vector<real,3>>> read_mesh(const string& filename);
+GEODE_EXPORT Tuple<Ref<TriangleTopology>,Array<Vector<real,3>>> read_mesh(const string& filename, const int threads=1);
+
+// Visit the triangles of a binary .stl or .ply file in order, as corner positions, in batches of about the given
+// size.  Polygons are fanned into triangles.  The file is memory mapped and walked once, so the whole mesh is never
+// held in memory.
+GEODE_EXPORT void stream_triangles(const string& filename, const int batch,
+                                   const function<void(RawArray<const Vector<Vector<real,3>,3>>)>& visit);
 
 // Write a mesh to a file
 GEODE_EXPORT void write_mesh(const string& filename, const TriangleSoup& soup, RawArray<const Vector<real,3>> X);
@@ -15,5 +15,6 @@ void wrap_mesh() {
   GEODE_WRAP(mesh_io)
   GEODE_WRAP(lower_hull)
   GEODE_WRAP(decimate)
+  GEODE_WRAP(streaming_decimate)
   GEODE_WRAP(improve_mesh)
 }
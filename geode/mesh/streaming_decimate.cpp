@@ -0,0 +1,196 @@
+// Out of core quadric decimation
+
+#include <geode/mesh/streaming_decimate.h>
+#include <geode/mesh/decimate.h>
+#include <geode/mesh/io.h>
+#include <geode/geometry/Box.h>
+#include <geode/python/wrap.h>
+#include <geode/structure/Hashtable.h>
+#include <errno.h>
+namespace geode {
+
+typedef real T;
+typedef Vector<T,3> TV;
+typedef Vector<TV,3> Tri;
+typedef function<void(RawArray<const Tri>)> Visit;
+typedef function<void(const Visit&)> Source; // Calls visit on successive batches of triangles
+
+static const int batch = 1<<16;
+static const double bytes_per_triangle = 256;
+
+namespace {
+// An anonymous temporary file of triangles, deleted when closed
+struct TriangleFile : public Noncopyable {
+  FILE* const f;
+  int count;
+  Box<TV> box;
+  Array<Tri> buffer;
+
+  TriangleFile()
+    : f(tmpfile())
+    , count(0)
+    , box(Box<TV>::empty_box()) {
+    if (!f)
+      throw IOError(format("streaming_decimate: can't create temporary file: %s",strerror(errno)));
+  }
+
+  ~TriangleFile() {
+    fclose(f);
+  }
+
+  void append(const Tri& tri) {
+    buffer.append(tri);
+    for (const auto& x : tri)
+      box.enlarge(x);
+    count++;
+    if (buffer.size()==batch)
+      flush();
+  }
+
+  void flush() {
+    if (buffer.size() && fwrite(buffer.data(),sizeof(Tri),buffer.size(),f)!=size_t(buffer.size()))
+      throw IOError(format("streaming_decimate: failed to write temporary file: %s",strerror(errno)));
+    buffer.clear();
+  }
+
+  void read(const Visit& visit) {
+    flush();
+    rewind(f);
+    Array<Tri> tris(min(count,batch),uninit);
+    for (int done=0;done<count;) {
+      const int n = min(batch,count-done);
+      if (fread(tris.data(),sizeof(Tri),n,f)!=size_t(n))
+        throw IOError("streaming_decimate: failed to read temporary file");
+      visit(tris.slice(0,n));
+      done += n;
+    }
+  }
+};
+
+struct StreamingDecimate {
+  const T distance, max_angle, boundary_distance;
+  const int max_cluster, threads;
+  Hashtable<TV> locked; // Corners of triangles straddling a split
+  int clusters; // Number of clusters decimated so far
+
+  // The stitched clusters
+  Hashtable<TV,int> ids;
+  Array<Vector<int,3>> tris;
+  Array<TV> X;
+
+  StreamingDecimate(const T distance, const T max_angle, const T boundary_distance, const int max_cluster,
+                    const int threads)
+    : distance(distance), max_angle(max_angle), boundary_distance(boundary_distance)
+    , max_cluster(max_cluster), threads(threads), clusters(0) {}
+
+  // Add a triangle to a soup, welding identical positions and dropping degenerate triangles
+  static void weld(Hashtable<TV,int>& ids, Array<Vector<int,3>>& tris, Array<TV>& X, const Tri& t) {
+    if (t[0]==t[1] || t[1]==t[2] || t[2]==t[0])
+      return;
+    Vector<int,3> tri;
+    for (int i=0;i<3;i++) {
+      tri[i] = ids.get_or_insert(t[i],X.size());
+      if (tri[i]==X.size())
+        X.append(t[i]);
+    }
+    tris.append(tri);
+  }
+
+  void process(const Source& source, const int count, const Box<TV>& box) {
+    if (count > max_cluster) {
+      // Split at the midplane of the longest axis
+      const int axis = box.sizes().argmax();
+      const T mid = box.center()[axis];
+      TriangleFile lo, hi;
+      source([&](RawArray<const Tri> batch) {
+        for (const auto& t : batch) {
+          const bool low = t[0][axis]+t[1][axis]+t[2][axis] < 3*mid;
+          (low ? lo : hi).append(t);
+          if (   (t[0][axis]<mid) != low
+              || (t[1][axis]<mid) != low
+              || (t[2][axis]<mid) != low)
+            for (const auto& x : t)
+              locked.set(x);
+        }
+      });
+      if (lo.count && hi.count) {
+        for (TriangleFile* file : {&lo,&hi}) {
+          file->flush();
+          process([=](const Visit& visit) { file->read(visit); },file->count,file->box);
+        }
+        return;
+      }
+      // All centroids coincide, so the cluster can't be split further
+    }
+    cluster(source);
+  }
+
+  // Decimate one cluster in memory, keeping locked vertices, and add it to the stitched result
+  void cluster(const Source& source) {
+    clusters++;
+    Hashtable<TV,int> ids;
+    Array<Vector<int,3>> tris;
+    Array<TV> X;
+    source([&](RawArray<const Tri> batch) {
+      for (const auto& t : batch)
+        weld(ids,tris,X,t);
+    });
+    ids.clean_memory();
+    const auto mesh = new_<MutableTriangleTopology>(tris,X.size());
+    tris.clean_memory();
+    Field<bool,VertexId> lock(X.size(),uninit);
+    for (const int v : range(X.size()))
+      lock.flat[v] = locked.contains(X[v]);
+    decimate_locked_inplace(mesh,RawField<const TV,VertexId>(X),lock,distance,max_angle,-1,boundary_distance,threads);
+    for (const auto f : mesh->faces()) {
+      const auto v = mesh->vertices(f);
+      weld(this->ids,this->tris,this->X,Tri(X[v.x.idx()],X[v.y.idx()],X[v.z.idx()]));
+    }
+  }
+};
+}
+
+// Also returns the number of clusters, so that tests can check that splitting happened
+static Tuple<Ref<const TriangleTopology>,Field<const TV,VertexId>,int>
+streaming_decimate_test(const string& filename, const T distance, const T max_angle, const T boundary_distance,
+                        const double memory_limit, const int threads) {
+  GEODE_ASSERT(memory_limit > 0);
+
+  // Count and bound the triangles
+  int count = 0;
+  auto box = Box<TV>::empty_box();
+  stream_triangles(filename,batch,[&](RawArray<const Tri> tris) {
+    count += tris.size();
+    for (const auto& t : tris)
+      for (const auto& x : t)
+        box.enlarge(x);
+  });
+
+  // Decimate clusters and stitch them together
+  StreamingDecimate S(distance,max_angle,boundary_distance,
+                      int(max(1024.,min(memory_limit/bytes_per_triangle,double(1<<30)))),threads);
+  S.process([&](const Visit& visit) { stream_triangles(filename,batch,visit); },count,box);
+  S.ids.clean_memory();
+  S.locked.clean_memory();
+
+  // The seam vertices stay where they are.  Collapsing them in a second pass would measure the error against the
+  // already decimated clusters rather than the original surface, compounding it past distance.
+  const auto mesh = new_<const TriangleTopology>(S.tris,S.X.size());
+  S.tris.clean_memory();
+  return tuple(mesh,Field<const TV,VertexId>(S.X),S.clusters);
+}
+
+Tuple<Ref<const TriangleTopology>,Field<const TV,VertexId>>
+streaming_decimate(const string& filename, const T distance, const T max_angle, const T boundary_distance,
+                   const double memory_limit, const int threads) {
+  const auto result = streaming_decimate_test(filename,distance,max_angle,boundary_distance,memory_limit,threads);
+  return tuple(result.x,result.y);
+}
+
+}
+using namespace geode;
+
+void wrap_streaming_decimate() {
+  GEODE_NOGIL_FUNCTION(streaming_decimate)
+  GEODE_FUNCTION(streaming_decimate_test)
+}
@@ -0,0 +1,26 @@
+// Out of core quadric decimation for meshes too large to fit in memory
+#pragma once
+
+#include <geode/mesh/TriangleTopology.h>
+namespace geode {
+
+// Decimate the binary .stl or .ply mesh in filename without loading all of it at once.
+//
+// The triangles are split recursively at the midplane of their bounding box (by centroid) into temporary files
+// until each cluster fits in memory_limit bytes, assuming roughly 256 bytes per triangle while decimating.  The
+// corners of triangles that straddle a split are locked.  Every vertex shared between clusters is one of
+// these, so each cluster can be decimated independently with decimate_locked_inplace.  The clusters are then
+// stitched by welding identical positions.  The seam vertices are never collapsed, so the result is denser along
+// the splits than decimate would be, but no part of the surface is decimated twice.
+//
+// Only one cluster is in memory at a time, but the stitched result must fit in memory.  Vertices are identified
+// by position, as in read_soup for .stl files, and the mesh must be manifold.
+GEODE_CORE_EXPORT Tuple<Ref<const TriangleTopology>,Field<const Vector<real,3>,VertexId>>
+streaming_decimate(const string& filename,
+                   const real distance,             // (Very) approximate distance between original and decimation
+                   const real max_angle=pi/2,       // Max normal angle change in radians for one decimation step
+                   const real boundary_distance=0,  // How far we're allowed to move the boundary
+                   const double memory_limit=1<<30, // Approximate bound in bytes on the memory used per cluster
+                   const int threads=1);
+
+}
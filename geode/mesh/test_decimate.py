@@ -24,17 +24,51 @@ def test_decimate():
     mesh,X = loop_subdivide(mesh,X,steps=steps)
     mesh = TriangleTopology(mesh)
     def test(distance,boundary_distance=0):
-      md,Xd = decimate(mesh,X,distance=distance,boundary_distance=boundary_distance)
-      H = hausdorff((mesh,X),(md,Xd))
-      Hb = hausdorff((mesh,X),(md,Xd),boundary=1)
-      print('distance %g, boundary %g, H %g, Hb %g'%(distance,boundary_distance,H,Hb))
-      assert H<=distance
-      assert Hb<=boundary_distance
+      parallel = []
+      for threads in 1,2,3:
+        md,Xd = decimate(mesh,X,distance=distance,boundary_distance=boundary_distance,threads=threads)
+        H = hausdorff((mesh,X),(md,Xd))
+        Hb = hausdorff((mesh,X),(md,Xd),boundary=1)
+        print('distance %g, boundary %g, threads %d, H %g, Hb %g'%(distance,boundary_distance,threads,H,Hb))
+        assert H<=distance
+        assert Hb<=boundary_distance
+        if threads>1:
+          parallel.append((md.elements(),Xd))
+      # Parallel batches give the same mesh for any thread count above one
+      (e2,X2),(e3,X3) = parallel
+      assert all(e2==e3) and all(X2==X3)
     test(distance=.01)
     test(distance=.05,boundary_distance=.02)
     test(distance=3,boundary_distance=.1)
     test(distance=inf,boundary_distance=inf)
 
+def test_streaming_decimate():
+  mesh = TriangleSoup([(0,1,2),(0,2,3),(0,3,1)])
+  _,X = tetrahedron_mesh()
+  # 3072 faces, so that the small memory limit (at least 1024 faces per cluster) forces splits
+  mesh,X = loop_subdivide(mesh,X,steps=5)
+  mesh = TriangleTopology(mesh)
+  for ext in '.stl','.ply':
+    f = named_tmpfile(suffix=ext)
+    write_mesh(f.name,mesh,X)
+    # Compare against the mesh as stored, since both formats round positions to float
+    stored = read_mesh(f.name)
+    for distance,boundary_distance in (.003,0),(.006,.003):
+      faces = {}
+      for memory_limit in 2**30,256*200: # One cluster, or many
+        md,Xd,clusters = streaming_decimate_test(f.name,distance,pi/2,boundary_distance,memory_limit,1)
+        H = hausdorff(stored,(md,Xd))
+        Hb = hausdorff(stored,(md,Xd),boundary=1)
+        print('%s, memory %d, clusters %d, distance %g, boundary %g, faces %d, H %g, Hb %g'
+              %(ext,memory_limit,clusters,distance,boundary_distance,md.n_faces,H,Hb))
+        assert (clusters==1)==(memory_limit==2**30)
+        assert md.n_faces<mesh.n_faces
+        assert H<=distance
+        assert Hb<=boundary_distance
+        faces[memory_limit] = md.n_faces
+      # The seam vertices are never collapsed, so splitting keeps more faces
+      assert faces[2**30]<faces[256*200]
+
 def test_simplify():
   for steps in 2,3:
     mesh = TriangleSoup([(0,1,2),(0,2,3),(0,3,1)])
@@ -56,4 +90,5 @@ def test_simplify():
 
 if __name__ == '__main__':
   test_decimate()
+  test_streaming_decimate()
   test_simplify()
@@ -77,14 +77,15 @@ end_header
   for ext in '.stl .obj .ply .x3d'.split():
     f = named_tmpfile(suffix=ext)
     def check_read():
-      soup2,X2 = read_soup(f.name)
-      try:
-        assert all(soup.elements==soup2.elements)
-        assert all(X==X2)
-      except:
-        print('correct:\nX =\n%s\ntris =\n%s'%(X,soup.elements))
-        print('got:\nX =\n%s\ntris =\n%s'%(X2,soup2.elements))
-        raise
+      for threads in 1,3:
+        soup2,X2 = read_soup(f.name,threads=threads)
+        try:
+          assert all(soup.elements==soup2.elements)
+          assert all(X==X2)
+        except:
+          print('correct:\nX =\n%s\ntris =\n%s'%(X,soup.elements))
+          print('got (threads %d):\nX =\n%s\ntris =\n%s'%(threads,X2,soup2.elements))
+          raise
     write_mesh(f.name,soup,X)
     if ext in binary:
       sha1 = hashlib.sha1(open(f.name,'rb').read()).hexdigest()
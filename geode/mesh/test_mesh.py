@@ -106,6 +106,25 @@ def test_neighbors():
   mesh = SegmentSoup([(0,1),(0,2),(0,2)])
   assert all(mesh.neighbors()==[[1,2],[0],[0]])
 
+def test_precompute():
+  tris = sphere_mesh(3)[0].elements
+  for threads in 1,3:
+    lazy,eager = TriangleSoup(tris),TriangleSoup(tris)
+    eager.precompute(-1,threads)
+    assert all(lazy.triangle_edges()==eager.triangle_edges())
+    assert all(lazy.segment_soup().elements==eager.segment_soup().elements)
+    assert all(lazy.adjacent_elements()==eager.adjacent_elements())
+    assert all(lazy.bending_tuples()==eager.bending_tuples())
+    for a,b in (lazy.incident_elements(),eager.incident_elements()),(lazy.sorted_neighbors(),eager.sorted_neighbors()):
+      assert all(a.offsets==b.offsets) and all(a.flat==b.flat)
+    segs = lazy.segment_soup().elements
+    lazy,eager = SegmentSoup(segs),SegmentSoup(segs)
+    eager.precompute(-1,threads)
+    assert all(lazy.adjacent_elements()==eager.adjacent_elements())
+    assert all(lazy.bending_tuples()==eager.bending_tuples())
+    for a,b in (lazy.incident_elements(),eager.incident_elements()),(lazy.neighbors(),eager.neighbors()):
+      assert all(a.offsets==b.offsets) and all(a.flat==b.flat)
+
 def injection(n):
   while 1:
     map = random.randint(5,5+n*n,n).astype(int32)
@@ -387,6 +387,13 @@ const_field(S T::* field) {
 #define GEODE_METHOD(method_) \
   GEODE_METHOD_2(#method_,method_)
 
+// Release the GIL while the method runs (see gil.h)
+#define GEODE_NOGIL_METHOD_2(name,method_) \
+  method(name,nogil(&Self::method_))
+
+#define GEODE_NOGIL_METHOD(method_) \
+  GEODE_NOGIL_METHOD_2(#method_,method_)
+
 #define GEODE_OVERLOADED_METHOD_2(type,name,method_) \
   method(name,static_cast<type>(&Self::method_))
 
@@ -0,0 +1,53 @@
+//#####################################################################
+// File gil
+//#####################################################################
+#include <geode/python/gil.h>
+#ifdef GEODE_PYTHON
+#include <atomic>
+namespace geode {
+
+// The state saved by this thread's outermost ReleaseGIL, or null
+static GEODE_THREAD_LOCAL PyThreadState* released_state = 0;
+
+// Number of threads inside a ReleaseGIL scope
+static std::atomic<int> released_count(0);
+
+ReleaseGIL::ReleaseGIL()
+  : saved(0) {
+  if (!released_state) {
+    saved = released_state = PyEval_SaveThread();
+    released_count++;
+  }
+}
+
+ReleaseGIL::~ReleaseGIL() {
+  if (saved) {
+    released_count--;
+    released_state = 0;
+    PyEval_RestoreThread(saved);
+  }
+}
+
+ReacquireGIL::ReacquireGIL()
+  : saved(released_state) {
+  if (saved) {
+    released_state = 0;
+    PyEval_RestoreThread(saved);
+  }
+}
+
+ReacquireGIL::~ReacquireGIL() {
+  if (saved)
+    released_state = PyEval_SaveThread();
+}
+
+bool released_gil() {
+  return released_state!=0;
+}
+
+bool any_released_gil() {
+  return released_count.load()!=0;
+}
+
+}
+#endif
@@ -0,0 +1,90 @@
+//#####################################################################
+// File gil
+//#####################################################################
+//
+// Release of the python global interpreter lock around long running C++ code.
+//
+// Functions and methods registered with GEODE_NOGIL_FUNCTION or GEODE_NOGIL_METHOD convert their arguments with the
+// GIL held, release it for the duration of the C++ call, and reacquire it to convert the result.  Other python threads
+// run in the meantime, so the wrapped code must not touch python state: no callbacks into python, and no python
+// objects other than the arguments, which the caller keeps alive.  Interrupts still work: check_interrupts briefly
+// reacquires the GIL on the releasing thread to check for signals.  OpenMP worker threads skip the python check while
+// the GIL is released, so within a parallel region an interrupt is noticed once the releasing thread (thread 0) checks.
+//
+// Without variadic templates, the marker is accepted but ignored, and the GIL stays held.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/python/config.h>
+#include <geode/utility/config.h>
+#include <geode/utility/forward.h>
+namespace geode {
+
+// Marks a function or method pointer for wrapping without the GIL
+template<class F> struct NoGIL {
+  F f;
+};
+
+template<class F> static inline NoGIL<F> nogil(F f) {
+  NoGIL<F> n = {f};
+  return n;
+}
+
+#ifdef GEODE_PYTHON
+
+// Release the GIL for the lifetime of the object.  Does nothing if this thread has already released it.
+class ReleaseGIL {
+  PyThreadState* saved;
+public:
+  GEODE_CORE_EXPORT ReleaseGIL();
+  GEODE_CORE_EXPORT ~ReleaseGIL();
+private:
+  ReleaseGIL(const ReleaseGIL&);
+  void operator=(const ReleaseGIL&);
+};
+
+// If this thread released the GIL via ReleaseGIL, reacquire it for the lifetime of the object.  Otherwise do nothing.
+class ReacquireGIL {
+  PyThreadState* saved;
+public:
+  GEODE_CORE_EXPORT ReacquireGIL();
+  GEODE_CORE_EXPORT ~ReacquireGIL();
+private:
+  ReacquireGIL(const ReacquireGIL&);
+  void operator=(const ReacquireGIL&);
+};
+
+// Has this thread released the GIL via ReleaseGIL?
+GEODE_CORE_EXPORT bool released_gil();
+
+// Is any thread inside a ReleaseGIL scope?
+GEODE_CORE_EXPORT bool any_released_gil();
+
+#ifdef GEODE_VARIADIC
+// Call a function or method with the GIL released.  The arguments are converted from python by the caller, which
+// keeps them alive until after the GIL is reacquired, and they are passed as lvalues.  Parameters taken by value are
+// therefore copies which only adjust reference counts: any python object owned by an argument (such as a numpy array
+// created from a list) is freed with the GIL held.  The result is constructed before the GIL is reacquired.
+template<class R,class... Params,class... Args> static inline R
+call_nogil(R (*f)(Params...), Args&... args) {
+  ReleaseGIL release;
+  return f(args...);
+}
+
+template<class R,class T,class B,class... Params,class... Args> static inline R
+call_nogil(T* self, R (B::*method)(Params...), Args&... args) {
+  ReleaseGIL release;
+  return (self->*method)(args...);
+}
+
+template<class R,class T,class B,class... Params,class... Args> static inline R
+call_nogil(T* self, R (B::*method)(Params...) const, Args&... args) {
+  ReleaseGIL release;
+  return (self->*method)(args...);
+}
+#endif
+
+#endif
+
+}
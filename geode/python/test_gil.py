@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+
+from __future__ import division
+from geode import *
+from geode.geometry.platonic import *
+import threading
+import time
+
+class Counter(threading.Thread):
+  '''Records the time of each iteration until stopped'''
+  def __init__(self):
+    threading.Thread.__init__(self)
+    self.daemon = True
+    self.stop = False
+    self.stamps = []
+  def run(self):
+    while not self.stop:
+      self.stamps.append(time.time())
+
+def run_with_counter(f):
+  counter = Counter()
+  counter.start()
+  while not counter.stamps:
+    time.sleep(.001)
+  try:
+    start = time.time()
+    result = f()
+    end = time.time()
+  finally:
+    counter.stop = True
+    counter.join()
+  return result,start,end,counter.stamps
+
+def test_release():
+  mesh,X = sphere_mesh(5)
+  mesh = TriangleTopology(mesh)
+  (md,Xd),start,end,stamps = run_with_counter(lambda:decimate(mesh,X,distance=.01))
+  assert md.n_faces<mesh.n_faces
+  # With the GIL held, the counter could only run briefly before the call started.  With it released, the counter
+  # keeps running through the middle of the call.
+  middle = (start+end)/2
+  print 'call %g s, %d stamps near the middle'%(end-start,sum(abs(s-middle)<(end-start)/4 for s in stamps))
+  assert any(abs(s-middle)<(end-start)/4 for s in stamps)
+
+def test_exception():
+  def f():
+    # Exceptions are converted with the GIL held, so python code runs normally afterwards
+    messages = []
+    for name,error in ('/nonexistent/geode-test-gil.stl',IOError),('geode-test-gil.xyz',ValueError):
+      try:
+        read_mesh(name)
+        assert False
+      except error as e:
+        messages.append(str(e))
+    return messages
+  messages,_,_,stamps = run_with_counter(f)
+  assert "can't open" in messages[0]
+  assert 'unsupported mesh filename' in messages[1]
+  assert stamps
+
+def test_list_arguments():
+  # A list is converted to a fresh numpy array owned only by the converted C++ argument, which must outlive the
+  # call so that the array is freed with the GIL held.  Run from several threads at once, as in a thread pool.
+  image = [[[.25,.5,1]]*5]*4
+  expected = array(image)**(1/2)
+  failures = []
+  def work():
+    try:
+      for _ in xrange(200):
+        assert allclose(Image.gamma_compress(image,2),expected)
+    except Exception as e:
+      failures.append(e)
+  threads = [threading.Thread(target=work) for _ in xrange(3)]
+  for t in threads:
+    t.start()
+  work()
+  for t in threads:
+    t.join()
+  assert not failures
+
+if __name__=='__main__':
+  test_release()
+  test_exception()
+  test_list_arguments()
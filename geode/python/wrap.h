@@ -2,6 +2,7 @@
 #pragma once
 
 #include <geode/python/config.h>
+#include <geode/python/gil.h>
 #include <geode/utility/config.h>
 #ifdef GEODE_PYTHON
 #include <geode/python/wrap_function.h>
@@ -31,10 +32,17 @@ template<class Function> static inline void function(const char* name, Function
 #define GEODE_FUNCTION(name) ::geode::python::function(#name,name);
 #define GEODE_FUNCTION_2(name,...) ::geode::python::function(#name,__VA_ARGS__);
 
+
 #define GEODE_OVERLOADED_FUNCTION_2(type,name,function_) ::geode::python::function(name,(type)function_);
 
 #define GEODE_OVERLOADED_FUNCTION(type,function_) GEODE_OVERLOADED_FUNCTION_2(type,#function_,function_);
 
+// As above, but release the GIL while the function runs (see gil.h)
+#define GEODE_NOGIL_FUNCTION(name) ::geode::python::function(#name,::geode::nogil(name));
+#define GEODE_NOGIL_FUNCTION_2(name,function_) ::geode::python::function(#name,::geode::nogil(function_));
+#define GEODE_NOGIL_OVERLOADED_FUNCTION_2(type,name,function_) ::geode::python::function(name,::geode::nogil((type)function_));
+#define GEODE_NOGIL_OVERLOADED_FUNCTION(type,function_) GEODE_NOGIL_OVERLOADED_FUNCTION_2(type,#function_,function_);
+
 #ifndef GEODE_WRAP
 #ifdef GEODE_PYTHON
 #define GEODE_WRAP(name) extern void wrap_##name();wrap_##name();
@@ -7,6 +7,8 @@
 // In order to convert a function of type R(...,Ai,...), there must be from_python overloads converting PyObject* to Ai,
 // and a to_python function converting R to PyObject*.  See to_python.h and from_python.h for details.
 //
+// Functions marked with nogil() (see gil.h) release the GIL while the C++ function runs.
+//
 // note: function_inner_wrapper unfortunately can't be declared static because gcc disallows static functions as template
 // arguments.  Putting it in an unnamed namespace clutters up the stack traces, so we rely on hidden visibility.
 //
@@ -15,10 +17,12 @@
 
 #include <geode/python/config.h>
 #include <geode/python/exceptions.h>
+#include <geode/python/gil.h>
 #include <geode/python/outer_wrapper.h>
 #include <geode/python/utility.h>
 #include <geode/utility/config.h>
 #include <geode/utility/enumerate.h>
+#include <tuple>
 namespace geode {
 
 typedef PyObject* (*FunctionWrapper)(PyObject* args,void* wrapped);
@@ -35,15 +39,35 @@ function_inner_wrapper(PyObject* args,void* wrapped) {
   return ((F)wrapped)(convert_item<Args>(args)...);
 }
 
+// Same as function_inner_wrapper, but releases the GIL once the arguments are converted
+template<class F,class R,class... Args> inline R
+function_inner_wrapper_nogil(PyObject* args,void* wrapped) {
+  Py_ssize_t size = PyTuple_GET_SIZE(args);
+  const int desired = sizeof...(Args);
+  if (size!=desired) throw_arity_mismatch(desired,size);
+  // The converted arguments outlive the call, so that python objects they own are released with the GIL held
+  std::tuple<decltype(convert_item<Args>(args))...> converted{convert_item<Args>(args)...};
+  return call_nogil((F)wrapped,std::get<Args::index>(converted)...);
+}
+
 template<class F,class R,class... Args> static FunctionWrapper wrapped_function(Types<Args...>) {
   return OuterWrapper<R,PyObject*,void*>::template wrap<function_inner_wrapper<F,R,Args...>>;
 }
 
+template<class F,class R,class... Args> static FunctionWrapper wrapped_function_nogil(Types<Args...>) {
+  return OuterWrapper<R,PyObject*,void*>::template wrap<function_inner_wrapper_nogil<F,R,Args...>>;
+}
+
 template<class R,class... Args> static PyObject*
 wrap_function(const char* name,R (*function)(Args...)) {
   return wrap_function_helper(name,wrapped_function<decltype(function),R>(typename Enumerate<Args...>::type()),(void*)function);
 }
 
+template<class R,class... Args> static PyObject*
+wrap_function(const char* name,NoGIL<R(*)(Args...)> function) {
+  return wrap_function_helper(name,wrapped_function_nogil<R(*)(Args...),R>(typename Enumerate<Args...>::type()),(void*)function.f);
+}
+
 #else // Unpleasant nonvariadic versions
 
 #define GEODE_WRAP_FUNCTION(n,ARGS,Args) \
@@ -77,6 +101,11 @@ GEODE_WRAP_FUNCTION(9,(class A0,class A1,class A2,class A3,class A4,class A5,cla
 #undef GEODE_WRAP_FUNCTION_2
 #undef GEODE_WRAP_FUNCTION
 
+// Without variadic templates, nogil() is ignored
+template<class F> static PyObject* wrap_function(const char* name,NoGIL<F> function) {
+  return wrap_function(name,function.f);
+}
+
 #endif
 
 }
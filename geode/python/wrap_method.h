@@ -7,6 +7,8 @@
 // In order to convert a function of type R(...,Ai,...), there must be From_Python overloads converting PyObject* to Ai,
 // and a to_python function converting R to PyObject*.  See to_python.h and from_python.h for details.
 //
+// Methods marked with nogil() (see gil.h) release the GIL while the C++ method runs.
+//
 // Since python has no notion of constness, there is no difference between the wrapped versions of a method with and
 // without const qualification.
 //
@@ -19,10 +21,12 @@
 #include <geode/python/config.h>
 #include <geode/python/exceptions.h>
 #include <geode/python/from_python.h>
+#include <geode/python/gil.h>
 #include <geode/python/to_python.h>
 #include <geode/python/outer_wrapper.h>
 #include <geode/utility/config.h>
 #include <geode/utility/enumerate.h>
+#include <tuple>
 namespace geode {
 
 GEODE_CORE_EXPORT PyObject* wrap_method_helper(PyTypeObject* type,const char* name,wrapperfunc wrapper,void* method);
@@ -38,16 +42,36 @@ method_inner_wrapper(PyObject* self,PyObject* args,void* method) {
   return (GetSelf<T>::get(self)->*(*(M*)method))(convert_item<Args>(args)...);
 }
 
+// Same as method_inner_wrapper, but releases the GIL once the arguments are converted
+template<class M,class R,class T,class... Args> R
+method_inner_wrapper_nogil(PyObject* self,PyObject* args,void* method) {
+  Py_ssize_t size = PyTuple_GET_SIZE(args);
+  const int desired = sizeof...(Args);
+  if (size!=desired) throw_arity_mismatch(desired,size);
+  // The converted arguments outlive the call, so that python objects they own are released with the GIL held
+  std::tuple<decltype(convert_item<Args>(args))...> converted{convert_item<Args>(args)...};
+  return call_nogil(GetSelf<T>::get(self),*(M*)method,std::get<Args::index>(converted)...);
+}
+
 // wrap_method for static methods
 template<class T,class M,class R,class... Args> static PyObject*
 wrap_method(const char* name,R (*method)(Args...)) {
   return wrap_function(name,method);
 }
 
+template<class T,class M,class R,class... Args> static PyObject*
+wrap_method(const char* name,NoGIL<R(*)(Args...)> method) {
+  return wrap_function(name,method);
+}
+
 template<class T,class M,class R,class... Args> static wrapperfunc wrapped_method(Types<Args...>) {
   return OuterWrapper<R,PyObject*,PyObject*,void*>::template wrap<method_inner_wrapper<M,R,T,Args...> >;
 }
 
+template<class T,class M,class R,class... Args> static wrapperfunc wrapped_method_nogil(Types<Args...>) {
+  return OuterWrapper<R,PyObject*,PyObject*,void*>::template wrap<method_inner_wrapper_nogil<M,R,T,Args...> >;
+}
+
 // wrap_method for nonconst methods
 template<class T,class M,class R,class B,class... Args> static PyObject*
 wrap_method(const char* name,R (B::*method)(Args...)) {
@@ -60,6 +84,20 @@ wrap_method(const char* name,R (B::*method)(Args...) const) {
   return wrap_method_helper(&T::pytype,name,wrapped_method<T,M,R>(typename Enumerate<Args...>::type()),(void*)new M(method));
 }
 
+// wrap_method for nonconst methods without the GIL
+template<class T,class M,class R,class B,class... Args> static PyObject*
+wrap_method(const char* name,NoGIL<R (B::*)(Args...)> method) {
+  typedef R (B::*P)(Args...);
+  return wrap_method_helper(&T::pytype,name,wrapped_method_nogil<T,P,R>(typename Enumerate<Args...>::type()),(void*)new P(method.f));
+}
+
+// wrap_method for const methods without the GIL
+template<class T,class M,class R,class B,class... Args> static PyObject*
+wrap_method(const char* name,NoGIL<R (B::*)(Args...) const> method) {
+  typedef R (B::*P)(Args...) const;
+  return wrap_method_helper(&T::pytype,name,wrapped_method_nogil<T,P,R>(typename Enumerate<Args...>::type()),(void*)new P(method.f));
+}
+
 #else // Unpleasant nonvariadic versions
 
 #define GEODE_WRAP_METHOD(n,ARGS,Args) \
@@ -118,6 +156,11 @@ GEODE_WRAP_METHOD(8,(class A0,class A1,class A2,class A3,class A4,class A5,class
 #undef GEODE_WRAP_METHOD_2
 #undef GEODE_WRAP_METHOD
 
+// Without variadic templates, nogil() is ignored
+template<class T,class Self,class F> static PyObject* wrap_method(const char* name,NoGIL<F> method) {
+  return wrap_method<T,Self>(name,(typename DerivedMethod<Self,F>::type)method.f);
+}
+
 #endif
 
 }
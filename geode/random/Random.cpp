@@ -2,10 +2,14 @@
 // Class Random
 //#####################################################################
 #include <geode/random/Random.h>
+#include <geode/array/Array2d.h>
 #include <geode/python/Class.h>
 #include <geode/vector/Frame.h>
 #include <geode/vector/Rotation.h>
 #include <geode/python/stl.h>
+#include <geode/math/constants.h>
+#include <geode/utility/format.h>
+#include <geode/utility/openmp.h>
 namespace geode {
 
 GEODE_DEFINE_TYPE(Random)
@@ -83,6 +87,93 @@ real Random::normal() {
   }
 }
 
+// Call body(b,bits) with bits[k] = threefry(seed,counter+b+k), for consecutive pieces of [0,blocks), then advance past them
+template<class Body> void Random::fill_blocks(const int64_t blocks, const int threads, const Body& body) {
+  const int64_t chunk = 1024,
+                chunks = (blocks+chunk-1)/chunk;
+  const int parts = int(min(chunks,int64_t(max(threads,1))));
+  const uint128_t key = seed, start = counter;
+  parallel_for(parts,threads,[&](const int p) {
+    uint128_t bits[chunk];
+    for (const int64_t c : partition_loop(chunks,parts,p)) {
+      const int64_t b = chunk*c;
+      const int n = int(min(chunk,blocks-b));
+      threefry(key,start+uint128_t(uint64_t(b)),RawArray<uint128_t>(n,bits));
+      body(b,RawArray<const uint128_t>(n,bits));
+    }
+  });
+  counter += uint128_t(uint64_t(blocks));
+  free_bit_count = 0;
+}
+
+void Random::fill_uniform(RawArray<real> x, const real a, const real b, const int threads) {
+  assert(a<b);
+  const int width = 8*sizeof(real),
+            per = 128/width;
+  const int64_t n = x.size();
+  const real scale = (b-a)*ldexp(real(1),-width);
+  fill_blocks((n+per-1)/per,threads,[=](const int64_t start, RawArray<const uint128_t> bits) {
+    for (const int k : range(bits.size())) {
+      uint128_t r = bits[k];
+      for (int64_t i=per*(start+k),e=min(i+per,n);i<e;i++) {
+        x[i] = a+scale*cast_uint128<RealBits>(r);
+        r >>= width;
+      }
+    }
+  });
+}
+
+// Uniform in [0,1) from the top 53 bits of a 64 bit integer
+static inline real closed_open(const uint64_t r) {
+  return real(r>>11)*(real(1)/(uint64_t(1)<<53));
+}
+
+// Marsaglia's polar method, with one attempt per block.  Rejected blocks retry with the same counter under
+// rekeyed generators, so each pair of outputs still depends only on its own counter.
+void Random::fill_normal(RawArray<real> x, const int threads) {
+  const int64_t n = x.size();
+  const uint128_t key = seed, start = counter;
+  fill_blocks((n+1)/2,threads,[=](const int64_t b, RawArray<const uint128_t> bits) {
+    for (const int k : range(bits.size())) {
+      uint128_t r = bits[k];
+      for (uint64_t attempt=1;;attempt++) {
+        const real v0 = 2*closed_open(cast_uint128<uint64_t>(r))-1,
+                   v1 = 2*closed_open(cast_uint128<uint64_t>(r>>64))-1,
+                   s = sqr(v0)+sqr(v1);
+        if (s && s<1) {
+          const real scale = sqrt(-2*log(s)/s);
+          const int64_t i = 2*(b+k);
+          x[i] = scale*v0;
+          if (i+1<n)
+            x[i+1] = scale*v1;
+          break;
+        }
+        r = threefry(key^(uint128_t(attempt)<<64),start+uint128_t(uint64_t(b+k)));
+      }
+    }
+  });
+}
+
+static inline Vector<real,2> direction_from_bits(const uint128_t bits, Vector<real,2>*) {
+  const real t = 2*pi*closed_open(cast_uint128<uint64_t>(bits));
+  return Vector<real,2>(cos(t),sin(t));
+}
+
+// Archimedes: z is uniform in [-1,1] for a uniform point on the sphere
+static inline Vector<real,3> direction_from_bits(const uint128_t bits, Vector<real,3>*) {
+  const real z = 2*closed_open(cast_uint128<uint64_t>(bits))-1,
+             t = 2*pi*closed_open(cast_uint128<uint64_t>(bits>>64)),
+             r = sqrt(max(real(0),1-z*z));
+  return Vector<real,3>(r*cos(t),r*sin(t),z);
+}
+
+template<class TV> void Random::fill_direction(RawArray<TV> x, const int threads) {
+  fill_blocks(x.size(),threads,[=](const int64_t start, RawArray<const uint128_t> bits) {
+    for (const int k : range(bits.size()))
+      x[start+k] = direction_from_bits(bits[k],(TV*)0);
+  });
+}
+
 // The result should consist of all (dependent) binomially distributed random values
 static vector<Array<int>> random_bits_test(Random& random, int steps) {
   vector<Array<int>> all;
@@ -125,16 +216,32 @@ static vector<Array<int>> random_bits_test(Random& random, int steps) {
 }
 
 Array<real> Random::normal_py(int size) {
+  return parallel_normal_py(size,1);
+}
+
+Array<real> Random::uniform_py(int size) {
+  return parallel_uniform_py(size,1);
+}
+
+Array<real> Random::parallel_normal_py(int size, int threads) {
   Array<real> result(size,uninit);
-  for (auto& x : result)
-    x = normal();
+  fill_normal(result,threads);
   return result;
 }
 
-Array<real> Random::uniform_py(int size) {
+Array<real> Random::parallel_uniform_py(int size, int threads) {
   Array<real> result(size,uninit);
-  for (auto& x : result)
-    x = uniform();
+  fill_uniform(result.raw(),0,1,threads);
+  return result;
+}
+
+Array<real,2> Random::parallel_direction_py(int size, int d, int threads) {
+  GEODE_ASSERT(d==2 || d==3,format("Random.parallel_direction: expected dimension 2 or 3, got %d",d));
+  Array<real,2> result(size,d,uninit);
+  if (d==2)
+    fill_direction(vector_view<2>(result.flat),threads);
+  else
+    fill_direction(vector_view<3>(result.flat),threads);
   return result;
 }
 
@@ -164,7 +271,8 @@ template<class TV> Frame<TV> Random::frame(const TV& v0,const TV& v1) {
 
 #define INSTANTIATE(d) \
   template GEODE_CORE_EXPORT Rotation<Vector<real,d>> Random::rotation(); \
-  template GEODE_CORE_EXPORT Frame<Vector<real,d>> Random::frame(const Vector<real,d>&,const Vector<real,d>&);
+  template GEODE_CORE_EXPORT Frame<Vector<real,d>> Random::frame(const Vector<real,d>&,const Vector<real,d>&); \
+  template GEODE_CORE_EXPORT void Random::fill_direction(RawArray<Vector<real,d>>,const int);
 INSTANTIATE(2)
 INSTANTIATE(3)
 
@@ -178,6 +286,9 @@ void wrap_Random() {
     .GEODE_FIELD(seed)
     .GEODE_METHOD_2("normal",normal_py)
     .GEODE_METHOD_2("uniform",uniform_py)
+    .GEODE_METHOD_2("parallel_normal",parallel_normal_py)
+    .GEODE_METHOD_2("parallel_uniform",parallel_uniform_py)
+    .GEODE_METHOD_2("parallel_direction",parallel_direction_py)
     .GEODE_METHOD_2("uniform_int",uniform_int_py)
     ;
 
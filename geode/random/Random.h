@@ -93,13 +93,26 @@ public:
     return ldexp((real)1,-8*(int)sizeof(real))*bits<RealBits>();
   }
 
+  // Bulk generation.  Each fill discards any buffered bits and draws from a contiguous range of counters, evaluating
+  // threefry on SIMD lanes and splitting the range across threads, so results are independent of thread count.
+  // fill_uniform gives the same values as repeated uniform calls starting from a fresh block.  fill_normal and
+  // fill_direction tie each output to its own counter rather than a sequential stream, so their values differ from
+  // those of normal() and direction().
+  GEODE_CORE_EXPORT void fill_uniform(RawArray<real> x, const real a, const real b, const int threads=1); // in [a,b)
+  GEODE_CORE_EXPORT void fill_normal(RawArray<real> x, const int threads=1);
+  template<class TV> GEODE_CORE_EXPORT void fill_direction(RawArray<TV> x, const int threads=1);
+
   Array<real> normal_py(int size);
   Array<real> uniform_py(int size);
+  Array<real> parallel_normal_py(int size, int threads);
+  Array<real> parallel_uniform_py(int size, int threads);
+  Array<real,2> parallel_direction_py(int size, int d, int threads);
   Array<int> uniform_int_py(int lo, int hi, int size);
   template<class TV> GEODE_CORE_EXPORT Rotation<TV> rotation();
   template<class TV> GEODE_CORE_EXPORT Frame<TV> frame(const TV& v0,const TV& v1);
 private:
   template<class Int, int N> Int n_bits();
+  template<class Body> void fill_blocks(const int64_t blocks, const int threads, const Body& body);
 };
 
 // In [a,b)
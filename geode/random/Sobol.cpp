@@ -4,9 +4,11 @@
 // See Bratley and Fox. 1988. Algorithm 659: Implementing Sobol's quasirandom sequence generator. Acm Trans. Math. Softw. 14, 88-100.
 //#####################################################################
 #include <geode/random/Sobol.h>
+#include <geode/random/counter.h>
 #include <geode/geometry/Box.h>
 #include <geode/math/integer_log.h>
 #include <geode/python/Class.h>
+#include <geode/utility/openmp.h>
 namespace geode {
 
 typedef real T;
@@ -33,16 +35,94 @@ template<> GEODE_UNUSED const Helper<double>::TI Helper<double>::vs[4][53] = {
 template<class TV> Sobol<TV>::Sobol(const Box<TV>& box)
   : offset(box.min)
   , scales(box.sizes()/(T)((TI)1<<max_bits))
-  , n(0) {}
+  , n(0)
+  , scrambled(false) {}
 
 template<class TV> Sobol<TV>::~Sobol() {}
 
+static inline uint64_t reverse_bits(uint64_t v) {
+  v = ((v>> 1)&0x5555555555555555)|((v&0x5555555555555555)<< 1);
+  v = ((v>> 2)&0x3333333333333333)|((v&0x3333333333333333)<< 2);
+  v = ((v>> 4)&0x0f0f0f0f0f0f0f0f)|((v&0x0f0f0f0f0f0f0f0f)<< 4);
+  v = ((v>> 8)&0x00ff00ff00ff00ff)|((v&0x00ff00ff00ff00ff)<< 8);
+  v = ((v>>16)&0x0000ffff0000ffff)|((v&0x0000ffff0000ffff)<<16);
+  return (v>>32)|(v<<32);
+}
+
+// Nested uniform scramble of the top bits digits of x.  With the digits reversed, each step changes a bit based only
+// on the bits below it, so each output digit is a (seeded) function of the digits above it in x.
+template<class TI> static inline TI owen_scramble(const TI x, const uint64_t seed, const int bits) {
+  uint64_t v = reverse_bits(uint64_t(x)<<(64-bits));
+  v ^= v*0x9e3779b97f4a7c16;
+  v += seed;
+  v *= (seed>>32)|1;
+  v ^= v*0xbf58476d1ce4e5b8;
+  v ^= v*0x94d049bb133111ea;
+  return TI(reverse_bits(v)>>(64-bits));
+}
+
+template<class TV> TV Sobol<TV>::output(const Vector<TI,d>& x) const {
+  if (!scrambled)
+    return offset+scales*TV(x);
+  Vector<TI,d> y;
+  for (int i=0;i<d;i++)
+    y[i] = owen_scramble(x[i],seeds[i],max_bits);
+  return offset+scales*TV(y);
+}
+
 template<class TV> TV Sobol<TV>::vector() {
   const int bit = integer_log_exact(min_bit(~n++));
   GEODE_ASSERT(bit<max_bits,"Ran out of bits (floating point precision has been exhausted)");
   for (int i=0;i<d;i++)
     x[i] ^= Helper<T>::vs[i][bit];
-  return offset+scales*TV(x);
+  return output(x);
+}
+
+// After index steps, x is the xor of the direction numbers selected by the Gray code of index
+template<class TV> auto Sobol<TV>::point(const TI index) const -> Vector<TI,d> {
+  Vector<TI,d> x;
+  TI gray = index^(index>>1);
+  for (int bit=0;gray;bit++,gray>>=1)
+    if (gray&1) {
+      GEODE_ASSERT(bit<max_bits,"Ran out of bits (floating point precision has been exhausted)");
+      for (int i=0;i<d;i++)
+        x[i] ^= Helper<T>::vs[i][bit];
+    }
+  return x;
+}
+
+template<class TV> void Sobol<TV>::seek(const TI index) {
+  x = point(index);
+  n = index;
+}
+
+template<class TV> Array<TV> Sobol<TV>::vectors(const int count, const int threads) {
+  GEODE_ASSERT(count>=0);
+  // Every step must fit in max_bits, as checked one at a time in vector()
+  GEODE_ASSERT(TI(n+count)>=n && n+count<=((TI)1<<max_bits)-1,
+               "Ran out of bits (floating point precision has been exhausted)");
+  Array<TV> result(count,uninit);
+  #pragma omp parallel num_threads(max(threads,1))
+  {
+    const auto range = partition_loop(count);
+    if (range.size()) {
+      auto y = point(n+range.lo);
+      for (const int k : range) {
+        const int bit = integer_log_exact(min_bit(TI(~(n+k))));
+        for (int i=0;i<d;i++)
+          y[i] ^= Helper<T>::vs[i][bit];
+        result[k] = output(y);
+      }
+    }
+  }
+  seek(n+count);
+  return result;
+}
+
+template<class TV> void Sobol<TV>::scramble(const uint128_t key) {
+  scrambled = true;
+  for (int i=0;i<d;i++)
+    seeds[i] = cast_uint128<uint64_t>(threefry(key,i));
 }
 
 #define INSTANTIATE(d) \
@@ -63,6 +143,9 @@ template<int d> static void wrap_helper() {
   Class<Self>(name)
     .GEODE_INIT(Box<Vector<T,d>>)
     .GEODE_METHOD(vector)
+    .GEODE_METHOD(seek)
+    .GEODE_METHOD(vectors)
+    .GEODE_METHOD(scramble)
     ;
 }
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <geode/random/forward.h>
+#include <geode/math/uint128.h>
 #include <geode/array/Array.h>
 #include <geode/python/Object.h>
 #include <geode/vector/Vector.h>
@@ -27,12 +28,30 @@ private:
   const TV offset, scales;
   Vector<TI,d> x; // Last result
   TI n;
+  bool scrambled;
+  Vector<uint64_t,d> seeds; // Per dimension Owen scrambling seeds
 private:
   GEODE_CORE_EXPORT Sobol(const Box<TV>& box);
 public:
   ~Sobol();
 
   GEODE_CORE_EXPORT TV vector();
+
+  // Skip ahead (or back) so that the next call to vector() returns point index (zero based).  Uses the Gray code
+  // closed form, so the cost is independent of the distance.
+  GEODE_CORE_EXPORT void seek(const TI index);
+
+  // The next count points, identical to count calls to vector().  Index ranges are split across threads, each
+  // starting from the closed form, so the result is independent of thread count.
+  GEODE_CORE_EXPORT Array<TV> vectors(const int count, const int threads=1);
+
+  // Owen scramble all future points, using per dimension seeds from threefry(key,i).  The scramble is the hash
+  // based nested uniform permutation of Laine and Karras, as refined by Burley (2020), applied to all max_bits bits.
+  GEODE_CORE_EXPORT void scramble(const uint128_t key);
+
+private:
+  Vector<TI,d> point(const TI index) const; // Value of x after index steps
+  TV output(const Vector<TI,d>& x) const;
 };
 
 }
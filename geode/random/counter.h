@@ -5,9 +5,13 @@
 
 #include <geode/random/forward.h>
 #include <geode/math/uint128.h>
+#include <geode/array/RawArray.h>
 namespace geode {
 
 // Note that we put key first to match currying, unlike Salmon et al.
 GEODE_CORE_EXPORT uint128_t threefry(uint128_t key, uint128_t ctr) GEODE_CONST;
 
+// Batched version: results[i] = threefry(key,ctr+i).  Uses SIMD lanes if available.
+GEODE_CORE_EXPORT void threefry(uint128_t key, uint128_t ctr, RawArray<uint128_t> results);
+
 }
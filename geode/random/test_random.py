@@ -29,6 +29,24 @@ def test_sobol(filename=None):
   expected = '9b80b2a496d0bf4e5aeb001a87fd64528b712784'
   assert hash==expected
 
+def test_sobol_seek():
+  box = Box((0,-1,2),(1,3,5))
+  sobol = Sobol(box)
+  X = array([sobol.vector() for _ in xrange(1000)])
+  for threads in 1,3:
+    sobol = Sobol(box)
+    assert all(sobol.vectors(600,threads)==X[:600])
+    assert all(sobol.vectors(400,threads)==X[600:])
+  sobol.seek(123)
+  assert all(sobol.vector()==X[123])
+  # Scrambling keeps points in the box, and keeps each dyadic interval of the first 2^k points evenly filled
+  sobol = Sobol(box,scramble=7)
+  Y = sobol.vectors(1023,2)
+  assert all(box.lazy_inside(y) for y in Y)
+  cells = (16*(Y-box.min)/(box.max-box.min)).astype(int)
+  for i in xrange(3):
+    assert all(abs(bincount(cells[:,i],minlength=16)-64)<=1)
+
 def test_threefry():
   # Known answer test vectors for 20 round threefry2x64 from the Random123 distribution
   kat = '''0000000000000001 0000000000000000   0000000000000001 0000000000000000   76f8c465410f1b27 d44c2d67df04a330
@@ -117,6 +135,30 @@ def test_distributions():
     assert X.dtype==int32 and all(lo<=X) and all(X<hi)
     test('int %d %d'%(lo,hi),scipy.stats.randint(lo,hi),arange(lo,hi-1)+.5,X)
 
+def test_bulk():
+  # Bulk uniforms come straight from consecutive threefry blocks, low 64 bits first
+  n = 9
+  X = Random(9).uniform(n)
+  for i in xrange(n):
+    bits = (threefry(9,i//2)>>64*(i%2))&(2**64-1)
+    assert X[i]==bits*2.**-64
+  # Normals are deterministic per seed
+  assert all(Random(3).normal(n)==Random(3).normal(n))
+  # Larger fills are split into chunks of 1024 blocks across threads, and give the same values for any thread count
+  n = 5001
+  for threads in 1,3:
+    for method in 'uniform','normal':
+      serial,parallel = Random(4),Random(4)
+      assert all(getattr(serial,method)(n)==getattr(parallel,'parallel_'+method)(n,threads))
+      # Later draws continue from the same counter
+      assert all(serial.uniform(7)==parallel.uniform(7))
+  # Directions are unit length, and also independent of thread count
+  for d in 2,3:
+    X = Random(5).parallel_direction(n,d,1)
+    assert X.shape==(n,d)
+    assert allclose(magnitudes(X),1)
+    assert all(X==Random(5).parallel_direction(n,d,3))
+
 def test_permute():
   # Note: This tests only that random_permute(n,_) is a valid permutation, not for pseudorandomness.
   numpy.random.seed(7810131)
@@ -141,6 +183,8 @@ def test_permute():
 
 if __name__=='__main__':
   test_permute()
+  test_bulk()
   test_bits()
   test_distributions()
   test_sobol('sobol.png')
+  test_sobol_seek()
@@ -0,0 +1,261 @@
+//#####################################################################
+// Class KrylovSolver
+//#####################################################################
+#include <geode/solver/krylov.h>
+#include <geode/array/view.h>
+#include <geode/python/Class.h>
+#include <geode/utility/openmp.h>
+#include <geode/vector/SymmetricMatrix.h>
+#include <cmath>
+namespace geode {
+
+typedef real T;
+
+template<> GEODE_DEFINE_TYPE(KrylovSolver<Vector<T,2>>)
+template<> GEODE_DEFINE_TYPE(KrylovSolver<Vector<T,3>>)
+template<> GEODE_DEFINE_TYPE(SolidIncompleteCholesky<Vector<T,2>>)
+template<> GEODE_DEFINE_TYPE(SolidIncompleteCholesky<Vector<T,3>>)
+
+// Dot products are summed over blocks of this many nodes, independent of the number of threads
+static const int dot_block = 1024;
+
+template<class TV> static T dot_product(RawArray<const TV> x, RawArray<const TV> y, const int threads) {
+  const int n = x.size(),
+            blocks = (n+dot_block-1)/dot_block;
+  Array<T> partial(blocks,uninit);
+  #pragma omp parallel for num_threads(max(threads,1))
+  for (int b=0;b<blocks;b++) {
+    T sum = 0;
+    for (int i=b*dot_block;i<min(n,(b+1)*dot_block);i++)
+      sum += dot(x[i],y[i]);
+    partial[b] = sum;
+  }
+  T sum = 0;
+  for (const T p : partial)
+    sum += p;
+  return sum;
+}
+
+// y = a*x + b*y
+template<class TV> static void axpby(const T a, RawArray<const TV> x, const T b, RawArray<TV> y, const int threads) {
+  const int n = x.size();
+  #pragma omp parallel for schedule(static,1024) num_threads(max(threads,1))
+  for (int i=0;i<n;i++)
+    y[i] = a*x[i]+b*y[i];
+}
+
+template<class TV> KrylovSolver<TV>::KrylovSolver(const T tolerance, const int max_iterations, const int threads)
+  : tolerance(tolerance)
+  , max_iterations(max_iterations)
+  , threads(threads) {
+  GEODE_ASSERT(tolerance>=0 && max_iterations>=0);
+}
+
+template<class TV> KrylovSolver<TV>::~KrylovSolver() {}
+
+template<class TV> void KrylovSolver<TV>::apply_projection(RawArray<TV> x) const {
+  for (const int i : pinned)
+    x[i] = TV();
+  if (project)
+    project(x);
+}
+
+template<class TV> void KrylovSolver<TV>::precondition(RawArray<const TV> r, RawArray<TV> z) const {
+  if (preconditioner)
+    preconditioner->parallel_multiply(r,z,threads);
+  else
+    z = r;
+  apply_projection(z);
+}
+
+template<class TV> bool KrylovSolver<TV>::cg(const SolidMatrixBase<TV>& A, RawArray<const TV> b, RawArray<TV> x) {
+  const int n = A.size();
+  GEODE_ASSERT(b.size()==n && x.size()==n);
+  GEODE_ASSERT(!preconditioner || preconditioner->size()==n);
+  for (const int i : pinned)
+    GEODE_ASSERT(unsigned(i)<unsigned(n));
+  Array<TV> r(n,uninit), z(n,uninit), p(n,uninit), q(n,uninit);
+  residuals.clear();
+
+  // r = b - Ax
+  A.parallel_multiply(x,r,threads);
+  axpby<TV>(1,b,-1,r,threads);
+  apply_projection(r);
+  precondition(r,z);
+  p.copy(z);
+  T rz = dot_product<TV>(r,z,threads);
+  residuals.append(sqrt(dot_product<TV>(r,r,threads)));
+
+  for (int iteration=0;iteration<max_iterations && residuals.back()>tolerance;iteration++) {
+    A.parallel_multiply(p,q,threads);
+    apply_projection(q);
+    const T pq = dot_product<TV>(p,q,threads);
+    if (!(pq>0)) // A is not positive definite along p
+      break;
+    const T alpha = rz/pq;
+    axpby<TV>(alpha,p,1,x,threads);
+    axpby<TV>(-alpha,q,1,r,threads);
+    precondition(r,z);
+    const T rz_next = dot_product<TV>(r,z,threads);
+    axpby<TV>(1,z,rz_next/rz,p,threads);
+    rz = rz_next;
+    residuals.append(sqrt(dot_product<TV>(r,r,threads)));
+  }
+  return residuals.back()<=tolerance;
+}
+
+// See minres in scipy/sparse/linalg/isolve/minres.py, which follows Paige and Saunders.  The shift is zero.
+template<class TV> bool KrylovSolver<TV>::minres(const SolidMatrixBase<TV>& A, RawArray<const TV> b, RawArray<TV> x) {
+  const int n = A.size();
+  GEODE_ASSERT(b.size()==n && x.size()==n);
+  GEODE_ASSERT(!preconditioner || preconditioner->size()==n);
+  for (const int i : pinned)
+    GEODE_ASSERT(unsigned(i)<unsigned(n));
+  Array<TV> r1(n,uninit), r2(n,uninit), y(n,uninit), v(n), w(n), w1(n), w2(n);
+  residuals.clear();
+
+  // r1 = b - Ax, y = M r1
+  A.parallel_multiply(x,r1,threads);
+  axpby<TV>(1,b,-1,r1,threads);
+  apply_projection(r1);
+  precondition(r1,y);
+  const T rMr = dot_product<TV>(r1,y,threads);
+  GEODE_ASSERT(rMr>=0,"KrylovSolver::minres: preconditioner is not positive definite");
+  T beta = sqrt(rMr);
+  residuals.append(beta);
+  if (!(beta>tolerance))
+    return true;
+  r2.copy(r1);
+
+  T oldb = 0, dbar = 0, epsln = 0, phibar = beta, cs = -1, sn = 0;
+  for (int iteration=0;iteration<max_iterations;iteration++) {
+    // Lanczos step
+    const T s = 1/beta;
+    axpby<TV>(s,y,0,v,threads);
+    A.parallel_multiply(v,y,threads);
+    apply_projection(y);
+    if (iteration)
+      axpby<TV>(-beta/oldb,r1,1,y,threads);
+    const T alpha = dot_product<TV>(v,y,threads);
+    axpby<TV>(-alpha/beta,r2,1,y,threads);
+    swap(r1,r2);
+    r2.copy(y);
+    precondition(r2,y);
+    oldb = beta;
+    const T rMr = dot_product<TV>(r2,y,threads);
+    GEODE_ASSERT(rMr>=0,"KrylovSolver::minres: preconditioner is not positive definite");
+    beta = sqrt(rMr);
+
+    // Apply the previous rotation, and compute the next one
+    const T oldeps = epsln,
+            delta = cs*dbar+sn*alpha,
+            gbar = sn*dbar-cs*alpha;
+    epsln = sn*beta;
+    dbar = -cs*beta;
+    const T gamma = max(sqrt(sqr(gbar)+sqr(beta)),std::numeric_limits<T>::epsilon());
+    cs = gbar/gamma;
+    sn = beta/gamma;
+    const T phi = cs*phibar;
+    phibar = sn*phibar;
+
+    // Update x along the new direction w = (v - oldeps*w1 - delta*w2)/gamma
+    swap(w1,w2);
+    swap(w2,w);
+    #pragma omp parallel for schedule(static,1024) num_threads(max(threads,1))
+    for (int i=0;i<n;i++) {
+      w[i] = (v[i]-oldeps*w1[i]-delta*w2[i])/gamma;
+      x[i] += phi*w[i];
+    }
+    residuals.append(phibar);
+    if (phibar<=tolerance || !beta)
+      break;
+  }
+  return residuals.back()<=tolerance;
+}
+
+// Expand the upper triangular blocks of A into a full symmetric scalar matrix, and factor it
+template<class TV> static Ref<const SparseMatrix> incomplete_cholesky(const SolidMatrix<TV>& A, const T modified_coefficient, const int threads) {
+  const int d = TV::m, n = A.size();
+  const auto& sparse_j = A.sparse_j;
+  Array<int> blocks(n);
+  for (int i=0;i<n;i++) {
+    blocks[i] += sparse_j.size(i);
+    for (int k=1;k<sparse_j.size(i);k++)
+      blocks[sparse_j(i,k)]++;
+  }
+  Array<int> lengths(d*n,uninit);
+  for (int i=0;i<n;i++)
+    for (int a=0;a<d;a++)
+      lengths[d*i+a] = d*blocks[i];
+  Nested<int> J(lengths,uninit);
+  Array<T> C(J.flat.size(),uninit);
+  Array<int> next = J.offsets.slice(0,d*n).copy();
+  const auto set = [&](const int i, const int j, const Matrix<T,TV::m>& M) {
+    for (int a=0;a<d;a++)
+      for (int b=0;b<d;b++) {
+        const int index = next[d*i+a]++;
+        J.flat[index] = d*j+b;
+        C[index] = M(a,b);
+      }
+  };
+  for (int i=0;i<n;i++) {
+    set(i,i,A.sparse_A(i,0));
+    for (int k=1;k<sparse_j.size(i);k++) {
+      const int j = sparse_j(i,k);
+      set(i,j,A.sparse_A(i,k));
+      set(j,i,A.sparse_A(i,k).transposed());
+    }
+  }
+  return new_<SparseMatrix>(J,C)->incomplete_cholesky_factorization(modified_coefficient,1e-8,threads);
+}
+
+template<class TV> SolidIncompleteCholesky<TV>::SolidIncompleteCholesky(const SolidMatrix<TV>& A, const T modified_coefficient, const int threads)
+  : Base(A.size())
+  , factor(incomplete_cholesky(A,modified_coefficient,threads)) {}
+
+template<class TV> SolidIncompleteCholesky<TV>::~SolidIncompleteCholesky() {}
+
+template<class TV> void SolidIncompleteCholesky<TV>::multiply(RawArray<const TV> x, RawArray<TV> y) const {
+  parallel_multiply(x,y,1);
+}
+
+template<class TV> void SolidIncompleteCholesky<TV>::parallel_multiply(RawArray<const TV> x, RawArray<TV> y, const int threads) const {
+  GEODE_ASSERT(x.size()==this->size() && y.size()==this->size());
+  const auto sy = scalar_view(y);
+  factor->solve_forward_substitution(scalar_view(x),sy,threads);
+  factor->solve_backward_substitution(sy,sy,threads);
+}
+
+template class KrylovSolver<Vector<T,2>>;
+template class KrylovSolver<Vector<T,3>>;
+template class SolidIncompleteCholesky<Vector<T,2>>;
+template class SolidIncompleteCholesky<Vector<T,3>>;
+
+}
+using namespace geode;
+
+template<int d> static void wrap_helper() {
+  {typedef KrylovSolver<Vector<T,d>> Self;
+  Class<Self>(d==2?"KrylovSolver2d":"KrylovSolver3d")
+    .GEODE_INIT(T,int,int)
+    .GEODE_FIELD(tolerance)
+    .GEODE_FIELD(max_iterations)
+    .GEODE_FIELD(threads)
+    .GEODE_FIELD(preconditioner)
+    .GEODE_FIELD(pinned)
+    .GEODE_FIELD(residuals)
+    .GEODE_METHOD(cg)
+    .GEODE_METHOD(minres)
+    ;}
+
+  {typedef SolidIncompleteCholesky<Vector<T,d>> Self;
+  Class<Self>(d==2?"SolidIncompleteCholesky2d":"SolidIncompleteCholesky3d")
+    .GEODE_INIT(const SolidMatrix<Vector<T,d>>&,T,int)
+    .GEODE_FIELD(factor)
+    ;}
+}
+
+void wrap_krylov() {
+  wrap_helper<2>();
+  wrap_helper<3>();
+}
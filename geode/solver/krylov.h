@@ -0,0 +1,82 @@
+//#####################################################################
+// Class KrylovSolver
+//#####################################################################
+//
+// Preconditioned conjugate gradient and MINRES for symmetric SolidMatrixBase systems.
+//
+// The matrix and preconditioner are only accessed through parallel_multiply, so any SolidMatrixBase works:
+// a SolidMatrix, the SolidDiagonalMatrix from inverse_block_diagonal (block Jacobi), or an incomplete
+// Cholesky factorization (SolidIncompleteCholesky).  The preconditioner must be symmetric positive definite.
+// CG also requires A to be positive definite on the unpinned subspace; MINRES needs only symmetry.
+//
+// Pinned nodes are held at their initial values: the residual, search directions, and matrix and
+// preconditioner products are projected to zero on pinned nodes.  An optional project function is applied
+// after this projection, for more general constraints.
+//
+// Vector operations and dot products run on the given number of threads.  Dot products are summed over fixed
+// size blocks, so the iterates do not depend on the number of threads.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/vector/SolidMatrix.h>
+#include <geode/vector/SparseMatrix.h>
+#include <geode/python/Ptr.h>
+#include <geode/utility/function.h>
+namespace geode {
+
+template<class TV> class KrylovSolver : public Object {
+  typedef typename TV::Scalar T;
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef Object Base;
+
+  T tolerance; // Stop once the residual norm is at most tolerance (absolute)
+  int max_iterations;
+  int threads;
+  Ptr<const SolidMatrixBase<TV>> preconditioner; // Applies an approximate inverse, or null for none
+  Array<const int> pinned; // Nodes held at their initial values
+  function<void(RawArray<TV>)> project; // Optional projection applied in place after pinning
+
+  // Residual norms of the most recent solve, starting with the initial residual.  For CG these are
+  // |b-Ax|; for MINRES they are the preconditioned norms sqrt(r^T M^{-1} r), which equal |b-Ax| without
+  // a preconditioner.
+  Array<T> residuals;
+
+protected:
+  GEODE_CORE_EXPORT KrylovSolver(const T tolerance, const int max_iterations, const int threads=1);
+public:
+  ~KrylovSolver();
+
+  // Solve A x = b starting from the initial value of x.  Returns true if the tolerance was reached.
+  GEODE_CORE_EXPORT bool cg(const SolidMatrixBase<TV>& A, RawArray<const TV> b, RawArray<TV> x);
+  GEODE_CORE_EXPORT bool minres(const SolidMatrixBase<TV>& A, RawArray<const TV> b, RawArray<TV> x);
+
+private:
+  void apply_projection(RawArray<TV> x) const;
+  void precondition(RawArray<const TV> r, RawArray<TV> z) const;
+};
+
+// Incomplete Cholesky factorization of the sparse part of a SolidMatrix, for use as a preconditioner.
+// multiply(x,y) applies the inverse of the factorization.  Outers are ignored.  The default is plain IC(0):
+// modified incomplete Cholesky (modified_coefficient near 1) suits scalar M-matrices, but can lose
+// definiteness on block systems with dense off diagonal blocks.  The factorization and the triangular solves
+// in parallel_multiply are level scheduled, so their results do not depend on the number of threads.
+template<class TV> class SolidIncompleteCholesky : public SolidMatrixBase<TV> {
+  typedef typename TV::Scalar T;
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef SolidMatrixBase<TV> Base;
+
+  const Ref<const SparseMatrix> factor; // Scalar factorization with d*n rows
+
+protected:
+  GEODE_CORE_EXPORT SolidIncompleteCholesky(const SolidMatrix<TV>& A, const T modified_coefficient=0, const int threads=1);
+public:
+  ~SolidIncompleteCholesky();
+
+  GEODE_CORE_EXPORT void multiply(RawArray<const TV> x,RawArray<TV> y) const;
+  GEODE_CORE_EXPORT void parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const;
+};
+
+}
@@ -2,5 +2,6 @@
 
 void wrap_solver() {
   GEODE_WRAP(brent)
+  GEODE_WRAP(krylov)
   GEODE_WRAP(powell)
 }
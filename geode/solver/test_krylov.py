@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+
+from __future__ import division
+from geode import *
+from numpy import *
+
+def laplacian(n,shift):
+  random.seed(1831)
+  structure = SolidMatrixStructure(n)
+  edges = [(i,j) for i in xrange(n) for j in random.randint(0,n,3) if i!=j]
+  for i,j in edges:
+    structure.add_entry(i,j)
+  A = SolidMatrix[3](structure)
+  for i,j in edges:
+    # Symmetric positive definite springs, so that A is positive definite for positive shifts
+    M = random.randn(3,3)
+    K = M.dot(M.T)+eye(3)
+    A.add_entry(i,i,K)
+    A.add_entry(j,j,K)
+    A.add_entry(i,j,-K)
+  A.add_scalar(shift)
+  return A
+
+def test_cg():
+  n = 100
+  A = laplacian(n,.1)
+  b = random.randn(n,3)
+  x0 = linalg.solve(A.dense(),b.ravel()).reshape(-1,3)
+  for threads in 1,3:
+    for precondition in None,A.inverse_block_diagonal,lambda:SolidIncompleteCholesky[3](A,0,threads):
+      solver = KrylovSolver[3](1e-10,1000,threads)
+      if precondition:
+        solver.preconditioner = precondition()
+      x = zeros_like(b)
+      assert solver.cg(A,b,x)
+      assert len(solver.residuals)>1 and solver.residuals[-1]<=1e-10
+      assert allclose(x,x0)
+
+def test_minres():
+  n = 100
+  A = laplacian(n,-1) # Indefinite
+  b = random.randn(n,3)
+  solver = KrylovSolver[3](1e-10,2000,2)
+  solver.pinned = array([0,7],dtype=int32)
+  x = zeros_like(b)
+  x[0] = 1
+  assert solver.minres(A,b,x)
+  assert all(x[0]==1) and all(x[7]==0)
+  r = b-A.dense().dot(x.ravel()).reshape(-1,3)
+  r[[0,7]] = 0
+  assert maxabs(r)<1e-8
+
+def test_block_matrix():
+  n = 100
+  A = laplacian(n,.1)
+  x = random.randn(n,3)
+  y = A.dense().dot(x.ravel()).reshape(-1,3)
+  for single in 0,1:
+    B = SolidBlockMatrix[3](A,single)
+    for threads in 1,3:
+      z = empty_like(x)
+      B.parallel_multiply(x,z,threads)
+      assert relative_error(y,z)<(1e-6 if single else 1e-12)
+    # Values can be refreshed without rebuilding the structure
+    A2 = A.copy()
+    A2.scale(2)
+    B.update(A2)
+    B.multiply(x,z)
+    assert relative_error(2*y,z)<(1e-6 if single else 1e-12)
+  solver = KrylovSolver[3](1e-10,1000,2)
+  x = zeros_like(y)
+  assert solver.cg(SolidBlockMatrix[3](A,False),y,x)
+  assert relative_error(x,linalg.solve(A.dense(),y.ravel()).reshape(-1,3))<1e-8
+  # Asymmetric diagonal blocks are read through their upper triangle, as in SolidMatrix.multiply
+  A.add_entry(5,5,random.randn(3,3))
+  x = random.randn(n,3)
+  y = empty_like(x)
+  A.multiply(x,y)
+  for single in 0,1:
+    z = empty_like(x)
+    SolidBlockMatrix[3](A,single).multiply(x,z)
+    assert relative_error(y,z)<(1e-6 if single else 1e-12)
+
+if __name__=='__main__':
+  test_cg()
+  test_minres()
+  test_block_matrix()
@@ -4,6 +4,7 @@
 #include <geode/utility/interrupts.h>
 #include <geode/python/exceptions.h>
 #include <geode/python/config.h>
+#include <geode/python/gil.h>
 #include <vector>
 namespace geode {
 
@@ -29,6 +30,16 @@ void add_interrupt_checker(void (*checker)()) {
 
 #ifdef GEODE_PYTHON
 void check_python_interrupts() {
+  if (released_gil()) {
+    // This thread released the GIL around a long computation, so take it back briefly
+    ReacquireGIL gil;
+    if (PyErr_Occurred() || PyErr_CheckSignals())
+      throw_python_error();
+    return;
+  }
+  // Threads without python state can't check while another thread has released the GIL.  The releasing thread will.
+  if (any_released_gil() && !PyGILState_GetThisThreadState())
+    return;
   bool error = false;
   #pragma omp critical
   {
@@ -1,10 +1,12 @@
 // OpenMP helper routines
 #pragma once
 
+#include <geode/math/max.h>
 #include <geode/math/min.h>
 #include <geode/utility/debug.h>
 #include <geode/utility/range.h>
 #include <geode/utility/type_traits.h>
+#include <exception>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -46,4 +48,25 @@ template<class I,class TI> inline TI partition_loop_inverse(const I loop_steps,
                                : 0); // Only occurs if loop_steps==0
 }
 
+// Call body(i) for i in [0,n) on up to the given number of threads, handing out iterations dynamically.
+// OpenMP terminates if an exception escapes a parallel region, so the first exception thrown by body
+// is captured and rethrown on the calling thread once all iterations finish.
+template<class Body> static void parallel_for(const int n, const int threads, const Body& body) {
+  std::exception_ptr error;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(max(threads,1))
+  for (int i=0;i<n;i++) {
+    try {
+      body(i);
+    } catch (...) {
+      #pragma omp critical(geode_parallel_for)
+      {
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
 }
@@ -0,0 +1,202 @@
+//#####################################################################
+// Class SolidBlockMatrix
+//#####################################################################
+#include <geode/vector/SolidBlockMatrix.h>
+#include <geode/vector/SymmetricMatrix.h>
+#include <geode/python/Class.h>
+#include <geode/structure/Tuple.h>
+#include <geode/utility/const_cast.h>
+#include <geode/utility/openmp.h>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+namespace geode {
+
+typedef real T;
+
+template<> GEODE_DEFINE_TYPE(SolidBlockMatrix<Vector<T,2>>)
+template<> GEODE_DEFINE_TYPE(SolidBlockMatrix<Vector<T,3>>)
+template<class TV> const int SolidBlockMatrix<TV>::padded;
+
+template<class TV> SolidBlockMatrix<TV>::SolidBlockMatrix(const SolidMatrix<TV>& A, const bool single)
+  : Base(A.size())
+  , single(single)
+  , sparse_j(A.sparse_j) {
+  // Each row holds the transposes of the blocks above it, then its own upper triangular blocks
+  const int n = A.size();
+  Array<int> lengths(n,uninit);
+  for (int i=0;i<n;i++)
+    lengths[i] = sparse_j.size(i);
+  for (const int j : sparse_j.flat)
+    lengths[j]++;
+  for (int i=0;i<n;i++)
+    lengths[i]--; // The diagonal was counted twice
+  Nested<int> columns(lengths,uninit);
+  Array<int> source(columns.flat.size(),uninit);
+  Array<int> next = columns.offsets.slice(0,n).copy();
+  for (int i=0;i<n;i++)
+    for (int k=1;k<sparse_j.size(i);k++) {
+      const int j = sparse_j(i,k),
+                b = next[j]++;
+      columns.flat[b] = i;
+      source[b] = ~(sparse_j.offsets[i]+k);
+    }
+  for (int i=0;i<n;i++)
+    for (int k=0;k<sparse_j.size(i);k++) {
+      const int b = next[i]++;
+      columns.flat[b] = sparse_j(i,k);
+      source[b] = sparse_j.offsets[i]+k;
+    }
+  const_cast_(this->columns) = columns;
+  this->source = source;
+
+  // Allocate zero padded blocks, and fill in values
+  const int size = d*padded*source.size();
+  if (single)
+    single_blocks = Array<float>(size);
+  else
+    blocks = Array<double>(size);
+  update(A);
+}
+
+template<class TV> SolidBlockMatrix<TV>::~SolidBlockMatrix() {}
+
+template<class TV,class S> static void copy_blocks(const Nested<const int>& columns, RawArray<const int> source,
+                                                   RawArray<const Matrix<T,TV::m>> A, RawArray<S> blocks) {
+  const int d = TV::m, padded = SolidBlockMatrix<TV>::padded;
+  for (int i=0;i<columns.size();i++)
+    for (const int b : columns.range(i)) {
+      const int k = source[b];
+      // Diagonal blocks are read through their upper triangle, as in SolidMatrix::multiply
+      const Matrix<T,d> M = columns.flat[b]==i ? Matrix<T,d>(assume_symmetric(A[k])) : A[k<0?~k:k];
+      S* B = &blocks[d*padded*b];
+      for (int c=0;c<d;c++)
+        for (int r=0;r<d;r++)
+          B[padded*c+r] = S(k<0 ? M(c,r) : M(r,c));
+    }
+}
+
+template<class TV> void SolidBlockMatrix<TV>::update(const SolidMatrix<TV>& A) {
+  GEODE_ASSERT(A.valid() && A.size()==this->size());
+  GEODE_ASSERT(A.sparse_j.flat.data()==sparse_j.flat.data() || A.sparse_j==sparse_j,
+               "SolidBlockMatrix::update: matrix has a different structure");
+  if (single)
+    copy_blocks<TV>(columns,source,A.sparse_A.flat,single_blocks.raw());
+  else
+    copy_blocks<TV>(columns,source,A.sparse_A.flat,blocks.raw());
+
+  // Outers are applied separately, as in SolidMatrix
+  outers.resize(A.outers.size());
+  for (int o=0;o<(int)outers.size();o++) {
+    outers[o].x = A.outers[o].x;
+    outers[o].y = A.outers[o].y;
+    outers[o].z.copy(A.outers[o].z);
+  }
+}
+
+// Sum of B_k x_{j_k} over the blocks of one row
+template<int d,class S> static inline Vector<T,d> generic_row_product(const S* B, RawArray<const int> J, RawArray<const Vector<T,d>> x) {
+  const int padded = SolidBlockMatrix<Vector<T,d>>::padded;
+  Vector<T,d> sum;
+  for (const int j : J) {
+    const Vector<T,d> xj = x[j];
+    for (int c=0;c<d;c++)
+      for (int r=0;r<d;r++)
+        sum[r] += T(B[padded*c+r])*xj[c];
+    B += d*padded;
+  }
+  return sum;
+}
+
+template<class S> static inline Vector<T,2> row_product(const S* B, RawArray<const int> J, RawArray<const Vector<T,2>> x) {
+  return generic_row_product<2>(B,J,x);
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+static inline __m256d load_column(const double* B) {
+  return _mm256_loadu_pd(B);
+}
+
+static inline __m256d load_column(const float* B) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(B));
+}
+
+// One accumulator per block column keeps the fused multiply adds independent
+template<class S> static inline Vector<T,3> row_product(const S* B, RawArray<const int> J, RawArray<const Vector<T,3>> x) {
+  __m256d s0 = _mm256_setzero_pd(),
+          s1 = _mm256_setzero_pd(),
+          s2 = _mm256_setzero_pd();
+  for (const int j : J) {
+    const T* xj = x[j].data();
+    s0 = _mm256_fmadd_pd(load_column(B  ),_mm256_broadcast_sd(xj  ),s0);
+    s1 = _mm256_fmadd_pd(load_column(B+4),_mm256_broadcast_sd(xj+1),s1);
+    s2 = _mm256_fmadd_pd(load_column(B+8),_mm256_broadcast_sd(xj+2),s2);
+    B += 12;
+  }
+  double sum[4];
+  _mm256_storeu_pd(sum,_mm256_add_pd(_mm256_add_pd(s0,s1),s2));
+  return Vector<T,3>(sum[0],sum[1],sum[2]);
+}
+
+#else
+
+template<class S> static inline Vector<T,3> row_product(const S* B, RawArray<const int> J, RawArray<const Vector<T,3>> x) {
+  return generic_row_product<3>(B,J,x);
+}
+
+#endif
+
+template<class TV,class S> static void multiply_rows(const Nested<const int>& columns, RawArray<const S> blocks,
+                                                     RawArray<const TV> x, RawArray<TV> y, const int threads) {
+  const int n = columns.size(),
+            block = TV::m*SolidBlockMatrix<TV>::padded;
+  #pragma omp parallel for schedule(static,256) num_threads(max(threads,1))
+  for (int i=0;i<n;i++)
+    y[i] = row_product(blocks.data()+block*columns.offsets[i],columns[i],x);
+}
+
+template<class TV> void SolidBlockMatrix<TV>::multiply(RawArray<const TV> x, RawArray<TV> y) const {
+  parallel_multiply(x,y,1);
+}
+
+template<class TV> void SolidBlockMatrix<TV>::parallel_multiply(RawArray<const TV> x, RawArray<TV> y, const int threads) const {
+  GEODE_ASSERT(x.size()==this->size() && y.size()==this->size());
+  if (single)
+    multiply_rows<TV,float>(columns,single_blocks,x,y,threads);
+  else
+    multiply_rows<TV,double>(columns,blocks,x,y,threads);
+  for (const auto& outer : outers) {
+    RawArray<const int> nodes = outer.x;
+    const T B = outer.y;
+    if (!B)
+      continue;
+    RawArray<const TV> U = outer.z;
+    T sum = 0;
+    for (int a=0;a<nodes.size();a++)
+      sum += dot(U[a],x[nodes[a]]);
+    sum *= B;
+    for (int a=0;a<nodes.size();a++)
+      y[nodes[a]] += sum*U[a];
+  }
+}
+
+template class SolidBlockMatrix<Vector<T,2>>;
+template class SolidBlockMatrix<Vector<T,3>>;
+
+}
+using namespace geode;
+
+template<int d> static void wrap_helper() {
+  typedef SolidBlockMatrix<Vector<T,d>> Self;
+  Class<Self>(d==2?"SolidBlockMatrix2d":"SolidBlockMatrix3d")
+    .GEODE_INIT(const SolidMatrix<Vector<T,d>>&,bool)
+    .GEODE_FIELD(single)
+    .GEODE_METHOD(update)
+    ;
+}
+
+void wrap_solid_block_matrix() {
+  wrap_helper<2>();
+  wrap_helper<3>();
+}
@@ -0,0 +1,54 @@
+//#####################################################################
+// Class SolidBlockMatrix
+//#####################################################################
+//
+// A SolidMatrix expanded into block compressed sparse row (BSR) form for fast matrix vector products.
+//
+// SolidMatrix stores only the upper triangle, so multiply must scatter the transposed blocks.  Here both
+// triangles are stored, each row's blocks are contiguous and sorted by column, and every column of a block
+// is padded to a whole SIMD register (4 entries for 3x3 blocks).  A row's product is then a pure gather, so
+// rows can be split across threads without write conflicts, and the result does not depend on the number of
+// threads.  With AVX2 and FMA, 3x3 blocks use vector kernels.
+//
+// The symbolic part is built once from the structure of a SolidMatrix; update copies new values from any
+// SolidMatrix with the same structure, without allocating.  Blocks can optionally be stored in single
+// precision, halving memory traffic, for use in preconditioners.  Products are always accumulated in double.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/vector/SolidMatrix.h>
+namespace geode {
+
+template<class TV> class SolidBlockMatrix : public SolidMatrixBase<TV> {
+  typedef typename TV::Scalar T;
+  enum {d=TV::m};
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef SolidMatrixBase<TV> Base;
+
+  // Padded length of each stored block column
+  static const int padded = d==3 ? 4 : d;
+
+  const bool single; // Blocks are stored in single precision
+  const Nested<const int> sparse_j; // Structure of the source SolidMatrix
+  const Nested<const int> columns; // Block columns of each row, including the lower triangle
+private:
+  Array<const int> source; // Index of each block in sparse_A.flat, or ~index if transposed
+  Array<double> blocks; // d*padded entries per block, column major, if !single
+  Array<float> single_blocks; // Same, if single
+  std::vector<Tuple<Array<const int>,T,Array<TV>>> outers;
+
+protected:
+  GEODE_CORE_EXPORT SolidBlockMatrix(const SolidMatrix<TV>& A, const bool single=false);
+public:
+  ~SolidBlockMatrix();
+
+  // Copy values from A, which must have the same structure as the original matrix
+  GEODE_CORE_EXPORT void update(const SolidMatrix<TV>& A);
+
+  GEODE_CORE_EXPORT void multiply(RawArray<const TV> x, RawArray<TV> y) const;
+  GEODE_CORE_EXPORT void parallel_multiply(RawArray<const TV> x, RawArray<TV> y, const int threads) const;
+};
+
+}
@@ -10,6 +10,7 @@
 #include <geode/vector/SymmetricMatrix.h>
 #include <geode/geometry/Box.h>
 #include <geode/utility/const_cast.h>
+#include <geode/utility/openmp.h>
 namespace geode {
 
 typedef real T;
@@ -63,6 +64,11 @@ SolidMatrixBase(int n)
 template<class TV> SolidMatrixBase<TV>::
 ~SolidMatrixBase() {}
 
+template<class TV> void SolidMatrixBase<TV>::
+parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const {
+  multiply(x,y);
+}
+
 template<class TV> SolidMatrix<TV>::
 SolidMatrix(const SolidMatrixStructure& structure)
   : Base(structure.n), next_outer(0) {
@@ -259,6 +265,38 @@ multiply(RawArray<const TV> x, RawArray<TV> y) const {
   }
 }
 
+template<class TV> void SolidMatrix<TV>::
+parallel_multiply(RawArray<const TV> x, RawArray<TV> y, const int threads) const {
+  GEODE_ASSERT(valid() && x.size()==this->size() && y.size()==this->size());
+  // multiply scatters the transposed upper triangle, which races across rows.  Instead, gather each row
+  // from its upper triangle and the transposed entries of its column, so that rows are independent.
+  std::call_once(transpose_once,[this]() {
+    const int n = sparse_j.size();
+    Array<int> lengths(n);
+    for (int i=0;i<n;i++)
+      for (int k=1;k<sparse_j.size(i);k++)
+        lengths[sparse_j(i,k)]++;
+    Nested<Vector<int,2>> transpose(lengths,uninit);
+    for (int i=n-1;i>=0;i--)
+      for (int k=sparse_j.size(i)-1;k>0;k--) {
+        const int j = sparse_j(i,k);
+        transpose(j,--lengths[j]) = vec(i,k);
+      }
+    transpose_ = transpose;
+  });
+  const int n = sparse_j.size();
+  #pragma omp parallel for schedule(static,256) num_threads(max(threads,1))
+  for (int i=0;i<n;i++) {
+    TV sum = assume_symmetric(sparse_A(i,0))*x[i];
+    for (int k=1;k<sparse_j.size(i);k++)
+      sum += sparse_A(i,k)*x[sparse_j(i,k)];
+    for (const auto& ik : transpose_[i])
+      sum += sparse_A(ik.x,ik.y).transpose_times(x[ik.x]);
+    y[i] = sum;
+  }
+  add_multiply_outers(x,y);
+}
+
 template<class TV> typename TV::Scalar SolidMatrix<TV>::
 inner_product(RawArray<const TV> x, RawArray<const TV> y) const {
   GEODE_ASSERT(valid() && x.size()==this->size() && y.size()==this->size());
@@ -356,6 +394,13 @@ multiply(RawArray<const TV> x,RawArray<TV> y) const {
     y[i] = A[i]*x[i];
 }
 
+template<class TV> void SolidDiagonalMatrix<TV>::
+parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const {
+  #pragma omp parallel for schedule(static,1024) num_threads(max(threads,1))
+  for (int i=0;i<A.size();i++)
+    y[i] = A[i]*x[i];
+}
+
 template<class TV> typename TV::Scalar SolidDiagonalMatrix<TV>::
 inner_product(RawArray<const TV> x,RawArray<const TV> y) const {
   T sum = 0;
@@ -378,6 +423,7 @@ template<int d> static void wrap_helper() {
   {typedef SolidMatrixBase<Vector<T,d>> Self;
   Class<Self>(d==2?"SolidMatrixBase2d":"SolidMatrixBase3d")
     .GEODE_METHOD(multiply)
+    .GEODE_METHOD(parallel_multiply)
     ;}
 
   {typedef SolidMatrix<Vector<T,d>> Self;
@@ -22,6 +22,7 @@
 #include <geode/vector/Matrix.h>
 #include <geode/vector/Vector.h>
 #include <geode/structure/Triple.h>
+#include <mutex>
 namespace geode {
 
 class SolidMatrixStructure : public Object {
@@ -69,6 +70,10 @@ public:
   }
 
   virtual void multiply(RawArray<const TV> x,RawArray<TV> y) const = 0;
+
+  // Same as multiply, but using several threads.  The result does not depend on the number of threads.
+  // The default implementation calls multiply.
+  GEODE_CORE_EXPORT virtual void parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const;
 };
 
 template<class TV> class SolidMatrix : public SolidMatrixBase<TV> {
@@ -85,6 +90,8 @@ public:
   const std::vector<Tuple<Array<const int>,T,Array<TV> > > outers; // restricted to m==1 for now
 private:
   int next_outer;
+  mutable std::once_flag transpose_once;
+  mutable Nested<const Vector<int,2>> transpose_; // (i,k) for each sparse_A(i,k) with i<j, grouped by column j
 
   GEODE_CORE_EXPORT SolidMatrix(const SolidMatrixStructure& structure);
   GEODE_CORE_EXPORT SolidMatrix(const SolidMatrix& A);
@@ -119,6 +126,7 @@ public:
   GEODE_CORE_EXPORT TMatrix entry(int i,int j) const ;
   GEODE_CORE_EXPORT Tuple<Array<int>,Array<int>,Array<T> > entries() const ;
   GEODE_CORE_EXPORT void multiply(RawArray<const TV> x,RawArray<TV> y) const ;
+  GEODE_CORE_EXPORT void parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const ;
   GEODE_CORE_EXPORT T inner_product(RawArray<const TV> x,RawArray<const TV> y) const ;
   Ref<SolidDiagonalMatrix<TV> > inverse_block_diagonal() const;
   GEODE_CORE_EXPORT Box<T> diagonal_range() const ;
@@ -146,6 +154,7 @@ public:
   GEODE_CORE_EXPORT ~SolidDiagonalMatrix();
 
   GEODE_CORE_EXPORT void multiply(RawArray<const TV> x,RawArray<TV> y) const ;
+  GEODE_CORE_EXPORT void parallel_multiply(RawArray<const TV> x,RawArray<TV> y,const int threads) const ;
   GEODE_CORE_EXPORT T inner_product(RawArray<const TV> x,RawArray<const TV> y) const ;
 };
 
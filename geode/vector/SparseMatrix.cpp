@@ -10,6 +10,8 @@
 #include <geode/structure/Hashtable.h>
 #include <geode/utility/Log.h>
 #include <geode/utility/const_cast.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
 namespace geode {
 
 typedef real T;
@@ -82,7 +84,7 @@ SparseMatrix::SparseMatrix(const Hashtable<Vector<int,2>,T>& entries, const Vect
 }
 
 SparseMatrix::SparseMatrix(Nested<const int> J, Nested<T> A, Array<const int> diagonal_index, const bool cholesky, Private)
-  : J(J), A(A), cholesky(cholesky), diagonal_index(diagonal_index) {}
+  : J(J), A(A), columns_(J.size()), cholesky(cholesky), diagonal_index(diagonal_index) {}
 
 SparseMatrix::~SparseMatrix() {}
 
@@ -168,28 +170,117 @@ positive_diagonal_and_nonnegative_row_sum(const T tolerance) const
     return result;
 }
 
+// Call body(i) for every row, one level at a time, splitting the rows of each level across threads.
+// Levels that are too small to be worth a barrier are run in order on one thread.
+template<class Body> static void
+level_for(const Nested<const int>& levels,const int threads,const Body& body)
+{
+    if(threads<=1 || levels.total_size()<64*levels.size()){
+        for(const int i : levels.flat) body(i);
+        return;}
+    #pragma omp parallel num_threads(threads)
+    for(int l=0;l<levels.size();l++){
+        const RawArray<const int> rows=levels[l];
+        #pragma omp for schedule(static,64)
+        for(int r=0;r<rows.size();r++) body(rows[r]);}
+}
+
+// Group rows by level (or color), keeping rows in order within each group
+static Nested<const int>
+group_rows(RawArray<const int> level,const int levels)
+{
+    Array<int> counts(levels);
+    for(const int l : level) counts[l]++;
+    Nested<int> groups(counts,uninit);
+    Array<int> next=groups.offsets.slice(0,levels).copy();
+    for(int i=0;i<level.size();i++) groups.flat[next[level[i]]++]=i;
+    return groups;
+}
+
+const Nested<const int>& SparseMatrix::
+lower_levels() const
+{
+    std::call_once(lower_once,[this](){
+        GEODE_ASSERT(rows()==columns());
+        initialize_diagonal_index();
+        // Each row comes after every row it references below the diagonal
+        Array<int> level(rows(),uninit);int levels=0;
+        for(int i=0;i<rows();i++){
+            int l=0;
+            for(int index=J.offsets[i];index<diagonal_index[i];index++) l=max(l,level[J.flat[index]]+1);
+            level[i]=l;levels=max(levels,l+1);}
+        lower_levels_=group_rows(level,levels);});
+    return lower_levels_;
+}
+
+const Nested<const int>& SparseMatrix::
+upper_levels() const
+{
+    std::call_once(upper_once,[this](){
+        GEODE_ASSERT(rows()==columns());
+        initialize_diagonal_index();
+        // Each row comes after every row it references above the diagonal
+        Array<int> level(rows(),uninit);int levels=0;
+        for(int i=rows()-1;i>=0;i--){
+            int l=0;
+            for(int index=diagonal_index[i]+1;index<J.offsets[i+1];index++) l=max(l,level[J.flat[index]]+1);
+            level[i]=l;levels=max(levels,l+1);}
+        upper_levels_=group_rows(level,levels);});
+    return upper_levels_;
+}
+
+const Nested<const int>& SparseMatrix::
+row_colors() const
+{
+    std::call_once(color_once,[this](){
+        GEODE_ASSERT(rows()==columns());
+        const int n=rows();
+        // Rows i and j conflict if either references the other.  Collect the earlier rows referencing each row.
+        Array<int> counts(n);
+        for(int j=0;j<n;j++) for(const int i : J[j]) if(i>j) counts[i]++;
+        Nested<int> earlier(counts,uninit);
+        Array<int> next=earlier.offsets.slice(0,n).copy();
+        for(int j=0;j<n;j++) for(const int i : J[j]) if(i>j) earlier.flat[next[i]++]=j;
+
+        // Give each row the smallest color not used by a conflicting earlier row
+        Array<int> color(n,uninit),used; // used[c]==i if color c is taken by a neighbor of row i
+        for(int i=0;i<n;i++){
+            for(const int j : J[i]) if(j<i) used[color[j]]=i;
+            for(const int j : earlier[i]) used[color[j]]=i;
+            int c=0;
+            while(c<used.size() && used[c]==i) c++;
+            if(c==used.size()) used.append(-1);
+            color[i]=c;}
+        colors_=group_rows(color,used.size());});
+    return colors_;
+}
+
 void SparseMatrix::
-solve_forward_substitution(RawArray<const T> b,RawArray<T> x) const
+solve_forward_substitution(RawArray<const T> b,RawArray<T> x,const int threads) const
 {
     GEODE_ASSERT(cholesky && rows()<=x.size() && rows()<=b.size());
     // The result of Incomplete_Cholesky_Factorization has unit diagonals in the lower triangle.
-    for(int i=0;i<rows();i++){
+    const auto row=[&](const int i){
         T sum=0;
         for(int index=J.offsets[i];index<diagonal_index[i];index++)
             sum+=A.flat[index]*x[J.flat[index]];
-        x[i]=b[i]-sum;}
+        x[i]=b[i]-sum;};
+    if(threads>1) level_for(lower_levels(),threads,row);
+    else for(int i=0;i<rows();i++) row(i);
 }
 
 void SparseMatrix::
-solve_backward_substitution(RawArray<const T> b,RawArray<T> x) const
+solve_backward_substitution(RawArray<const T> b,RawArray<T> x,const int threads) const
 {
     GEODE_ASSERT(cholesky && rows()<=x.size() && rows()<=b.size());
     // The result of Incomplete_Cholesky_Factorization has an inverted diagonal for the upper triangle.
-    for(int i=rows()-1;i>=0;i--){
+    const auto row=[&](const int i){
         T sum=0;
         for(int index=diagonal_index[i]+1;index<J.offsets[i+1];index++)
             sum+=A.flat[index]*x[J.flat[index]];
-        x[i]=(b[i]-sum)*A.flat[diagonal_index[i]];}
+        x[i]=(b[i]-sum)*A.flat[diagonal_index[i]];};
+    if(threads>1) level_for(upper_levels(),threads,row);
+    else for(int i=rows()-1;i>=0;i--) row(i);
 }
 
 void SparseMatrix::
@@ -206,47 +297,144 @@ initialize_diagonal_index() const
 
 // actually an LU saving square roots, with an inverted diagonal saving divides
 Ref<SparseMatrix > SparseMatrix::
-incomplete_cholesky_factorization(const T modified_coefficient,const T zero_tolerance) const
+incomplete_cholesky_factorization(const T modified_coefficient,const T zero_tolerance,const int threads) const
 {
     GEODE_ASSERT(rows()==columns());
     initialize_diagonal_index();
     Array<T> C(A.flat.copy());
-    for(int i=0;i<rows();i++){ // for each row
+    // Row i reads only finished rows k<i and writes only its own entries, so the lower levels can run in parallel
+    const auto row=[&](const int i){
         int row_diagonal_index=diagonal_index[i],row_end=J.offsets[i+1];T sum=0;
         for(int k_bar=J.offsets[i];k_bar<row_diagonal_index;k_bar++){ // for all the entries before the diagonal element
             int k=J.flat[k_bar];int row2_diagonal_index=diagonal_index[k],row2_end=J.offsets[k+1];
             C[k_bar]*=C[row2_diagonal_index]; // divide by the diagonal element (which has already been inverted)
             int j_bar=k_bar+1; // start with the next element in the row, when subtracting the dot product
             for(int i_bar=row2_diagonal_index+1;i_bar<row2_end;i_bar++){ // run through the rest of the elements in the row2
-                int i=J.flat[i_bar];T dot_product_term=C[k_bar]*C[i_bar];
-                while(j_bar<row_end-1 && J.flat[j_bar]<i) j_bar++; // gets j_bar such that j_bar>=i
-                if(J.flat[j_bar]==i) C[j_bar]-=dot_product_term;
+                int j=J.flat[i_bar];T dot_product_term=C[k_bar]*C[i_bar];
+                while(j_bar<row_end-1 && J.flat[j_bar]<j) j_bar++; // gets j_bar such that j_bar>=j
+                if(J.flat[j_bar]==j) C[j_bar]-=dot_product_term;
                 else sum+=dot_product_term;}}
         T denominator=C[row_diagonal_index]-modified_coefficient*sum;
         if(i==rows()-1 && denominator<=zero_tolerance) denominator=zero_tolerance; // ensure last diagonal element is not zero
-        C[row_diagonal_index]=1/denominator;} // finally, store the diagonal element in inverted form
+        C[row_diagonal_index]=1/denominator;}; // finally, store the diagonal element in inverted form
+    if(threads>1) level_for(lower_levels(),threads,row);
+    else for(int i=0;i<rows();i++) row(i); // for each row
 
-    return new_<SparseMatrix>(J,Nested<T>::reshape_like(C,J),diagonal_index,true,Private());
+    const auto factor=new_<SparseMatrix>(J,Nested<T>::reshape_like(C,J),diagonal_index,true,Private());
+    if(threads>1) // The factor has our structure, so it can reuse our levels
+        std::call_once(factor->lower_once,[&](){factor->lower_levels_=lower_levels_;});
+    return factor;
 }
 
 void SparseMatrix::
-gauss_seidel_solve(RawArray<T> x,RawArray<const T> b,const T tolerance,const int max_iterations) const
+gauss_seidel_solve(RawArray<T> x,RawArray<const T> b,const T tolerance,const int max_iterations,const int threads) const
 {
     GEODE_ASSERT(rows()==columns() && x.size()==rows() && b.size()==rows());
     const T sqr_tolerance=sqr(tolerance);
+    // Relax row i, returning the squared change in x[i]
+    const auto relax=[&](const int i){
+        T rho=0;T diagonal_entry=0;
+        for(int index=J.offsets[i];index<J.offsets[i+1];index++){
+            if(J.flat[index]==i) diagonal_entry=A.flat[index];
+            else rho+=A.flat[index]*x[J.flat[index]];}
+        T new_x=(b[i]-rho)/diagonal_entry;
+        T change=sqr(new_x-x[i]);
+        x[i]=new_x;
+        return change;};
+    if(threads<=1){
+        for(int iteration=0;iteration<max_iterations;iteration++){
+            T sqr_residual=0;
+            for(int i=0;i<rows();i++) sqr_residual+=relax(i);
+            if(sqr_residual <= sqr_tolerance) break;}
+        return;}
+
+    // Rows of one color are independent, so each color is relaxed in parallel.  Changes are summed over
+    // fixed size blocks so that the iterates do not depend on the number of threads.
+    const Nested<const int>& colors=row_colors();
+    const int block=1024;
+    Array<T> partial((colors.flat.size()+block-1)/block,uninit);
     for(int iteration=0;iteration<max_iterations;iteration++){
         T sqr_residual=0;
-        for(int i=0;i<rows();i++){
-            T rho=0;T diagonal_entry=0;
-            for(int index=J.offsets[i];index<J.offsets[i+1];index++){
-                if(J.flat[index]==i) diagonal_entry=A.flat[index];
-                else rho+=A.flat[index]*x[J.flat[index]];}
-            T new_x=x[i]=(b[i]-rho)/diagonal_entry;
-            sqr_residual+=sqr(new_x-x[i]);
-            x[i]=new_x;}
+        for(int c=0;c<colors.size();c++){
+            const RawArray<const int> rows=colors[c];
+            const int blocks=(rows.size()+block-1)/block;
+            #pragma omp parallel for schedule(static) num_threads(threads)
+            for(int k=0;k<blocks;k++){
+                T sum=0;
+                for(int r=k*block;r<min(rows.size(),(k+1)*block);r++) sum+=relax(rows[r]);
+                partial[k]=sum;}
+            for(int k=0;k<blocks;k++) sqr_residual+=partial[k];}
         if(sqr_residual <= sqr_tolerance) break;}
 }
 
+Array<int> SparseMatrix::
+reverse_cuthill_mckee() const
+{
+    GEODE_ASSERT(rows()==columns());
+    const int n=rows();
+    Array<int> order;order.preallocate(n);
+    Array<int> mark(n),distance(n,uninit),queue;queue.preallocate(n);
+    int search=0; // mark[i]==search if i was reached by the current breadth first search
+
+    // Breadth first search over the unordered rows reachable from root, returning the eccentricity of root
+    const auto bfs=[&](const int root){
+        search++;queue.clear();
+        queue.append(root);mark[root]=search;distance[root]=0;
+        for(int q=0;q<queue.size();q++){
+            const int i=queue[q];
+            for(const int j : J[i]) if(mark[j]!=search && mark[j]>=0){
+                mark[j]=search;distance[j]=distance[i]+1;
+                queue.append(j);}}
+        return distance[queue.back()];};
+
+    for(int seed=0;seed<n;seed++){
+        if(mark[seed]<0) continue;
+        // Find a pseudo peripheral start row by repeatedly jumping to a minimum degree row in the last level
+        int root=seed,eccentricity=bfs(root);
+        for(;;){
+            int next=queue.back();
+            for(int q=queue.size()-1;q>=0 && distance[queue[q]]==eccentricity;q--)
+                if(J.size(queue[q])<J.size(next)) next=queue[q];
+            const int e=bfs(next);
+            if(e<=eccentricity) break;
+            root=next;eccentricity=e;}
+
+        // Cuthill-McKee: breadth first from root, visiting the neighbors of each row in order of degree.
+        // Ordered rows are marked with -1.
+        const int start=order.size();
+        order.append(root);mark[root]=-1;
+        for(int q=start;q<order.size();q++){
+            const int i=order[q],first=order.size();
+            for(const int j : J[i]) if(mark[j]>=0){
+                mark[j]=-1;order.append(j);}
+            std::stable_sort(order.data()+first,order.data()+order.size(),[this](const int a,const int b){return J.size(a)<J.size(b);});}}
+
+    std::reverse(order.begin(),order.end());
+    return order;
+}
+
+Ref<SparseMatrix> SparseMatrix::
+permuted(RawArray<const int> order) const
+{
+    GEODE_ASSERT(rows()==columns() && order.size()==rows());
+    const int n=rows();
+    Array<int> inverse(n);inverse.fill(-1);
+    for(int p=0;p<n;p++){
+        const int i=order[p];
+        GEODE_ASSERT(unsigned(i)<unsigned(n) && inverse[i]<0,"SparseMatrix::permuted: order is not a permutation");
+        inverse[i]=p;}
+    Array<int> lengths(n,uninit);
+    for(int p=0;p<n;p++) lengths[p]=J.size(order[p]);
+    Nested<int> PJ(lengths,uninit);
+    Array<T> PA(PJ.flat.size(),uninit);
+    for(int p=0;p<n;p++){
+        const int i=order[p],offset=PJ.offsets[p];
+        for(int a=0;a<J.size(i);a++){
+            PJ.flat[offset+a]=inverse[J(i,a)];
+            PA[offset+a]=A(i,a);}}
+    return new_<SparseMatrix>(PJ,PA); // sorts the permuted rows
+}
+
 std::ostream&
 operator<<(std::ostream& output,const SparseMatrix& A)
 {
@@ -269,9 +457,15 @@ void wrap_sparse_matrix()
         .GEODE_FIELD(J)
         .GEODE_FIELD(A)
         .GEODE_METHOD_2("multiply",multiply_python)
-        .GEODE_METHOD(solve_forward_substitution)
-        .GEODE_METHOD(solve_backward_substitution)
-        .GEODE_METHOD(incomplete_cholesky_factorization)
-        .GEODE_METHOD(gauss_seidel_solve)
+        .GEODE_METHOD_2("solve_forward_substitution",solve_forward_substitution_py)
+        .GEODE_METHOD_2("solve_backward_substitution",solve_backward_substitution_py)
+        .GEODE_METHOD_2("incomplete_cholesky_factorization",incomplete_cholesky_factorization_py)
+        .GEODE_METHOD_2("gauss_seidel_solve",gauss_seidel_solve_py)
+        .GEODE_METHOD_2("parallel_solve_forward_substitution",solve_forward_substitution)
+        .GEODE_METHOD_2("parallel_solve_backward_substitution",solve_backward_substitution)
+        .GEODE_METHOD_2("parallel_incomplete_cholesky_factorization",incomplete_cholesky_factorization)
+        .GEODE_METHOD_2("parallel_gauss_seidel_solve",gauss_seidel_solve)
+        .GEODE_METHOD(reverse_cuthill_mckee)
+        .GEODE_METHOD(permuted)
         ;
 }
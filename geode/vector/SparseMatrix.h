@@ -4,6 +4,15 @@
 //
 // A sparse matrix class using flat storage.
 //
+// The triangular solves and incomplete Cholesky factorization can run on several threads using level
+// scheduling: rows are grouped into levels such that each row depends only on rows in earlier levels.  The
+// arithmetic for each row is unchanged, so the results are identical for any number of threads.  Gauss-Seidel
+// with threads>1 sweeps over a greedy coloring of the rows instead of in row order; the iterates then do not
+// depend on the number of threads, but differ from those of the sequential sweep.
+//
+// reverse_cuthill_mckee and permuted reorder a symmetric matrix to reduce its bandwidth, which improves
+// cache locality (and the quality of incomplete factorizations) on large unstructured systems.
+//
 //#####################################################################
 #pragma once
 
@@ -11,6 +20,7 @@
 #include <geode/python/Object.h>
 #include <geode/vector/Vector.h>
 #include <geode/structure/Hashtable.h>
+#include <mutex>
 
 namespace geode {
 
@@ -26,6 +36,8 @@ private:
     int columns_;
     bool cholesky;
     mutable Array<const int> diagonal_index;
+    mutable std::once_flag lower_once,upper_once,color_once;
+    mutable Nested<const int> lower_levels_,upper_levels_,colors_;
     struct Private{};
 
     GEODE_CORE_EXPORT SparseMatrix(Nested<int> J,Array<T> A); // entries in each row will be sorted
@@ -54,10 +66,32 @@ public:
     void multiply_python(NdArray<const T> x,NdArray<T> result) const;
     bool symmetric(const T tolerance=1e-7) const;
     bool positive_diagonal_and_nonnegative_row_sum(const T tolerance=1e-7) const;
-    void solve_forward_substitution(RawArray<const T> b,RawArray<T> x) const;
-    void solve_backward_substitution(RawArray<const T> b,RawArray<T> x) const;
-    Ref<SparseMatrix> incomplete_cholesky_factorization(const T modified_coefficient=.97,const T zero_tolerance=1e-8) const;
-    void gauss_seidel_solve(RawArray<T> x,RawArray<const T> b,const T tolerance=1e-12,const int max_iterations=1000000) const;
+    void solve_forward_substitution(RawArray<const T> b,RawArray<T> x,const int threads=1) const;
+    void solve_backward_substitution(RawArray<const T> b,RawArray<T> x,const int threads=1) const;
+    Ref<SparseMatrix> incomplete_cholesky_factorization(const T modified_coefficient=.97,const T zero_tolerance=1e-8,const int threads=1) const;
+    void gauss_seidel_solve(RawArray<T> x,RawArray<const T> b,const T tolerance=1e-12,const int max_iterations=1000000,const int threads=1) const;
+
+    // Python versions with the original single threaded signatures.  The threaded ones are wrapped as parallel_*.
+    void solve_forward_substitution_py(RawArray<const T> b,RawArray<T> x) const
+    {solve_forward_substitution(b,x);}
+    void solve_backward_substitution_py(RawArray<const T> b,RawArray<T> x) const
+    {solve_backward_substitution(b,x);}
+    Ref<SparseMatrix> incomplete_cholesky_factorization_py(const T modified_coefficient,const T zero_tolerance) const
+    {return incomplete_cholesky_factorization(modified_coefficient,zero_tolerance);}
+    void gauss_seidel_solve_py(RawArray<T> x,RawArray<const T> b,const T tolerance,const int max_iterations) const
+    {gauss_seidel_solve(x,b,tolerance,max_iterations);}
+
+    // Rows grouped by level for the lower and upper triangular parts, and rows grouped by color so that rows of
+    // one color never reference each other.  Computed on first use.
+    const Nested<const int>& lower_levels() const;
+    const Nested<const int>& upper_levels() const;
+    const Nested<const int>& row_colors() const;
+
+    // Reverse Cuthill-McKee ordering of a structurally symmetric matrix: order[p] is the original index of row p
+    Array<int> reverse_cuthill_mckee() const;
+
+    // The symmetrically permuted matrix B with B(p,q) = A(order[p],order[q])
+    Ref<SparseMatrix> permuted(RawArray<const int> order) const;
 private:
     void initialize_diagonal_index() const;
 };
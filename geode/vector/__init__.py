@@ -26,6 +26,9 @@ from numpy import (square as sqr, arctan2 as atan2, arcsin as asin, arccos as ac
 from numpy.linalg import norm as magnitude
 
 SolidMatrix = {2:SolidMatrix2d,3:SolidMatrix3d}
+SolidBlockMatrix = {2:SolidBlockMatrix2d,3:SolidBlockMatrix3d}
+KrylovSolver = {2:KrylovSolver2d,3:KrylovSolver3d}
+SolidIncompleteCholesky = {2:SolidIncompleteCholesky2d,3:SolidIncompleteCholesky3d}
 
 class ConvergenceError(RuntimeError):
   def __init__(self,s,x):
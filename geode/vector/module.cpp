@@ -79,6 +79,7 @@ void wrap_vector() {
   GEODE_WRAP(frame)
   GEODE_WRAP(sparse_matrix)
   GEODE_WRAP(solid_matrix)
+  GEODE_WRAP(solid_block_matrix)
   GEODE_WRAP(register)
 
 #ifdef GEODE_PYTHON
@@ -67,6 +67,59 @@ def test_sparse():
   b3=2*x-[x[1],x[0]+x[2],x[1]]
   assert all(abs(b2-b3)<1e-6)
 
+def test_sparse_parallel():
+  # Five point laplacian on a shuffled grid, so that the levels and colors are nontrivial
+  random.seed(8123)
+  n=40
+  perm=random.permutation(n*n)
+  J,A=[],[]
+  for i in xrange(n):
+    for j in xrange(n):
+      row,entries=[perm[n*i+j]],[4.1]
+      for a,b in (i-1,j),(i+1,j),(i,j-1),(i,j+1):
+        if 0<=a<n and 0<=b<n:
+          row.append(perm[n*a+b])
+          entries.append(-1)
+      J.append(row)
+      A.append(entries)
+  order=argsort(perm)
+  M=SparseMatrix(Nested([J[k] for k in order],dtype=int32),array(concatenate([A[k] for k in order]),dtype=geode.real))
+  b=random.randn(n*n)
+  C=M.incomplete_cholesky_factorization(.97,1e-8)
+  x=empty_like(b)
+  C.solve_forward_substitution(b,x)
+  C.solve_backward_substitution(x,x)
+  for threads in 2,3:
+    # Level scheduling is exact
+    Ct=M.parallel_incomplete_cholesky_factorization(.97,1e-8,threads)
+    assert all(Ct.A.flat==C.A.flat)
+    y=empty_like(b)
+    Ct.parallel_solve_forward_substitution(b,y,threads)
+    Ct.parallel_solve_backward_substitution(y,y,threads)
+    assert all(x==y)
+  # Multicolor Gauss-Seidel converges, independent of the number of threads
+  D=zeros((n*n,n*n))
+  for i in xrange(n*n):
+    D[i,M.J[i]]=M.A[i]
+  x0=linalg.solve(D,b)
+  xs=[]
+  for threads in 1,2,3:
+    x=zeros_like(b)
+    M.parallel_gauss_seidel_solve(x,b,1e-12,10000,threads)
+    assert allclose(x,x0)
+    xs.append(x)
+  assert all(xs[1]==xs[2])
+  # Reverse Cuthill-McKee shrinks the bandwidth back down
+  def bandwidth(M):
+    return max(abs(j-i) for i in xrange(M.rows()) for j in M.J[i])
+  rcm=M.reverse_cuthill_mckee()
+  P=M.permuted(rcm)
+  assert bandwidth(P)<=2*n<bandwidth(M)
+  assert all(sort(rcm)==arange(n*n))
+  y=empty_like(b)
+  P.multiply(b[rcm],y)
+  assert allclose(y,dot(D,b)[rcm])
+
 def test_singular_values():
   from scipy.linalg import svdvals
   random.seed(13811)